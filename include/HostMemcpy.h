@@ -0,0 +1,60 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef HOSTMEMCPY_H
+#define HOSTMEMCPY_H
+
+#include <cstddef>
+
+//
+// Host copy baselines, the host counterpart of CudaMemcpy.h. Host transposes are compared
+// against the best bandwidth these reach on the machine
+//
+
+// Copy methods
+enum {
+  // std::memcpy
+  HostCopyMemcpy,
+  // SIMD loads and stores (SSE2 on x86-64, NEON on AArch64)
+  HostCopyVector,
+  // SIMD loads and non-temporal stores that bypass the caches (x86-64 only)
+  HostCopyStream,
+  NumHostCopyMethod
+};
+
+// Name of copy method
+const char* hostCopyName(const int method);
+
+// True if copy method is available on this CPU
+bool hostCopyAvailable(const int method);
+
+//
+// Copies bytes from data_in to data_out using method on numThread threads, each copying a
+// contiguous part. If pin is true, thread i runs on CPU i (Linux only). Copies are always done on
+// spawned threads when pinning, the affinity of the calling thread is left unchanged
+//
+void hostCopy(const int method, const size_t bytes, const void* data_in, void* data_out,
+  const int numThread=1, const bool pin=false);
+
+#endif // HOSTMEMCPY_H
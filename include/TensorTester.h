@@ -24,6 +24,8 @@ SOFTWARE.
 *******************************************************************************/
 #ifndef TENSORTESTER_H
 #define TENSORTESTER_H
+#include <cstddef>
+#include <vector>
 #include "cuttTypes.h"
 
 //
@@ -36,6 +38,16 @@ struct TensorError_t {
   unsigned int pos;
 };
 
+// Mismatch found by TensorTester::checkTransposeHost()
+struct TensorErrorHost_t {
+  unsigned int refVal;
+  unsigned int dataVal;
+  size_t pos;
+};
+
+// Number of mismatches after which TensorTester::checkTransposeHost() stops by default
+const int TENSOR_TESTER_MAX_ERROR = 10;
+
 class TensorTester {
 private:
   static int calcTensorConv(const int rank, const int* dim, const int* permutation, TensorConv* tensorConv);
@@ -57,6 +69,18 @@ public:
   
   template<typename T> bool checkTranspose(int rank, int* dim, int* permutation, T* data);
 
+  //
+  // Host versions of the above for data in host memory. They need no GPU and run on numThread
+  // threads (0 = cuttNumThreads()). checkTransposeHost() stops once the first maxError mismatches
+  // (in order of position) are known. They are returned in errors, or printed if errors is NULL.
+  // With maxError <= 0 it stops at the first mismatch and returns or prints none, but still fails
+  //
+  static void setTensorCheckPatternHost(unsigned int* data, size_t ndata, int numThread=0);
+
+  template<typename T> static bool checkTransposeHost(int rank, const int* dim, const int* permutation,
+    const T* data, std::vector<TensorErrorHost_t>* errors=NULL,
+    int maxError=TENSOR_TESTER_MAX_ERROR, int numThread=0);
+
 };
 
 #endif // TENSORTESTER_H
@@ -50,6 +50,29 @@ typedef enum CUTT_API cuttResult_t {
   CUTT_UNDEFINED_ERROR,    // Undefined error
 } cuttResult;
 
+// Execution statistics, see cuttGetStats()
+typedef struct CUTT_API cuttStats_t {
+  unsigned long long numExecute;  // Number of executions
+  unsigned long long numBytes;    // Bytes read and written by the executions
+  unsigned long long numTimed;    // Number of executions whose time is included in seconds
+  double seconds;                 // GPU time (wall-clock time for host plans) of the timed executions in seconds
+} cuttStats;
+
+// Placement of host plan threads and output pages on NUMA nodes, see cuttHostOptions
+typedef enum CUTT_API cuttHostPlacement_t {
+  CUTT_HOST_PLACEMENT_NONE,         // Left to the operating system
+  CUTT_HOST_PLACEMENT_FIRST_TOUCH,  // Threads spread over the nodes write the output pages they touched first
+  CUTT_HOST_PLACEMENT_INTERLEAVE,   // Threads spread over the nodes, output pages interleaved over them
+  CUTT_HOST_PLACEMENT_NODE_MASK,    // As CUTT_HOST_PLACEMENT_FIRST_TOUCH, on the nodes of nodeMask only
+} cuttHostPlacement;
+
+// Options of host plans, see cuttPlanHostWithOptions()
+typedef struct CUTT_API cuttHostOptions_t {
+  int numThread;                  // Number of threads (0 = environment variable CUTT_NUM_THREADS)
+  cuttHostPlacement placement;    // Placement of threads and output pages
+  unsigned long long nodeMask;    // Nodes of CUTT_HOST_PLACEMENT_NODE_MASK, bit i = node i
+} cuttHostOptions;
+
 // Initializes cuTT
 //
 // This is only needed for the Umpire allocator's lifetime management:
@@ -98,6 +121,157 @@ cuttResult CUTT_API cuttPlan(cuttHandle* handle, int rank, const int* dim, const
 cuttResult CUTT_API cuttPlanMeasure(cuttHandle* handle, int rank, const int* dim, const int* permutation, size_t sizeofType,
   cudaStream_t stream, const void* idata, void* odata, const void* alpha = NULL, const void* beta = NULL);
 
+//
+// Create plan within a planning time budget. Candidate implementations are evaluated in the
+// order Trivial, Tiled, TiledCopy, Packed, and PackedSplit with the fewest splits first. When the
+// time is up, the best implementation evaluated so far is chosen. At least one is always evaluated
+//
+// Parameters
+// handle            = Returned handle to cuTT plan
+// rank              = Rank of the tensor
+// dim[rank]         = Dimensions of the tensor
+// permutation[rank] = Transpose permutation
+// sizeofType        = Size of the elements of the tensor in bytes (=4 or 8)
+// stream            = CUDA stream (0 if no stream is used)
+// maxSeconds        = Planning time budget in seconds
+// complete          = If not NULL, returns true if all candidates were evaluated, i.e. the plan
+//                     is the same as with cuttPlan()
+//
+// Returns
+// Success/unsuccess code
+//
+cuttResult CUTT_API cuttPlanWithBudget(cuttHandle* handle, int rank, const int* dim, const int* permutation,
+  size_t sizeofType, cudaStream_t stream, double maxSeconds, bool* complete = NULL);
+
+//
+// Create plans for many problems at once. Identical problems are planned only once,
+// and the candidate plans of all problems are evaluated on a pool of threads
+// (environment variable CUTT_NUM_THREADS, default is the number of hardware threads).
+// Each problem gets its own handle, which is destroyed with cuttDestroy()
+//
+// Parameters
+// count                           = Number of problems
+// handles[count]                  = Returned handles to cuTT plans
+// ranks[count]                    = Ranks of the tensors
+// dims[count][ranks[i]]           = Dimensions of the tensors
+// permutations[count][ranks[i]]   = Transpose permutations
+// sizeofTypes[count]              = Sizes of the elements of the tensors in bytes (=4 or 8)
+// stream                          = CUDA stream (0 if no stream is used)
+//
+// Returns
+// Success/unsuccess code. On failure no plans are created
+//
+cuttResult CUTT_API cuttPlanMany(int count, cuttHandle* handles, const int* ranks, const int* const* dims,
+  const int* const* permutations, const size_t* sizeofTypes, cudaStream_t stream);
+
+//
+// Update plan for new dimensions of the tensor. The permutation, element size and stream stay
+// the same. The rank reduction of the plan is reused. If the new dimensions allow the same kinds
+// of candidate implementations as before, only those that were estimated to be competitive are
+// evaluated again, otherwise all of them are, as in cuttPlan(). The implementation is chosen by
+// heuristics, also for plans created by cuttPlanMeasure()
+//
+// Parameters
+// handle            = Handle to the cuTT plan
+// dim[rank]         = New dimensions of the tensor
+//
+// Returns
+// Success/unsuccess code. On failure the plan is unchanged
+//
+cuttResult CUTT_API cuttPlanUpdateDims(cuttHandle handle, const int* dim);
+
+//
+// Create plan for the inverse transpose: from the output of the plan, dimensions permuted,
+// back to its input. The candidate implementations are derived from the ones of the plan,
+// with Mm and Mk trading places, and their costs are evaluated for the inverse. Only those that
+// were estimated to be competitive for the plan are evaluated, unless the inverse allows a
+// different set of candidates. The new plan uses the same element size and stream
+//
+// Parameters
+// handle            = Handle to the cuTT plan
+// invHandle         = Returned handle to the inverse plan
+//
+// Returns
+// Success/unsuccess code
+//
+cuttResult CUTT_API cuttPlanInverse(cuttHandle handle, cuttHandle* invHandle);
+
+//
+// Create plan for transposing tensors in host memory on the CPU. The plan is executed with
+// cuttExecute() on host pointers, which returns once the output is written, and destroyed
+// with cuttDestroy(). A plan must not be destroyed while it is being executed. Host plans are
+// included in the memory and statistics reports, but not in workload capture (CUTT_CAPTURE_FILE),
+// which is replayed on the GPU
+//
+// Parameters
+// handle            = Returned handle to cuTT plan
+// rank              = Rank of the tensor
+// dim[rank]         = Dimensions of the tensor
+// permutation[rank] = Transpose permutation
+// sizeofType        = Size of the elements of the tensor in bytes (=4 or 8)
+// numThread         = Number of threads (0 = environment variable CUTT_NUM_THREADS, default is
+//                     the number of hardware threads)
+//
+// Returns
+// Success/unsuccess code
+//
+cuttResult CUTT_API cuttPlanHost(cuttHandle* handle, int rank, const int* dim, const int* permutation,
+  size_t sizeofType, int numThread);
+
+//
+// Create plan for transposing tensors in host memory and choose the loop nest by measuring the
+// ones the host cost model ranks best
+//
+// Parameters
+// handle            = Returned handle to cuTT plan
+// rank              = Rank of the tensor
+// dim[rank]         = Dimensions of the tensor
+// permutation[rank] = Transpose permutation
+// sizeofType        = Size of the elements of the tensor in bytes (=4 or 8)
+// numThread         = Number of threads (0 = environment variable CUTT_NUM_THREADS, default is
+//                     the number of hardware threads)
+// idata             = Input data size product(dim), in host memory
+// odata             = Output data size product(dim), in host memory
+//
+// Returns
+// Success/unsuccess code
+//
+cuttResult CUTT_API cuttPlanHostMeasure(cuttHandle* handle, int rank, const int* dim, const int* permutation,
+  size_t sizeofType, int numThread, const void* idata, void* odata);
+
+//
+// Create plan for transposing tensors in host memory with options. With a NUMA placement, every
+// thread is bound to a node and always writes the same part of the output, contiguous as far as the
+// permutation allows, so that the output pages it touched first are local to it
+//
+// Parameters
+// handle            = Returned handle to cuTT plan
+// rank              = Rank of the tensor
+// dim[rank]         = Dimensions of the tensor
+// permutation[rank] = Transpose permutation
+// sizeofType        = Size of the elements of the tensor in bytes (=4 or 8)
+// options           = Options, NULL means numThread = 0 and CUTT_HOST_PLACEMENT_NONE
+//
+// Returns
+// Success/unsuccess code
+//
+cuttResult CUTT_API cuttPlanHostWithOptions(cuttHandle* handle, int rank, const int* dim, const int* permutation,
+  size_t sizeofType, const cuttHostOptions* options);
+
+//
+// Place the pages of output odata of host plan: zeros are written to them by the threads that write
+// them in cuttExecute(), after interleaving them for CUTT_HOST_PLACEMENT_INTERLEAVE. The operating
+// system places only pages that were not written before, so call this on freshly allocated memory
+//
+// Parameters
+// handle            = Handle to host plan
+// odata             = Output data size product(dim), in host memory
+//
+// Returns
+// Success/unsuccess code
+//
+cuttResult CUTT_API cuttHostTouch(cuttHandle handle, void* odata);
+
 //
 // Destroy plan
 //
@@ -124,5 +298,100 @@ cuttResult CUTT_API cuttDestroy(cuttHandle handle);
 //
 cuttResult CUTT_API cuttExecute(cuttHandle handle, const void* idata, void* odata, const void* alpha = NULL, const void* beta = NULL);
 
+//
+// Report memory used by a plan. Host memory includes the analysis record
+// (host copies of the constant tables and performance model counters) unless it was trimmed.
+// It also includes the plan structure in full, even when the structure is shared with other
+// plans, as for duplicate problems in cuttPlanMany()
+//
+// Parameters
+// handle            = Handle to the cuTT plan
+// hostBytes         = Returned bytes of host memory
+// deviceBytes       = Returned bytes of device memory
+//
+// Returns
+// Success/unsuccess code
+//
+cuttResult CUTT_API cuttPlanMemory(cuttHandle handle, size_t* hostBytes, size_t* deviceBytes);
+
+//
+// Trim plan: drop its analysis record, or for host plans the candidate loop nests kept for
+// measuring. The plan can still be executed
+//
+// Parameters
+// handle            = Handle to the cuTT plan
+//
+// Returns
+// Success/unsuccess code
+//
+cuttResult CUTT_API cuttPlanTrim(cuttHandle handle);
+
+//
+// Report memory used by all plans. A plan structure shared by several plans is counted once
+//
+// Parameters
+// numPlan           = Returned number of plans
+// hostBytes         = Returned bytes of host memory
+// deviceBytes       = Returned bytes of device memory
+//
+// Returns
+// Success/unsuccess code
+//
+cuttResult CUTT_API cuttPlanMemoryTotal(size_t* numPlan, size_t* hostBytes, size_t* deviceBytes);
+
+//
+// Trim all plans, see cuttPlanTrim()
+//
+// Returns
+// Success/unsuccess code
+//
+cuttResult CUTT_API cuttPlanTrimAll();
+
+//
+// Turn recording of trace spans (planning phases, plan activation and execution) on or off.
+// Recording is also turned on by setting environment variable CUTT_TRACE_FILE, in which case
+// the trace is written into that file at exit. No-op if cuTT is built without ENABLE_TRACE
+//
+void CUTT_API cuttTraceEnable(bool enable);
+
+//
+// Write the recorded trace spans in Chrome trace-event JSON format (chrome://tracing, Perfetto).
+// Must not be called while other threads use cuTT
+//
+// Parameters
+// fileName          = Name of the file to write
+//
+// Returns
+// Success/unsuccess code. CUTT_INVALID_PARAMETER if the file cannot be written or cuTT is built
+// without ENABLE_TRACE
+//
+cuttResult CUTT_API cuttTraceWrite(const char* fileName);
+
+//
+// Turn collection of execution statistics on or off. Collection is also turned on by setting
+// environment variable CUTT_STATS=1. Plans executed while collection is off are not counted
+//
+void CUTT_API cuttStatsEnable(bool enable);
+
+//
+// Get execution statistics of a plan. GPU time is measured with CUDA events without synchronizing,
+// executions that have not completed yet are counted in numExecute but not in numTimed. Host plans
+// are timed with the wall clock, every execution is counted in numTimed
+//
+// Parameters
+// handle            = Handle to the cuTT plan
+// stats             = Returned statistics
+//
+// Returns
+// Success/unsuccess code
+//
+cuttResult CUTT_API cuttGetStats(cuttHandle handle, cuttStats* stats);
+
+//
+// Get execution statistics summed over all plans, including destroyed ones.
+// numPlan returns the number of plans in use
+//
+cuttResult CUTT_API cuttGetStatsTotal(size_t* numPlan, cuttStats* stats);
+
 #endif // CUTT_H
 
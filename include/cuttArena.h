@@ -0,0 +1,109 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CUTTARENA_H
+#define CUTTARENA_H
+
+#include <cstddef>
+#include <vector>
+
+//
+// Scratch memory for planning. Memory is handed out from large blocks by bumping an offset
+// and is given back in stack order, so that planning does no heap allocation once the
+// blocks have grown to the size the largest plan needs.
+// Each thread has its own arena, see planArena()
+//
+class PlanArena {
+public:
+  // Alignment of all allocations, enough for any int_vector
+  static const size_t ALIGN = 64;
+
+  // Position in the arena, see getMark() and rewind()
+  struct Mark {
+    int block;
+    size_t offset;
+  };
+
+private:
+  struct Block {
+    char* ptr;
+    size_t size;
+  };
+  std::vector<Block> blocks;
+  // Current block and offset within it
+  int cur;
+  size_t offset;
+  // Bytes currently handed out and the largest this has been
+  size_t used;
+  size_t highWater;
+
+  void* allocBytes(size_t bytes);
+
+public:
+  PlanArena();
+  ~PlanArena();
+
+  PlanArena(const PlanArena&) = delete;
+  PlanArena& operator=(const PlanArena&) = delete;
+
+  // Returns uninitialized memory for n objects of type T
+  template <typename T> T* alloc(const size_t n) {
+    return (T *)allocBytes(n*sizeof(T));
+  }
+
+  Mark getMark() const;
+
+  // Releases everything allocated after mark was taken
+  void rewind(const Mark& mark);
+
+  // Releases everything, must not be called while memory is in use. If memory is spread over several blocks, they are replaced
+  // with a single block large enough for the high-water mark
+  void reset();
+
+  // Bytes reserved from the system
+  size_t capacity() const;
+
+  // Bytes currently handed out
+  size_t getUsed() const {return used;}
+
+  // Largest number of bytes handed out at once
+  size_t getHighWater() const {return highWater;}
+};
+
+// Arena of the calling thread
+PlanArena& planArena();
+
+//
+// Returns the memory allocated from the arena during the lifetime of this object
+//
+class PlanArenaScope {
+private:
+  PlanArena& arena;
+  const PlanArena::Mark mark;
+public:
+  PlanArenaScope(PlanArena& arena=planArena()) : arena(arena), mark(arena.getMark()) {}
+  ~PlanArenaScope() {arena.rewind(mark);}
+};
+
+#endif // CUTTARENA_H
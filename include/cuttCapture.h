@@ -0,0 +1,49 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CUTTCAPTURE_H
+#define CUTTCAPTURE_H
+
+#include "cuttplan.h"
+
+//
+// Workload capture.
+//
+// When environment variable CUTT_CAPTURE_FILE is set, every plan made and every execution is
+// counted by problem: dimensions, permutation, element size, and for executions alpha and beta.
+// At exit, one row per problem and event ("plan" or "execute") with its count is appended to the
+// CSV file CUTT_CAPTURE_FILE points to. The mix is re-run with cutt_bench -replay. Only GPU plans
+// are captured, host plans (cuttPlanHost()) are not
+//
+
+// Returns true if capture is enabled
+bool cuttCaptureEnabled();
+
+// Counts plan made for a handle
+void cuttCaptureRecordPlan(const cuttPlan_t& plan);
+
+// Counts execution of plan. alpha and beta as passed to cuttExecute()
+void cuttCaptureRecordExecute(const cuttPlan_t& plan, const void* alpha, const void* beta);
+
+#endif // CUTTCAPTURE_H
@@ -0,0 +1,89 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CUTTCPUMODEL_H
+#define CUTTCPUMODEL_H
+
+#include <cstddef>
+#include "cuttHost.h"
+
+//
+// Host cost model, the counterpart of cuttGpuModel for host plans. Cache lines moved per side
+// are counted with computePos0() and countCacheLines() on sampled leaf blocks. TLB misses are
+// estimated from the pages spanned by the strided side, the hardware prefetcher is assumed to
+// follow rows of at least two cache lines when there are not too many of them at once, and
+// threads share the memory bandwidth. Small blocks are counted over a window of consecutive blocks,
+// which makes the estimate depend on the loop order of Mbar
+//
+
+// Properties of the host CPU used by the model
+struct HostModelProp {
+  int lineBytes;
+  int pageBytes;
+  size_t l1Bytes;
+  size_t l2Bytes;
+  // Entries of the first level data TLB
+  int tlbEntries;
+  // Number of streams followed by the hardware prefetcher
+  int prefetchStreams;
+  // Copy bandwidth of one core and of the whole memory system
+  double coreGBs;
+  double memGBs;
+  // Cost of a TLB miss, of a call of the leaf kernel, and of starting a block
+  double tlbMissNs;
+  double leafNs;
+  double itemNs;
+};
+
+//
+// Properties of this CPU. Cache sizes are detected with sysconf() where available, the rest are
+// typical values. Memory bandwidth can be set with environment variable CUTT_HOST_GBS, for example
+// to the host copy bandwidth reported by cutt_bench -hostmemcpy
+//
+const HostModelProp& hostModelProp();
+
+// Counters of a host plan, per element of the tensor
+struct HostPlanCounters {
+  // Cache lines moved from (input) and to (output) memory
+  double linesIn;
+  double linesOut;
+  // TLB misses
+  double tlbIn;
+  double tlbOut;
+  // True if the hardware prefetcher follows the accesses
+  bool prefetchIn;
+  bool prefetchOut;
+  // Calls of the leaf kernel
+  double leafs;
+  // Blocks handed out to threads
+  double items;
+};
+
+void countHostPlan(const cuttHostPlan_t& plan, const HostModelProp& prop, HostPlanCounters& counters);
+
+// Estimated execution time of plan in seconds
+double secondsHostPlan(const cuttHostPlan_t& plan, const HostModelProp& prop, const HostPlanCounters& counters);
+double secondsHostPlan(const cuttHostPlan_t& plan, const HostModelProp& prop);
+
+#endif // CUTTCPUMODEL_H
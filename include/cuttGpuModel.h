@@ -28,7 +28,78 @@ SOFTWARE.
 #include <vector>
 #include "cuttTypes.h"
 #include "cuttplan.h"
-#include "int_vector.h"
+#include "cuttGpuModelVec.h"
+#include "cuttArena.h"
+
+// Maximum number of Mbar positions sampled by countCycles()
+const int MBAR_SAMPLE_MAX = 64;
+// Relative standard error of the mean number of transactions per Mbar position
+// at which sampling is considered converged
+const double MBAR_SAMPLE_TOL = 0.05;
+
+//
+// Chooses the Mbar positions for which memory transactions are counted.
+// If volume is at most numSampleMin (rounded up to cpuVectorLen()), every position is visited once.
+// Otherwise positions are drawn from a low-discrepancy (golden ratio) sequence over [0, vol)
+// so that every prefix covers the range evenly. Sampling stops after at least numSampleMin
+// positions when the relative standard error of the mean is below tol, or at numSampleMax positions.
+//
+class MbarSampler {
+private:
+  int vol;
+  int numSampleMin;
+  int numSampleMax;
+  double tol;
+  bool exact;
+  // Number of positions drawn at a time
+  int batchLen;
+  // Number of positions drawn so far
+  int numDrawn;
+  // Running statistics (Welford) of the values added
+  int num;
+  double mean;
+  double m2;
+
+public:
+  MbarSampler(const int vol_in, const int numSampleMin_in,
+    const int numSampleMax_in=MBAR_SAMPLE_MAX, const double tol_in=MBAR_SAMPLE_TOL);
+
+  // Fills pos[] with the next batch of positions and returns their number, 0 when sampling is done
+  int next(int pos[CPU_VECTOR_LEN_MAX]);
+
+  // Adds value (number of transactions) measured at one position
+  void add(const int val);
+
+  // True if all positions are visited
+  bool isExact() const {return exact;}
+
+  // Number of values added
+  int count() const {return num;}
+
+  // Mean of the values added
+  double getMean() const {return mean;}
+
+  // Variance of the mean, zero when all positions were visited
+  double getVariance() const;
+
+  bool converged() const;
+};
+
+// Instruction set used by the vectorized model kernels ("AVX512", "AVX2", "NEON", ...)
+const char* cpuVectorType();
+
+// Number of Mbar positions the vectorized model kernels process at once
+int cpuVectorLen();
+
+// Selects the instruction set by name. Returns false if it is not available on this CPU
+bool setCpuVectorType(const char* type);
+
+// Number of full and partial cache lines (of cacheWidth elements) accessed at monotonically
+// increasing cache line numbers seg[0 ... n-1]
+void countCacheLines(const int* seg, const int n, const int cacheWidth, int& cl_full, int& cl_part);
+
+// Same as above for n contiguous elements starting at pos
+void countCacheLines(const int pos, const int n, const int cacheWidth, int& cl_full, int& cl_part);
 
 void computePos(const int vol0, const int vol1,
   const TensorConvInOut* conv, const int numConv,
@@ -38,22 +109,74 @@ void computePos0(const int vol,
   const TensorConvInOut* conv, const int numConv,
   int* posIn, int* posOut);
 
+// Size of the position tables above which countCycles() drops the cached tables
+const size_t POS_TABLE_CACHE_MAX_BYTES = 64*1024*1024;
+
+//
+// Memo of computePos0() position tables. Candidate plans of the same problem share Mmk
+// decompositions, or at least their leading ranks. Input and output positions are cached as
+// separate tables keyed by the (d, ct) sequence of that side. A table whose first k ranks match
+// a cached table is built from the first d_0*...*d_(k-1) entries of the cached table plus an
+// offset per block, instead of being stepped through element by element.
+// Each thread has its own cache, see posTableCache()
+//
+class PosTableCache {
+private:
+  struct Entry {
+    int vol;
+    int numConv;
+    const int* d;
+    const int* ct;
+    const int* pos;
+  };
+  PlanArena arena;
+  std::vector<Entry> entries;
+  long long numHit;
+  long long numPrefix;
+  long long numMiss;
+
+  const int* getSide(const int vol, const int numConv, const int* d, const int* ct);
+
+public:
+  PosTableCache() : numHit(0), numPrefix(0), numMiss(0) {}
+
+  // Returns the tables computePos0(vol, conv, numConv, posIn, posOut) would compute.
+  // Tables stay valid until clear() or trim()
+  void get(const int vol, const TensorConvInOut* conv, const int numConv,
+    const int*& posIn, const int*& posOut);
+
+  // Drops all tables
+  void clear();
+
+  // Drops all tables if they use more than maxBytes. Must not be called while tables are in use
+  void trim(const size_t maxBytes);
+
+  // Number of tables found in the cache, built from a cached prefix, and computed from scratch
+  long long getNumHit() const {return numHit;}
+  long long getNumPrefix() const {return numPrefix;}
+  long long getNumMiss() const {return numMiss;}
+};
+
+// Cache of the calling thread
+PosTableCache& posTableCache();
+
 void computePosRef(int vol0, int vol1,
   std::vector<TensorConvInOut>::iterator it0, std::vector<TensorConvInOut>::iterator it1,
   std::vector<int>& posIn, std::vector<int>& posOut);
 
 void countPackedGlTransactions(const int warpSize, const int accWidth, const int cacheWidth,
   const int numthread, const int posMbarIn, const int posMbarOut, const int volMmk, 
-  std::vector<int>& posMmkIn, std::vector<int>& posMmkOut,
+  const int* posMmkIn, const int* posMmkOut,
   int& gld_tran, int& gst_tran, int& gld_req, int& gst_req,
   int& cl_full_l2, int& cl_part_l2, int& cl_full_l1, int& cl_part_l1);
 
 void countPackedGlTransactions0(const int warpSize, const int accWidth, const int cacheWidth,
   const int numthread, 
-  const int numPos, const int posMbarIn[INT_VECTOR_LEN], const int posMbarOut[INT_VECTOR_LEN],
+  const int numPos, const int posMbarIn[CPU_VECTOR_LEN_MAX], const int posMbarOut[CPU_VECTOR_LEN_MAX],
   const int volMmk,  const int* __restrict__ posMmkIn, const int* __restrict__ posMmkOut,
   int& gld_tran, int& gst_tran, int& gld_req, int& gst_req,
-  int& cl_full_l2, int& cl_part_l2, int& cl_full_l1, int& cl_part_l1);
+  int& cl_full_l2, int& cl_part_l2, int& cl_full_l1, int& cl_part_l1,
+  int* tranPos=NULL);
 
 void countPackedShTransactions(const int warpSize, const int bankWidth, const int numthread,
   const int volMmk, const TensorConv* msh, const int numMsh,
@@ -67,12 +190,18 @@ void countPackedShTransactionsRef(const int warpSize, const int bankWidth, const
   const int volMmk, const TensorConv* msh, const int numMsh,
   int& sld_tran, int& sst_tran, int& sld_req, int& sst_req);
 
-void countTiledGlTransactions(const bool leadVolSame,
-  const int numPosMbarSample, const int volMm, const int volMk, const int volMbar,
+void countTiledGlTransactions(const bool isCopy,
+  const int volMm, const int volMk, const int volMbar,
   const int cIn, const int cOut, const int accWidth, const int cacheWidth,
   std::vector<TensorConvInOut>& hostMbar, const int sizeMbar,
   int& num_iter, float& mlp, int& gld_tran, int& gst_tran, int& gld_req, int& gst_req, int& cl_full, int& cl_part);
 
+void countTiledGlTransactionsRef(const bool isCopy,
+  const int volMm, const int volMk, const int volMbar,
+  const int cIn, const int cOut, const int accWidth, const int cacheWidth,
+  std::vector<TensorConvInOut>& hostMbar, const int sizeMbar,
+  int& gld_tran, int& gst_tran, int& gld_req, int& gst_req, int& cl_full, int& cl_part);
+
 double cyclesPacked(const bool isSplit, const size_t sizeofType, cudaDeviceProp& prop,
   int nthread, int numActiveBlock, float mlp, 
   int gld_req, int gst_req, int gld_tran, int gst_tran,
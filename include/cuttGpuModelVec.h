@@ -0,0 +1,60 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CUTTGPUMODELVEC_H
+#define CUTTGPUMODELVEC_H
+
+//
+// Vectorized CPU kernels of the GPU model.
+// src/cuttGpuModelVec.cpp is compiled once for each supported vector instruction set
+// (see src/isa/) and the widest one supported by the running CPU is chosen at runtime.
+//
+
+// Maximum vector length over all instruction sets, in ints
+const int CPU_VECTOR_LEN_MAX = 16;
+
+struct CpuVectorKernels {
+  // Name of the instruction set
+  const char* type;
+  // Vector length in ints
+  int len;
+  // Counts global memory transactions and cache lines for numPos <= CPU_VECTOR_LEN_MAX Mbar positions.
+  // Results are returned per position. work is scratch space for volMmk*len ints, aligned to 64 bytes
+  void (*countPackedGlTransactions)(const int accWidth, const int cacheWidth,
+    const int numPos, const int* posMbarIn, const int* posMbarOut,
+    const int volMmk, const int* posMmkIn, const int* posMmkOut,
+    int* gld_tran, int* gst_tran, int* cl_full, int* cl_part, void* work);
+  // Returns the number of shared memory load transactions for numWarp warps of warpSize <= 32 threads.
+  // Bank bits are stored len warps at a time, see cuttGpuModelVec.cpp
+  int (*countPackedShTransactions)(const int warpSize, const int numWarp, const int* bankBit);
+};
+
+// Compiled with the default compiler flags
+extern const CpuVectorKernels cpuVectorKernelsNative;
+#ifdef CUTT_INT_VECTOR_DISPATCH
+extern const CpuVectorKernels cpuVectorKernelsAVX2;
+extern const CpuVectorKernels cpuVectorKernelsAVX512;
+#endif
+
+#endif // CUTTGPUMODELVEC_H
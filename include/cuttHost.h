@@ -0,0 +1,177 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CUTTHOST_H
+#define CUTTHOST_H
+
+#include <vector>
+#include <cstddef>
+#include "cutt.h"          // cuttHostPlacement
+#include "cuttTypes.h"
+
+//
+// Host (CPU) transpose engine.
+// After rank reduction, input dimension 0 ("Mm") is contiguous in the input and input dimension
+// permutation[0] ("Mk") is contiguous in the output. Their two-dimensional block is transposed in
+// leaf blocks, either by recursively halving the larger extent until the block fits the leaf, so
+// that every level of the cache hierarchy is used without knowing its size, or by plain loops over
+// the leaf blocks. The remaining dimensions ("Mbar") are iterated with the same TensorConvInOut
+// decomposition as in the GPU kernels, in a loop order of their own. If permutation[0] = 0,
+// dimension 0 is contiguous on both sides and is copied as a whole. setup() searches loop orders of
+// Mbar, leaf blocks, and blocks for threads with the host cost model (cuttCpuModel.h), measure()
+// times the best of them. With a NUMA placement, threads are bound to nodes and get fixed ranges of
+// blocks, and the outermost loop of Mbar is the one with the largest output stride, so that each
+// thread writes a contiguous part of the output as far as possible
+//
+
+// Largest extent of the leaf blocks, in elements
+const int HOST_LEAF_DIM = 32;
+// Largest extent of the blocks handed out to threads, in elements
+const int HOST_TILE_DIM = 512;
+// Largest number of elements of the copy blocks handed out to threads
+const int HOST_COPY_TILE = 65536;
+// All loop orders of Mbar are searched up to this many Mbar dimensions, a few heuristic ones above
+const int HOST_ORDER_ALL = 4;
+// Number of loop nests timed by measure()
+const int HOST_MEASURE_NEST = 4;
+
+enum HostMethod {
+  // Copy of dimension 0, permutation[0] = 0
+  HostCopy,
+  // Leaf blocks visited by recursive halving
+  HostRecursive,
+  // Leaf blocks visited by loops, Mk inner
+  HostBlocked,
+  NumHostMethods
+};
+
+const char* hostMethodName(const int method);
+
+// How a host plan is executed
+struct HostLoopNest {
+  int method;
+  // Extent of the leaf blocks, leafMk is 1 for copy
+  int leafMm;
+  int leafMk;
+  // Extent of the blocks handed out to threads
+  int tileMm;
+  int tileMk;
+  // Loop order of Mbar, reduced input dimensions from the innermost loop out
+  std::vector<int> order;
+};
+
+class cuttHostPlan_t {
+public:
+  // Reduced rank, dimensions, and permutation
+  int rank;
+  std::vector<int> dim;
+  std::vector<int> permutation;
+
+  size_t sizeofType;
+  int numThread;
+
+  // Placement on NUMA nodes, and the node (index in hostNumaNodes()) of each thread. threadNode
+  // is empty for CUTT_HOST_PLACEMENT_NONE
+  cuttHostPlacement placement;
+  std::vector<int> threadNode;
+
+  // True if dimension 0 is contiguous in both input and output
+  bool isCopy;
+
+  // Extents of Mm and Mk. Mk is 1 for copy plans
+  int volMm;
+  int volMk;
+  // Input stride of Mk and output stride of Mm
+  int strideMkIn;
+  int strideMmOut;
+  // Input and output stride of each reduced dimension
+  std::vector<int> strideIn;
+  std::vector<int> strideOut;
+
+  // Mbar in the loop order of nest, innermost loop first. c_out = c_in and d_out = d_in
+  int volMbar;
+  std::vector<TensorConvInOut> mbar;
+
+  HostLoopNest nest;
+  // Execution time estimated by the host cost model
+  double modelSeconds;
+  // Loop nests timed by measure(), the one with the smallest estimated time first. Dropped by
+  // dropAnalysis()
+  std::vector<HostLoopNest> candidates;
+
+  // Execution statistics, see cuttGetStats(). Updated by cuttExecute() under the plan storage lock
+  cuttStats stats;
+
+  // Sets up plan and chooses the loop nest with the host cost model. numThread = 0 means
+  // cuttNumThreads(), nodeMask is used with CUTT_HOST_PLACEMENT_NODE_MASK. Returns false for bad input
+  bool setup(const int rank_in, const int* dim_in, const int* permutation_in, const size_t sizeofType_in,
+    const int numThread_in, const cuttHostPlacement placement_in=CUTT_HOST_PLACEMENT_NONE,
+    const unsigned long long nodeMask=0);
+
+  // Sets loop nest. Blocks for threads are at most tileMm x tileMk (default size if <= 0), and smaller
+  // if needed for numThread. An empty order keeps the current loop order. Returns false if the
+  // method or the loop order does not apply to the plan
+  bool setLoopNest(const HostLoopNest& nest_in);
+  // Sets loop nest with the given method and leaf blocks, default blocks for threads and current
+  // loop order
+  bool setLoopNest(const int method, const int leafMm, const int leafMk);
+
+  // Writes zeros to out as execute() does, after interleaving its pages for
+  // CUTT_HOST_PLACEMENT_INTERLEAVE
+  void touch(void* out) const;
+
+  // Times the candidate loop nests on in and out, which must not overlap, and keeps the fastest.
+  // Returns its time in seconds
+  double measure(const void* in, void* out);
+
+  // out = alpha*in + beta*out, with alpha and beta of float (sizeofType = 4) or double (= 8) type.
+  // alpha = NULL means 1 and beta = NULL means 0
+  void execute(const void* in, void* out, const void* alpha=NULL, const void* beta=NULL) const;
+
+  // Number of blocks handed out to threads
+  long long numItem() const;
+
+  // Bytes read and written by execute(), which also reads out if readOut is true
+  size_t executeBytes(const bool readOut) const;
+
+  // Drops the candidate loop nests, measure() then times only the current one. The plan can still
+  // be executed
+  void dropAnalysis();
+
+  // Bytes of host memory used
+  size_t memoryUsage() const;
+
+  void print() const;
+
+private:
+  bool setPlacement(const cuttHostPlacement placement_in, const unsigned long long nodeMask);
+  void setLoopOrder(const std::vector<int>& order);
+  void loopOrders(std::vector< std::vector<int> >& orders) const;
+  void blockShapes(std::vector<HostLoopNest>& blocks) const;
+  template <typename T, typename Op> void executeOp(const T* in, T* out, const Op& op) const;
+  template <typename T, typename U> void executeScaled(const void* in, void* out, const void* alpha,
+    const void* beta) const;
+};
+
+#endif // CUTTHOST_H
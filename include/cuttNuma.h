@@ -0,0 +1,57 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CUTTNUMA_H
+#define CUTTNUMA_H
+
+#include <cstddef>
+#include <vector>
+
+//
+// NUMA topology of the host and placement of threads and pages, for host plans. Uses the Linux
+// system interfaces directly. Elsewhere, or without the information, the host is one node with
+// all CPUs and binding and placement do nothing
+//
+
+struct HostNumaNode {
+  int id;
+  std::vector<int> cpus;
+};
+
+// Nodes of the host that have CPUs, in increasing order of id
+const std::vector<HostNumaNode>& hostNumaNodes();
+
+// Binds the calling thread to cpus. Returns false if not supported
+bool hostBindThread(const std::vector<int>& cpus);
+
+//
+// Interleaves the pages of [ptr, ptr + bytes) over the nodes of nodeMask (bit i = node i). Only
+// pages that are not yet touched are placed by the policy. Returns false if not supported
+//
+bool hostInterleave(void* ptr, const size_t bytes, const unsigned long long nodeMask);
+
+// Node of the page at ptr, or -1 if not known
+int hostPageNode(const void* ptr);
+
+#endif // CUTTNUMA_H
@@ -0,0 +1,61 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CUTTPARALLEL_H
+#define CUTTPARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//
+// Number of threads used for planning many problems at once. Set by environment
+// variable CUTT_NUM_THREADS, defaults to the number of hardware threads
+//
+int cuttNumThreads();
+
+//
+// Calls f(begin, end) for consecutive ranges [begin, end) of at most chunk indices
+// that together cover [0, n). Ranges are handed out to numThread threads in increasing
+// order, so that neighbouring indices tend to be processed by the same thread.
+// The calling thread is one of the threads; numThread <= 1 runs everything on it
+//
+template <typename F>
+void parallelFor(const int n, const int chunk, const int numThread, F f) {
+  std::atomic<int> next(0);
+  auto worker = [&]() {
+    int begin;
+    while ((begin = next.fetch_add(chunk)) < n) {
+      f(begin, std::min(begin + chunk, n));
+    }
+  };
+  int numWorker = std::min(numThread, (n - 1)/chunk + 1);
+  std::vector<std::thread> threads;
+  for (int i=1;i < numWorker;i++) threads.push_back(std::thread(worker));
+  worker();
+  for (int i=0;i < (int)threads.size();i++) threads[i].join();
+}
+
+#endif // CUTTPARALLEL_H
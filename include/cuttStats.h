@@ -0,0 +1,79 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CUTTSTATS_H
+#define CUTTSTATS_H
+
+#include <cuda_runtime.h>
+#include "cutt.h"
+
+// Number of executions of a plan whose GPU time can be pending at once. Executions started while
+// this many are pending are counted but not timed
+const int PLAN_STATS_MAX_PENDING = 8;
+
+//
+// Execution counters of a plan, see cuttGetStats(). GPU time is measured with a pair of CUDA
+// events recorded around each execution and read once the stop event has completed, so that
+// execution is never synchronized
+//
+class PlanStats {
+private:
+  cuttStats stats;
+
+  // Event pairs, created when first needed
+  cudaEvent_t startEvent[PLAN_STATS_MAX_PENDING];
+  cudaEvent_t stopEvent[PLAN_STATS_MAX_PENDING];
+  int numEvent;
+
+  // Pending pairs are first, first+1, ... (mod PLAN_STATS_MAX_PENDING)
+  int first;
+  int numPending;
+
+  // Pair recorded by begin(), -1 if the execution is not timed
+  int cur;
+
+public:
+  PlanStats();
+  ~PlanStats();
+  PlanStats(const PlanStats&) = delete;
+  PlanStats& operator=(const PlanStats&) = delete;
+
+  // Called before and after an execution on stream that reads and writes bytes in total
+  void begin(cudaStream_t stream);
+  void end(cudaStream_t stream, const size_t bytes);
+
+  // Adds the GPU time of the pending executions that have completed
+  void update();
+
+  // Counters including the executions completed so far
+  const cuttStats& get() {update(); return stats;}
+};
+
+// Adds counters b to a
+void addStats(cuttStats& a, const cuttStats& b);
+
+// True if statistics are collected, see cuttStatsEnable()
+bool statsEnabled();
+
+#endif // CUTTSTATS_H
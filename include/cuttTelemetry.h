@@ -0,0 +1,50 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CUTTTELEMETRY_H
+#define CUTTTELEMETRY_H
+
+#include <vector>
+#include <cuda_runtime.h>
+#include "cuttplan.h"
+
+//
+// Misprediction telemetry.
+//
+// When environment variable CUTT_TELEMETRY_FILE is set, every call to cuttPlanMeasure()
+// appends one row per candidate plan to the CSV file it points to. Each row contains the
+// tensor, the model counters and predicted cycles of the candidate, the measured time, and
+// flags that tell which candidate the heuristic would have picked and which one was measured
+// to be the fastest. The log is summarized with the cutt_telemetry tool.
+//
+
+// Returns true if telemetry is enabled
+bool cuttTelemetryEnabled();
+
+// Appends the results of one plan measurement into the telemetry log
+void cuttTelemetryRecord(const cudaDeviceProp& prop, const int rank, const int* dim, const int* permutation,
+  const size_t sizeofType, const PlanCandidates& plans, const std::vector<double>& times,
+  const int heurPlan, const int bestPlan);
+
+#endif // CUTTTELEMETRY_H
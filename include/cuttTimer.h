@@ -27,39 +27,57 @@ SOFTWARE.
 #define CUTTTIMER_H
 
 #include <vector>
+#include <string>
 #include <chrono>
 #include <cstdlib>
 #include <unordered_map>
 #include <set>
-// -------------------------------------------------
-// By default uses CUDA event timer. Comment out
-// this line if you want to use the wallclock 
-#define CUDA_EVENT_TIMER
-// -------------------------------------------------
-#ifdef CUDA_EVENT_TIMER
 #include <cuda_runtime.h>
-#endif
+
+// Clocks of Timer
+enum TimerClock {
+  // CUDA events recorded on the NULL stream, times device work. stop() waits for the device
+  TimerClockCudaEvent,
+  // std::chrono::steady_clock, times host work. No CUDA calls are made
+  TimerClockSteady,
+  // Time stamp counter (rdtsc on x86-64, cntvct_el0 on AArch64) calibrated against steady_clock,
+  // times short host work. Falls back to steady_clock on other CPUs. No CUDA calls are made
+  TimerClockTsc
+};
 
 //
 // Simple raw timer
 //
 class Timer {
 private:
-#ifdef CUDA_EVENT_TIMER
+  const TimerClock clock;
+  // TimerClockCudaEvent
   cudaEvent_t tmstart, tmend;
-#else
-  std::chrono::high_resolution_clock::time_point tmstart, tmend;
-#endif
+  // TimerClockSteady
+  std::chrono::steady_clock::time_point clockStart, clockEnd;
+  // TimerClockTsc
+  unsigned long long tscStart, tscEnd;
 public:
-#ifdef CUDA_EVENT_TIMER
-  Timer();
+  Timer(TimerClock clock_in=TimerClockCudaEvent);
   ~Timer();
-#endif
+  Timer(const Timer&) = delete;
+  Timer& operator=(const Timer&) = delete;
   void start();
   void stop();
   double seconds();
 };
 
+// Clock of Timer chosen by name ("event", "steady", or "tsc"). Returns false for unknown name
+bool timerClockFromName(const char* name, TimerClock& clock);
+
+// Value below which p percent (0...100) of sorted values are, linearly interpolated. 0 if empty
+double percentileSorted(const std::vector<double>& sorted, double p);
+
+// List of n integers as string "i0xi1x...", the dim and permutation fields of the CSV files
+// written and read by cuTT and its tools
+std::string intList(const int n, const int* val);
+inline std::string intList(const std::vector<int>& val) {return intList((int)val.size(), val.data());}
+
 //
 // Records timings for cuTT and gives out bandwidths and other data
 //
@@ -98,8 +116,17 @@ private:
   // Statistics for every rank
   std::unordered_map<int, Stat> stats;
 
+  // Every run in the order recorded
+  struct Sample {
+    std::vector<int> dim;
+    std::vector<int> permutation;
+    size_t bytes;
+    double seconds;
+  };
+  std::vector<Sample> samples;
+
 public:
-  cuttTimer(int sizeofType);
+  cuttTimer(int sizeofType, TimerClock clock=TimerClockCudaEvent);
   ~cuttTimer();
   void start(std::vector<int>& dim, std::vector<int>& permutation);
   void stop();
@@ -110,11 +137,17 @@ public:
   double getWorst(int rank);
   double getWorst(int rank, std::vector<int>& dim, std::vector<int>& permutation);
   double getMedian(int rank);
+  // Bandwidth below which p percent (0...100) of the runs for rank are, linearly interpolated.
+  // Percentiles of bandwidth are the complement of those of time: p1 of bandwidth is p99 of time
+  double getPercentile(int rank, double p);
   double getAverage(int rank);
   std::vector<double> getData(int rank);
 
   double getWorst(std::vector<int>& dim, std::vector<int>& permutation);
 
+  // Appends every run as a CSV row to fileName, input of cutt_compare
+  bool writeSamples(const char* fileName, const char* label);
+
   std::set<int>::const_iterator ranksBegin() {
     return ranks.begin();
   }
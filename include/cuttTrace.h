@@ -0,0 +1,75 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CUTTTRACE_H
+#define CUTTTRACE_H
+
+//
+// Tracing of planning and execution.
+//
+// Spans are recorded into a ring buffer of the calling thread, holding the last
+// TRACE_BUFFER_SIZE spans, and exported in Chrome trace-event JSON format that can be viewed
+// with chrome://tracing or Perfetto. Recording is enabled with cuttTraceEnable(), or by setting
+// environment variable CUTT_TRACE_FILE, in which case the trace is written into that file at exit.
+// When built with ENABLE_NVTOOLS, spans are also NVTX ranges.
+// Without ENABLE_TRACE and ENABLE_NVTOOLS the macros below compile to nothing.
+//
+
+// Number of spans kept per thread
+const int TRACE_BUFFER_SIZE = 64*1024;
+// Maximum nesting depth of spans, deeper spans are not recorded
+const int TRACE_MAX_DEPTH = 32;
+
+// Starts span name and returns the number of spans of the calling thread that were open before.
+// Name must be a string that lives until the trace is written, e.g. a literal
+int cuttTraceBegin(const char* name);
+
+// Ends the innermost span of the calling thread
+void cuttTraceEnd();
+
+// Ends spans of the calling thread until depth spans are open
+void cuttTraceEndTo(const int depth);
+
+// Span that ends at the end of the scope, together with any spans inside it that were left open
+class CuttTraceScope {
+private:
+  int depth;
+public:
+  CuttTraceScope(const char* name) {depth = cuttTraceBegin(name);}
+  ~CuttTraceScope() {cuttTraceEndTo(depth);}
+};
+
+#if defined(ENABLE_TRACE) || defined(ENABLE_NVTOOLS)
+#define CUTT_TRACE_CONCAT_(a, b) a##b
+#define CUTT_TRACE_CONCAT(a, b) CUTT_TRACE_CONCAT_(a, b)
+#define CUTT_TRACE_BEGIN(name) cuttTraceBegin(name)
+#define CUTT_TRACE_END() cuttTraceEnd()
+#define CUTT_TRACE_SCOPE(name) CuttTraceScope CUTT_TRACE_CONCAT(cuttTraceScope, __LINE__)(name)
+#else
+#define CUTT_TRACE_BEGIN(name)
+#define CUTT_TRACE_END()
+#define CUTT_TRACE_SCOPE(name)
+#endif
+
+#endif // CUTTTRACE_H
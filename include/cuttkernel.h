@@ -26,6 +26,10 @@ SOFTWARE.
 #define CUTTKERNEL_H
 #include "cuttplan.h"
 
+// Device ID of a virtual device: planning uses only the device description (cudaDeviceProp) and
+// estimates occupancy from it instead of querying the CUDA runtime, see cutt_plan_bench
+const int CUTT_VIRTUAL_DEVICE = -1;
+
 void cuttKernelSetSharedMemConfig();
 
 int cuttKernelLaunchConfiguration(const int sizeofType, const TensorSplit& ts,
@@ -25,10 +25,12 @@ SOFTWARE.
 #ifndef CUTTPLAN_H
 #define CUTTPLAN_H
 
-#include <list>
 #include <vector>
+#include <memory>
+#include <unordered_map>
 #include <cuda.h>
 #include "cuttTypes.h"
+#include "cuttStats.h"
 
 const int TILEDIM = 32;
 const int TILEROWS = 8;
@@ -114,7 +116,75 @@ public:
 
  };
 
-// Class that stores the plan data
+// Counters and estimates of the performance model, filled in by cuttPlan_t::countCycles()
+class PlanCounters {
+public:
+  // Number of iterations of the kernel
+  int num_iter;
+  // Average memory level parallelism = average unroll count
+  float mlp;
+  int gld_req, gst_req, gld_tran, gst_tran;
+  int cl_full_l2, cl_part_l2;
+  int cl_full_l1, cl_part_l1;
+  int sld_req, sst_req, sld_tran, sst_tran;
+  double cycles;
+  // Number of Mbar positions counted by countCycles(), mean number of transactions per position,
+  // and variance of that mean (zero when all positions are counted)
+  int numPosMbar;
+  double tranMean;
+  double tranVar;
+
+  PlanCounters();
+};
+
+//
+// Candidate plan: the split, launch configuration and model counters of a plan, but none of
+// its host or device tables. Candidates are cheap to store and compare, only the chosen one
+// is turned into a cuttPlan_t (see PlanCandidates::setup())
+//
+class PlanCandidate : public PlanCounters {
+public:
+  // Rank of the tensor, either the full or the reduced rank
+  int rank;
+
+  // Size of the tensor elements in bytes
+  size_t sizeofType;
+
+  TensorSplit tensorSplit;
+
+  // Kernel launch configuration
+  LaunchConfig launchConfig;
+
+  // Number of active thread blocks
+  int numActiveBlock;
+
+  PlanCandidate() : rank(0), sizeofType(0), numActiveBlock(0) {}
+  PlanCandidate(const int rank_in, const size_t sizeofType_in, const TensorSplit& tensorSplit_in,
+    const LaunchConfig& launchConfig_in, const int numActiveBlock_in) :
+    rank(rank_in), sizeofType(sizeofType_in), tensorSplit(tensorSplit_in),
+    launchConfig(launchConfig_in), numActiveBlock(numActiveBlock_in) {}
+};
+
+class PlanCandidates;
+class PlanStructure;
+
+//
+// Model-only state of a plan: host copies of the constant tables and the performance model
+// counters. Needed while planning (countCycles()) and until the tables are copied to the
+// device (activate()), optional afterwards, see cuttPlan_t::dropAnalysis()
+//
+class PlanAnalysis : public PlanCounters {
+public:
+  std::vector<TensorConvInOut> hostMbar;
+  std::vector<TensorConvInOut> hostMmk;
+  std::vector<TensorConv> hostMsh;
+
+  // Bytes of host memory used
+  size_t memoryUsage() const;
+};
+
+// Class that stores the plan data: what is needed to launch the kernels, and an optional analysis record
+// NOTE: cuttPlan_t owns device buffers and can be moved but not copied
 class cuttPlan_t {
 public:
   // Device for which this plan was made
@@ -132,6 +202,9 @@ public:
   // Size of the tensor elements in bytes
   size_t sizeofType;
 
+  // Dimensions of the tensor before rank reduction
+  std::vector<int> tensorDim;
+
   TensorSplit tensorSplit;
 
   // Number of active thread blocks
@@ -142,23 +215,6 @@ public:
 
   int2 tiledVol;
 
-  // Number of iterations of the kernel
-  int num_iter;
-  // Average memory level parallelism = average unroll count
-  float mlp;
-  int gld_req, gst_req, gld_tran, gst_tran;
-  int cl_full_l2, cl_part_l2;
-  int cl_full_l1, cl_part_l1;
-  int sld_req, sst_req, sld_tran, sst_tran;
-  double cycles;
-
-  //--------------
-  // Host buffers
-  //--------------
-  std::vector<TensorConvInOut> hostMbar;
-  std::vector<TensorConvInOut> hostMmk;
-  std::vector<TensorConv> hostMsh;
-
   //----------------
   // Device buffers
   //----------------
@@ -171,51 +227,196 @@ public:
   // sizeMmk
   TensorConv* Msh;
 
-  // For TiledSingleInRank
-  TensorConv* Mk;
+  //-----------------------------------------------
+  // Host tables and model counters, NULL if dropped
+  //-----------------------------------------------
+  std::unique_ptr<PlanAnalysis> analysis;
+
+  // Rank reduction and candidate splits the plan was chosen from, see cuttPlanUpdateDims().
+  // Shared by plans made for the same problem, NULL if not recorded
+  std::shared_ptr<const PlanStructure> structure;
 
-  // For TiledSingleOutRank
-  TensorConv* Mm;
+  // Execution statistics of the handle, see cuttGetStats(). NULL until executed with statistics on
+  std::unique_ptr<PlanStats> stats;
 
+  // Plan for the current device
   cuttPlan_t();
+  // Plan for device deviceID_in, which may be CUTT_VIRTUAL_DEVICE to plan without a GPU
+  explicit cuttPlan_t(const int deviceID_in);
+  cuttPlan_t(cuttPlan_t&& other);
+  cuttPlan_t& operator=(cuttPlan_t&& other);
+  cuttPlan_t(const cuttPlan_t&) = delete;
+  cuttPlan_t& operator=(const cuttPlan_t&) = delete;
   ~cuttPlan_t();
   void print();
   void setStream(cudaStream_t stream_in);
+  // Counts memory transactions and estimates cycles. At least numPosMbarSample Mbar positions are sampled
+  // (see MbarSampler), numPosMbarSample = 0 counts all positions. Requires the analysis record
   bool countCycles(cudaDeviceProp& prop, const int numPosMbarSample=0);
   void activate();
   void nullDevicePointers();
 
+  // Activates the plan and drops the analysis record
+  void dropAnalysis();
+
+  // Bytes of host memory used by the plan, including the analysis record and, if withStructure
+  // is true, the structure that may be shared with other plans
+  size_t hostMemoryUsage(const bool withStructure=true) const;
+
+  // Bytes of device memory allocated by activate()
+  size_t deviceMemoryUsage() const;
+
   static bool createPlans(const int rank, const int* dim, const int* permutation,
     const int redRank, const int* redDim, const int* redPermutation,
-    const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, std::list<cuttPlan_t>& plans);
+    const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, PlanCandidates& plans);
+
+  // Creates candidates for new dimensions dim[] with the rank reduction of structure. If they have
+  // the same splits as structure, only the ones that were competitive are kept and true is returned.
+  // Otherwise all candidates are kept and false is returned
+  static bool updatePlans(const PlanStructure& structure, const int* dim,
+    const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, PlanCandidates& plans);
 
 private:
+  friend class PlanCandidates;
+
   static bool createTrivialPlans(const int rank, const int* dim, const int* permutation,
-    const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, std::list<cuttPlan_t>& plans);
+    const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, PlanCandidates& plans);
 
   static bool createTiledPlans(const int rank, const int* dim, const int* permutation,
-    const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, std::list<cuttPlan_t>& plans);
+    const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, PlanCandidates& plans);
 
   static bool createTiledCopyPlans(const int rank, const int* dim, const int* permutation,
-    const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, std::list<cuttPlan_t>& plans);
+    const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, PlanCandidates& plans);
 
   static bool createPackedPlans(const int rank, const int* dim, const int* permutation,
-    const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, std::list<cuttPlan_t>& plans);
+    const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, PlanCandidates& plans);
 
   static bool createPackedSplitPlans(const int rank, const int* dim, const int* permutation,
-    const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, std::list<cuttPlan_t>& plans);
+    const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, PlanCandidates& plans);
 
   bool setup(const int rank_in, const int* dim, const int* permutation,
     const size_t sizeofType_in, const TensorSplit& tensorSplit_in,
     const LaunchConfig& launchConfig_in, const int numActiveBlock_in);
 
+  void deallocate();
+  void moveFrom(cuttPlan_t& other);
+
+};
+
+//
+// Candidate plans of one tensor, stored in a flat vector in the order they were created.
+// Candidates with equal TensorSplit are dropped on insertion (hash lookup).
+// Candidates are made either for the full or for the reduced tensor, told apart by their rank
+//
+class PlanCandidates {
+private:
+  friend class PlanStructure;
+
+  std::vector<int> dim;
+  std::vector<int> permutation;
+  std::vector<int> redDim;
+  std::vector<int> redPermutation;
+  std::vector<PlanCandidate> candidates;
+  // TensorSplit hash -> index in candidates
+  std::unordered_multimap<size_t, int> index;
+
+public:
+  // Sets the tensor, full and reduced, and drops all candidates
+  void setTensor(const int rank, const int* dim_in, const int* permutation_in,
+    const int redRank, const int* redDim_in, const int* redPermutation_in);
+
+  // Adds candidate unless one with the same TensorSplit exists. Returns true if added
+  bool add(const PlanCandidate& cand);
+
+  int size() const {return (int)candidates.size();}
+  bool empty() const {return candidates.empty();}
+  PlanCandidate& operator[](const int i) {return candidates[i];}
+  const PlanCandidate& operator[](const int i) const {return candidates[i];}
+  std::vector<PlanCandidate>::iterator begin() {return candidates.begin();}
+  std::vector<PlanCandidate>::iterator end() {return candidates.end();}
+  std::vector<PlanCandidate>::const_iterator begin() const {return candidates.begin();}
+  std::vector<PlanCandidate>::const_iterator end() const {return candidates.end();}
+
+  // Builds candidate i into plan, including its host tables and model counters.
+  // Device buffers of plan must not be allocated
+  bool setup(const int i, cuttPlan_t& plan) const;
+
+  // Runs cuttPlan_t::countCycles() for candidate i, using plan as scratch space
+  bool countCycles(const int i, cuttPlan_t& plan, cudaDeviceProp& prop, const int numPosMbarSample=0);
+
+  // Runs cuttPlan_t::countCycles() for every candidate. The performance model reads the host
+  // tables (Mbar, Mmk, Msh), so they are built for every candidate, one at a time into a single
+  // scratch plan. Only the counters are kept, the tables of the candidates that lose are dropped
+  bool countCycles(cudaDeviceProp& prop, const int numPosMbarSample=0);
+
+  // Returns indices of the candidates in the order they are evaluated when planning time is limited:
+  // Trivial, Tiled, TiledCopy, Packed, and PackedSplit with the fewest splits first
+  void priorityOrder(std::vector<int>& order) const;
 };
 
-void printMatlab(cudaDeviceProp& prop, std::list<cuttPlan_t>& plans, std::vector<double>& times);
+// Candidates whose estimated cycles are within this ratio of the best one are evaluated
+// again when the plan is updated for new dimensions
+const double PLAN_STRUCTURE_CYCLES_RATIO = 1.5;
+// Splits are recorded for tensors up to this rank, see PlanStructure::Split
+const int PLAN_STRUCTURE_MAX_RANK = 64;
+
+//
+// Part of planning a permutation that changes little with the tensor dimensions: the rank reduction
+// and the splits of the candidate plans. Dimensions are always larger than one, so ranks are merged
+// the same way for any dimensions. Lets a permutation be planned again for new dimensions while
+// evaluating only the candidates that were competitive before, see cuttPlan_t::updatePlans()
+//
+class PlanStructure {
+public:
+  // Split of a candidate plan of the full (isRed = false) or the reduced tensor, given by the
+  // ranks in Mm U Mk. Candidates with the same Mmk ranks are equal, except for PackedSplit which
+  // also has a split rank and a number of splits
+  struct Split {
+    int method;
+    bool isRed;
+    // Bit i is set if rank i is in Mmk
+    unsigned long long mmk;
+    // Estimated cycles within PLAN_STRUCTURE_CYCLES_RATIO of the best candidate
+    bool competitive;
+  };
+
+  std::vector<int> permutation;
+  // redRankOf[i] = rank of the reduced tensor that rank i is merged into
+  std::vector<int> redRankOf;
+  std::vector<int> redPermutation;
+  std::vector<Split> splits;
+
+  // Records the rank reduction and the splits of the candidates in plans. If cycles of the
+  // candidates are not counted, all splits are competitive
+  PlanStructure(const PlanCandidates& plans);
+
+  // Returns structure of the inverse permutation: Mm and Mk of the splits trade places
+  std::shared_ptr<PlanStructure> inverse() const;
+
+  // Returns dimensions of the reduced tensor
+  void reduceDims(const int* dim, std::vector<int>& redDim) const;
+
+  // Returns index of the split of candidate cand in splits, -1 if not found
+  int findSplit(const PlanCandidate& cand) const;
+
+  // Bytes of host memory used
+  size_t memoryUsage() const;
+
+private:
+  PlanStructure() {}
+  void setRedRankOf();
+  Split getSplit(const PlanCandidate& cand) const;
+};
+
+void printMatlab(cudaDeviceProp& prop, const PlanCandidates& plans, std::vector<double>& times);
 
 void reduceRanks(const int rank, const int* dim, const int* permutation,
   std::vector<int>& redDim, std::vector<int>& redPermutation);
 
-std::list<cuttPlan_t>::iterator choosePlanHeuristic(std::list<cuttPlan_t>& plans);
+// Returns index of the best candidate according to heuristic criteria, -1 if there are none
+int choosePlanHeuristic(const PlanCandidates& plans);
+
+// Same as above, choosing among candidates idx[0 ... n-1] only
+int choosePlanHeuristic(const PlanCandidates& plans, const int* idx, const int n);
 
 #endif // CUTTPLAN_H
@@ -0,0 +1,195 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <cstring>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HOST_COPY_SSE2
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define HOST_COPY_NEON
+#endif
+#include "HostMemcpy.h"
+
+// Bytes copied per iteration of the SIMD loops
+const size_t HOST_COPY_BLOCK = 64;
+
+// Parts copied by different threads start at multiples of this
+const size_t HOST_COPY_PART_ALIGN = 4096;
+
+const char* hostCopyName(const int method) {
+  switch(method) {
+    case HostCopyMemcpy: return "memcpy";
+    case HostCopyVector: return "vector";
+    case HostCopyStream: return "stream";
+  }
+  return "unknown";
+}
+
+bool hostCopyAvailable(const int method) {
+  switch(method) {
+    case HostCopyMemcpy: return true;
+#if defined(HOST_COPY_SSE2) || defined(HOST_COPY_NEON)
+    case HostCopyVector: return true;
+#endif
+#ifdef HOST_COPY_SSE2
+    case HostCopyStream: return true;
+#endif
+  }
+  return false;
+}
+
+//
+// Copy using SIMD loads and stores
+//
+static void vectorCopy(const size_t bytes, const char* in, char* out) {
+  size_t numBlock = bytes/HOST_COPY_BLOCK;
+#if defined(HOST_COPY_SSE2)
+  for (size_t i=0;i < numBlock;i++) {
+    const __m128i* src = (const __m128i*)(in + i*HOST_COPY_BLOCK);
+    __m128i* dst = (__m128i*)(out + i*HOST_COPY_BLOCK);
+    __m128i v0 = _mm_loadu_si128(src);
+    __m128i v1 = _mm_loadu_si128(src + 1);
+    __m128i v2 = _mm_loadu_si128(src + 2);
+    __m128i v3 = _mm_loadu_si128(src + 3);
+    _mm_storeu_si128(dst, v0);
+    _mm_storeu_si128(dst + 1, v1);
+    _mm_storeu_si128(dst + 2, v2);
+    _mm_storeu_si128(dst + 3, v3);
+  }
+#elif defined(HOST_COPY_NEON)
+  for (size_t i=0;i < numBlock;i++) {
+    const uint8_t* src = (const uint8_t*)(in + i*HOST_COPY_BLOCK);
+    uint8_t* dst = (uint8_t*)(out + i*HOST_COPY_BLOCK);
+    uint8x16_t v0 = vld1q_u8(src);
+    uint8x16_t v1 = vld1q_u8(src + 16);
+    uint8x16_t v2 = vld1q_u8(src + 32);
+    uint8x16_t v3 = vld1q_u8(src + 48);
+    vst1q_u8(dst, v0);
+    vst1q_u8(dst + 16, v1);
+    vst1q_u8(dst + 32, v2);
+    vst1q_u8(dst + 48, v3);
+  }
+#else
+  numBlock = 0;
+#endif
+  size_t done = numBlock*HOST_COPY_BLOCK;
+  memcpy(out + done, in + done, bytes - done);
+}
+
+//
+// Copy using SIMD loads and non-temporal stores. Stores need 16 byte alignment, the unaligned
+// head of out is copied with memcpy
+//
+static void streamCopy(const size_t bytes, const char* in, char* out) {
+#ifdef HOST_COPY_SSE2
+  size_t head = std::min(bytes, (size_t)((16 - ((uintptr_t)out & 15)) & 15));
+  memcpy(out, in, head);
+  size_t numBlock = (bytes - head)/HOST_COPY_BLOCK;
+  const char* in0 = in + head;
+  char* out0 = out + head;
+  for (size_t i=0;i < numBlock;i++) {
+    const __m128i* src = (const __m128i*)(in0 + i*HOST_COPY_BLOCK);
+    __m128i* dst = (__m128i*)(out0 + i*HOST_COPY_BLOCK);
+    __m128i v0 = _mm_loadu_si128(src);
+    __m128i v1 = _mm_loadu_si128(src + 1);
+    __m128i v2 = _mm_loadu_si128(src + 2);
+    __m128i v3 = _mm_loadu_si128(src + 3);
+    _mm_stream_si128(dst, v0);
+    _mm_stream_si128(dst + 1, v1);
+    _mm_stream_si128(dst + 2, v2);
+    _mm_stream_si128(dst + 3, v3);
+  }
+  _mm_sfence();
+  size_t done = head + numBlock*HOST_COPY_BLOCK;
+  memcpy(out + done, in + done, bytes - done);
+#else
+  memcpy(out, in, bytes);
+#endif
+}
+
+static void copyPart(const int method, const size_t bytes, const char* in, char* out) {
+  switch(method) {
+    case HostCopyVector:
+    vectorCopy(bytes, in, out);
+    break;
+    case HostCopyStream:
+    streamCopy(bytes, in, out);
+    break;
+    default:
+    memcpy(out, in, bytes);
+  }
+}
+
+//
+// Runs the calling thread on CPU cpu. Only called on threads spawned by hostCopy
+//
+static void pinThread(const int cpu) {
+#ifdef __linux__
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpu % CPU_SETSIZE, &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+#endif
+}
+
+void hostCopy(const int method, const size_t bytes, const void* data_in, void* data_out,
+  const int numThread, const bool pin) {
+
+  const char* in = (const char*)data_in;
+  char* out = (char*)data_out;
+  if (numThread <= 1 && !pin) {
+    copyPart(method, bytes, in, out);
+    return;
+  }
+  // Only spawned threads are pinned, the caller keeps its affinity so that threads it starts
+  // later are not confined to a single CPU
+  if (numThread <= 1) {
+    std::thread thread([=]() {
+      pinThread(0);
+      copyPart(method, bytes, in, out);
+    });
+    thread.join();
+    return;
+  }
+  size_t part = ((bytes/numThread - 1)/HOST_COPY_PART_ALIGN + 1)*HOST_COPY_PART_ALIGN;
+  std::vector<std::thread> threads;
+  for (int i=0;i < numThread;i++) {
+    size_t begin = std::min(bytes, i*part);
+    size_t end = (i == numThread - 1) ? bytes : std::min(bytes, (i + 1)*part);
+    threads.push_back(std::thread([=]() {
+      if (pin) pinThread(i);
+      copyPart(method, end - begin, in + begin, out + begin);
+    }));
+  }
+  for (int i=0;i < numThread;i++) threads[i].join();
+}
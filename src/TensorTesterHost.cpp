@@ -0,0 +1,170 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+//
+// Host testing utilities, counterparts of the kernels in TensorTester.cu.
+// The pattern and comparison loops are branch-free so that the compiler vectorizes them
+//
+#include <cstdio>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include "TensorTester.h"
+#include "cuttParallel.h"
+
+// Number of elements each thread processes at a time
+const size_t TENSOR_TESTER_CHUNK = 65536;
+
+//
+// Calls f(begin, end) for chunks of TENSOR_TESTER_CHUNK elements covering [0, n) on numThread threads
+//
+template <typename F>
+static void parallelForChunks(const size_t n, const int numThread, F f) {
+  if (n == 0) return;
+  int numChunk = (int)((n - 1)/TENSOR_TESTER_CHUNK + 1);
+  parallelFor(numChunk, 1, (numThread > 0) ? numThread : cuttNumThreads(), [&](int c0, int c1) {
+    for (int c=c0;c < c1;c++) {
+      f(c*TENSOR_TESTER_CHUNK, std::min(n, (c + 1)*TENSOR_TESTER_CHUNK));
+    }
+  });
+}
+
+void TensorTester::setTensorCheckPatternHost(unsigned int* data, size_t ndata, int numThread) {
+  parallelForChunks(ndata, numThread, [&](size_t begin, size_t end) {
+    for (size_t i=begin;i < end;i++) data[i] = (unsigned int)i;
+  });
+}
+
+//
+// Returns non-zero if any of len elements of W words starting at data differ from the pattern
+// of input elements base, base + stride, base + 2*stride, ...
+//
+template <int W>
+static unsigned int compareRun(const unsigned int* data, const unsigned int base,
+  const unsigned int stride, const size_t len) {
+  unsigned int diff = 0;
+  for (size_t j=0;j < len;j++) {
+    unsigned int ref = (base + (unsigned int)j*stride)*W;
+    for (int k=0;k < W;k++) diff |= data[j*W + k] ^ (ref + k);
+  }
+  return diff;
+}
+
+template<typename T> bool TensorTester::checkTransposeHost(int rank, const int* dim, const int* permutation,
+  const T* data, std::vector<TensorErrorHost_t>* errors, int maxError, int numThread) {
+
+  static_assert(sizeof(T) % sizeof(unsigned int) == 0, "element size must be a multiple of 4 bytes");
+  const int W = sizeof(T)/sizeof(unsigned int);
+
+  // Output dimensions and the input strides that go with them
+  std::vector<size_t> dimOut(rank);
+  std::vector<unsigned int> strideIn(rank);
+  size_t vol = 1;
+  {
+    std::vector<unsigned int> stride(rank);
+    for (int i=0;i < rank;i++) {
+      stride[i] = (unsigned int)vol;
+      vol *= dim[i];
+    }
+    for (int i=0;i < rank;i++) {
+      dimOut[i] = dim[permutation[i]];
+      strideIn[i] = stride[permutation[i]];
+    }
+  }
+
+  // With maxError <= 0 mismatches are still searched for, until the first one, but none is recorded
+  const int maxFound = std::max(maxError, 1);
+  const int maxRecord = std::max(maxError, 0);
+
+  const unsigned int* words = (const unsigned int*)data;
+  std::vector<TensorErrorHost_t> found;
+  std::mutex foundMutex;
+  // Position of the maxFound:th mismatch of a chunk, nothing beyond it needs to be checked
+  std::atomic<size_t> stopPos(vol);
+
+  parallelForChunks(vol, numThread, [&](size_t begin, size_t end) {
+    if (begin >= stopPos.load()) return;
+    std::vector<TensorErrorHost_t> local;
+    std::vector<size_t> idx(rank);
+    size_t rem = begin;
+    for (int k=0;k < rank;k++) {
+      idx[k] = rem % dimOut[k];
+      rem /= dimOut[k];
+    }
+    size_t i = begin;
+    while (i < end && i < stopPos.load(std::memory_order_relaxed) && (int)local.size() < maxFound) {
+      size_t len = std::min(dimOut[0] - idx[0], end - i);
+      unsigned int base = 0;
+      for (int k=0;k < rank;k++) base += (unsigned int)idx[k]*strideIn[k];
+      if (compareRun<W>(words + i*W, base, strideIn[0], len) != 0) {
+        for (size_t j=0;j < len && (int)local.size() < maxFound;j++) {
+          if (compareRun<W>(words + (i + j)*W, base + (unsigned int)j*strideIn[0], 0, 1) != 0) {
+            TensorErrorHost_t error;
+            error.refVal = base + (unsigned int)j*strideIn[0];
+            error.dataVal = words[(i + j)*W]/W;
+            error.pos = i + j;
+            local.push_back(error);
+          }
+        }
+      }
+      i += len;
+      idx[0] += len;
+      for (int k=0;k < rank - 1 && idx[k] == dimOut[k];k++) {
+        idx[k] = 0;
+        idx[k + 1]++;
+      }
+    }
+    if (local.empty()) return;
+    if ((int)local.size() == maxFound) {
+      size_t pos = local.back().pos;
+      size_t cur = stopPos.load();
+      while (pos < cur && !stopPos.compare_exchange_weak(cur, pos));
+    }
+    std::lock_guard<std::mutex> lock(foundMutex);
+    found.insert(found.end(), local.begin(), local.end());
+  });
+
+  bool ok = found.empty();
+  std::sort(found.begin(), found.end(),
+    [](const TensorErrorHost_t& a, const TensorErrorHost_t& b) {return a.pos < b.pos;});
+  if ((int)found.size() > maxRecord) found.resize(maxRecord);
+
+  if (errors != NULL) {
+    *errors = found;
+  } else {
+    for (int i=0;i < (int)found.size();i++) {
+      printf("TensorTester::checkTransposeHost FAIL at %zu ref %u data %u\n",
+        found[i].pos, found[i].refVal, found[i].dataVal);
+    }
+  }
+
+  return ok;
+}
+
+// Explicit instances
+template bool TensorTester::checkTransposeHost<int>(int rank, const int* dim, const int* permutation,
+  const int* data, std::vector<TensorErrorHost_t>* errors, int maxError, int numThread);
+template bool TensorTester::checkTransposeHost<long long int>(int rank, const int* dim, const int* permutation,
+  const long long int* data, std::vector<TensorErrorHost_t>* errors, int maxError, int numThread);
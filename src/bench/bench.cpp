@@ -30,13 +30,20 @@ SOFTWARE.
 #include <cmath>
 #include <cctype>
 #include <random>
+#include <string>
+#include <map>
+#include <memory>
+#include <type_traits>     // std::conditional
 #include "cutt.h"
 #include "CudaUtils.h"
 #include "CudaMem.h"
 #include "TensorTester.h"
 #include "cuttTimer.h"
 #include "CudaMemcpy.h"
-#include "int_vector.h"
+#include "HostMemcpy.h"
+#include "cuttParallel.h"  // cuttNumThreads
+#include "cuttNuma.h"      // hostNumaNodes, hostPageNode
+#include "cuttGpuModel.h"  // cpuVectorType
 
 #define MILLION 1000000
 #define BILLION 1000000000
@@ -60,6 +67,9 @@ TensorTester* tester = NULL;
 cuttTimer* timer;
 bool use_cuttPlanMeasure;
 bool use_plantimer;
+// Number of untimed and timed executions per tensor in bench_tensor()
+int numWarmup = 0;
+int numRep = 4;
 
 std::default_random_engine generator;
 
@@ -71,11 +81,17 @@ bool bench6();
 template <typename T> bool bench7();
 template <typename T> bool bench_input(std::vector<int>& dim, std::vector<int>& permutation);
 template <typename T> bool bench_memcpy(int numElem);
+template <typename T> double bench_host_memcpy(int numElem);
+template <typename T> bool bench_host(int numElem, std::vector<int>& dim, std::vector<int>& permutation,
+  const char* outputFile);
+template <typename T> bool bench_host_numa(int numElem, std::vector<int>& dim, std::vector<int>& permutation);
+bool bench_replay(const char* fileName, int numExecute, size_t dataBytes);
 
 bool isTrivial(std::vector<int>& permutation);
 void getRandomDim(double vol, std::vector<int>& dim);
 template <typename T> bool bench_tensor(std::vector<int>& dim, std::vector<int>& permutation);
 void printVec(std::vector<int>& vec);
+void printRankStats(cuttTimer* timer);
 void printDeviceInfo();
 
 int main(int argc, char *argv[]) {
@@ -83,12 +99,19 @@ int main(int argc, char *argv[]) {
   int gpuid = -1;
   unsigned seed = unsigned (std::time(0));
   bool arg_ok = true;
+  int exitCode = 0;
   int benchID = 0;
   use_cuttPlanMeasure = false;
   use_plantimer = false;
   int elemsize = 8;
   std::vector<int> dimIn;
   std::vector<int> permutationIn;
+  const char* replayFile = NULL;
+  int replayExecute = 1000;
+  const char* outputFile = NULL;
+  int hostNumElem = 0;
+  int hostTransposeNumElem = 0;
+  int hostNumaNumElem = 0;
   if (argc >= 2) {
     int i = 1;
     while (i < argc) {
@@ -110,6 +133,30 @@ int main(int argc, char *argv[]) {
       } else if (strcmp(argv[i], "-elemsize") == 0) {
         sscanf(argv[i+1], "%u", &elemsize);
         i += 2;
+      } else if (strcmp(argv[i], "-replay") == 0 && i + 1 < argc) {
+        replayFile = argv[i+1];
+        i += 2;
+      } else if (strcmp(argv[i], "-replayexec") == 0) {
+        sscanf(argv[i+1], "%d", &replayExecute);
+        i += 2;
+      } else if (strcmp(argv[i], "-output") == 0 && i + 1 < argc) {
+        outputFile = argv[i+1];
+        i += 2;
+      } else if (strcmp(argv[i], "-warmup") == 0) {
+        sscanf(argv[i+1], "%d", &numWarmup);
+        i += 2;
+      } else if (strcmp(argv[i], "-reps") == 0) {
+        sscanf(argv[i+1], "%d", &numRep);
+        i += 2;
+      } else if (strcmp(argv[i], "-hostmemcpy") == 0) {
+        sscanf(argv[i+1], "%d", &hostNumElem);
+        i += 2;
+      } else if (strcmp(argv[i], "-host") == 0) {
+        sscanf(argv[i+1], "%d", &hostTransposeNumElem);
+        i += 2;
+      } else if (strcmp(argv[i], "-hostnuma") == 0) {
+        sscanf(argv[i+1], "%d", &hostNumaNumElem);
+        i += 2;
       } else if (strcmp(argv[i], "-dim") == 0) {
         i++;
         while (i < argc && isdigit(*argv[i])) {
@@ -137,20 +184,58 @@ int main(int argc, char *argv[]) {
     arg_ok = false;
   }
 
+  if (numWarmup < 0 || numRep < 1 || hostNumElem < 0 || hostTransposeNumElem < 0 || hostNumaNumElem < 0) {
+    arg_ok = false;
+  }
+
   if (!arg_ok) {
     printf("cutt_bench [options]\n");
     printf("Options:\n");
     printf("-device [int]    : GPU ID (default is 0)\n");
-    printf("-measure         : use cuttPlanMeasure (default is cuttPlan)\n");
+    printf("-measure         : use cuttPlanMeasure (default is cuttPlan), cuttPlanHostMeasure with -host\n");
     printf("-plantimer       : planning is timed (default is no)\n");
     printf("-seed [int]      : seed value for random number generator (default is system timer)\n");
     printf("-elemsize [int]  : size of elements in bytes, 4 or 8. (default is 8)\n");
     printf("-dim ...         : space-separated list of dimensions\n");
     printf("-permutation ... : space-separated list of permutations\n");
     printf("-bench benchID   : benchmark to run\n");
+    printf("-replay file     : re-run the workload captured into file with CUTT_CAPTURE_FILE\n");
+    printf("-replayexec [int]: number of executions the replayed workload is scaled to (default is 1000)\n");
+    printf("-warmup [int]    : untimed executions per tensor (default is 0)\n");
+    printf("-reps [int]      : timed executions per tensor (default is 4)\n");
+    printf("-output file     : append every timed execution to CSV file, input of cutt_compare\n");
+    printf("-hostmemcpy [int]: host memory copy baselines on [int] elements, no GPU is used\n");
+    printf("-host [int]      : host transposes of random tensors of [int] elements, or of -dim and -permutation\n");
+    printf("-hostnuma [int]  : as -host, bandwidth of each NUMA node and of the NUMA placements\n");
     return 1;
   }
 
+  if (hostNumElem > 0) {
+    double copyGBs = (elemsize == 4) ? bench_host_memcpy<int>(hostNumElem) : bench_host_memcpy<long long int>(hostNumElem);
+    printf((copyGBs > 0.0) ? "bench OK\n" : "bench FAIL\n");
+    return (copyGBs > 0.0) ? 0 : 1;
+  }
+
+  if (hostTransposeNumElem > 0) {
+    std::srand(seed);
+    generator.seed(seed);
+    bool ok = (elemsize == 4) ? bench_host<int>(hostTransposeNumElem, dimIn, permutationIn, outputFile) :
+      bench_host<long long int>(hostTransposeNumElem, dimIn, permutationIn, outputFile);
+    printf(ok ? "bench OK\n" : "bench FAIL\n");
+    printf("seed %u\n", seed);
+    return ok ? 0 : 1;
+  }
+
+  if (hostNumaNumElem > 0) {
+    std::srand(seed);
+    generator.seed(seed);
+    bool ok = (elemsize == 4) ? bench_host_numa<int>(hostNumaNumElem, dimIn, permutationIn) :
+      bench_host_numa<long long int>(hostNumaNumElem, dimIn, permutationIn);
+    printf(ok ? "bench OK\n" : "bench FAIL\n");
+    printf("seed %u\n", seed);
+    return ok ? 0 : 1;
+  }
+
   if (gpuid >= 0) {
     cudaCheck(cudaSetDevice(gpuid));
   }
@@ -163,7 +248,7 @@ int main(int argc, char *argv[]) {
   }
 
   printDeviceInfo();
-  printf("CPU using vector type %s of length %d\n", INT_VECTOR_TYPE, INT_VECTOR_LEN);
+  printf("CPU using vector type %s of length %d\n", cpuVectorType(), cpuVectorLen());
 
   timer = new cuttTimer(elemsize);
 
@@ -195,6 +280,11 @@ int main(int argc, char *argv[]) {
   //   printf("%lf\n", bandwidths[i]);
   // }
 
+  if (replayFile != NULL) {
+    if (bench_replay(replayFile, replayExecute, dataSize*(size_t)elemsize)) goto benchOK;
+    goto fail;
+  }
+
   if (dimIn.size() > 0) {
     bool ok = (elemsize == 4) ? bench_input<int>(dimIn, permutationIn) : bench_input<long long int>(dimIn, permutationIn);
     if (ok) goto benchOK;
@@ -208,14 +298,7 @@ int main(int argc, char *argv[]) {
     }
     if (bench3(200*MILLION)) {
       printf("bench3:\n");
-      printf("rank best worst average median\n");
-      for (auto it=timer->ranksBegin();it != timer->ranksEnd();it++) {
-        double worstBW = timer->getWorst(*it);
-        double bestBW = timer->getBest(*it);
-        double aveBW = timer->getAverage(*it);
-        double medBW = timer->getMedian(*it);
-        printf("%d %6.2lf %6.2lf %6.2lf %6.2lf\n", *it, bestBW, worstBW, aveBW, medBW);
-      }
+      printRankStats(timer);
       for (auto it=timer->ranksBegin();it != timer->ranksEnd();it++) {
         std::vector<int> dim;
         std::vector<int> permutation;
@@ -244,14 +327,7 @@ int main(int argc, char *argv[]) {
         }
         printf("\n");
       }
-      printf("rank best worst average median\n");
-      for (auto it=timer->ranksBegin();it != timer->ranksEnd();it++) {
-        double worstBW = timer->getWorst(*it);
-        double bestBW = timer->getBest(*it);
-        double aveBW = timer->getAverage(*it);
-        double medBW = timer->getMedian(*it);
-        printf("%d %6.2lf %6.2lf %6.2lf %6.2lf\n", *it, bestBW, worstBW, aveBW, medBW);
-      }
+      printRankStats(timer);
       for (auto it=timer->ranksBegin();it != timer->ranksEnd();it++) {
         std::vector<int> dim;
         std::vector<int> permutation;
@@ -283,13 +359,7 @@ int main(int argc, char *argv[]) {
         }
         printf("\n");
       }
-      printf("rank best worst average\n");
-      for (auto it=timer->ranksBegin();it != timer->ranksEnd();it++) {
-        double worstBW = timer->getWorst(*it);
-        double bestBW = timer->getBest(*it);
-        double aveBW = timer->getAverage(*it);
-        printf("%d %6.2lf %6.2lf %6.2lf\n", *it, bestBW, worstBW, aveBW);
-      }
+      printRankStats(timer);
       for (auto it=timer->ranksBegin();it != timer->ranksEnd();it++) {
         std::vector<int> dim;
         std::vector<int> permutation;
@@ -318,14 +388,7 @@ int main(int argc, char *argv[]) {
         }
         printf("\n");
       }
-      printf("rank best worst average median\n");
-      for (auto it=timer->ranksBegin();it != timer->ranksEnd();it++) {
-        double worstBW = timer->getWorst(*it);
-        double bestBW = timer->getBest(*it);
-        double aveBW = timer->getAverage(*it);
-        double medBW = timer->getMedian(*it);
-        printf("%d %6.2lf %6.2lf %6.2lf %6.2lf\n", *it, bestBW, worstBW, aveBW, medBW);
-      }
+      printRankStats(timer);
       for (auto it=timer->ranksBegin();it != timer->ranksEnd();it++) {
         std::vector<int> dim;
         std::vector<int> permutation;
@@ -352,9 +415,15 @@ int main(int argc, char *argv[]) {
 benchOK:
   printf("bench OK\n");
 
+  if (outputFile != NULL) {
+    std::string label = (dimIn.size() > 0) ? std::string("input") : "bench" + std::to_string(benchID);
+    if (!timer->writeSamples(outputFile, label.c_str())) printf("unable to write %s\n", outputFile);
+  }
+
   goto end;
 fail:
   printf("bench FAIL\n");
+  exitCode = 1;
 end:
   deallocate_device<char>(&dataIn);
   deallocate_device<char>(&dataOut);
@@ -367,7 +436,7 @@ end:
   cudaCheck(cudaDeviceSynchronize());
 
   cudaCheck(cudaDeviceReset());
-  return 0;
+  return exitCode;
 }
 
 //
@@ -721,6 +790,193 @@ bool bench7() {
   return true;
 }
 
+//
+// Problem of a captured workload, see cuttCapture.h
+//
+struct ReplayProblem {
+  int sizeofType;
+  std::vector<int> dim;
+  std::vector<int> permutation;
+  double alpha;
+  double beta;
+  // Number of plans made and executions captured
+  unsigned long long numPlan;
+  unsigned long long numExecute;
+  // Results of the replay
+  int numReplay;
+  double planSeconds;
+  double seconds;
+  size_t bytes;
+};
+
+//
+// Parses list of integers "i0xi1x..."
+//
+static std::vector<int> parseIntList(const std::string& str) {
+  std::vector<int> val;
+  size_t pos = 0;
+  while (pos < str.size()) {
+    size_t end = str.find('x', pos);
+    if (end == std::string::npos) end = str.size();
+    val.push_back(atoi(str.substr(pos, end - pos).c_str()));
+    pos = end + 1;
+  }
+  return val;
+}
+
+//
+// Reads capture file. Plans are counted for the problems with the same tensor
+//
+static bool readCapture(const char* fileName, std::vector<ReplayProblem>& problems) {
+  FILE* fp = fopen(fileName, "r");
+  if (fp == NULL) {
+    printf("bench_replay, unable to open file %s\n", fileName);
+    return false;
+  }
+  // Plan counts by tensor
+  std::map<std::string, unsigned long long> numPlan;
+  char line[4096];
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    char event[16], dimStr[2048], permStr[2048];
+    unsigned long long count;
+    int sizeofType, rank;
+    double alpha, beta;
+    if (sscanf(line, "%15[^,],%llu,%d,%d,%2047[^,],%2047[^,],%lf,%lf",
+      event, &count, &sizeofType, &rank, dimStr, permStr, &alpha, &beta) != 8) continue;
+    std::string tensor = std::to_string(sizeofType) + "," + dimStr + "," + permStr;
+    if (strcmp(event, "plan") == 0) {
+      numPlan[tensor] += count;
+      continue;
+    }
+    ReplayProblem problem;
+    problem.sizeofType = sizeofType;
+    problem.dim = parseIntList(dimStr);
+    problem.permutation = parseIntList(permStr);
+    problem.alpha = alpha;
+    problem.beta = beta;
+    problem.numPlan = 0;
+    problem.numExecute = count;
+    if ((int)problem.dim.size() != rank || (int)problem.permutation.size() != rank ||
+      (sizeofType != 4 && sizeofType != 8)) {
+      printf("bench_replay, invalid line: %s", line);
+      fclose(fp);
+      return false;
+    }
+    problems.push_back(problem);
+  }
+  fclose(fp);
+  // Plans are attributed to the first execution of the same tensor
+  for (int i=0;i < problems.size();i++) {
+    ReplayProblem& problem = problems[i];
+    std::string tensor = std::to_string(problem.sizeofType) + "," + intList(problem.dim) + "," +
+      intList(problem.permutation);
+    auto it = numPlan.find(tensor);
+    if (it != numPlan.end()) {
+      problem.numPlan = it->second;
+      numPlan.erase(it);
+    }
+  }
+  return true;
+}
+
+//
+// Replays problem numReplay times and records the average time per execution
+//
+template <typename T>
+bool replay_problem(ReplayProblem& problem, size_t dataBytes) {
+  int rank = problem.dim.size();
+  size_t vol = 1;
+  for (int r=0;r < rank;r++) {
+    vol *= problem.dim[r];
+  }
+  if (vol*sizeof(T) > dataBytes) {
+    printf("bench_replay, data size exceeded\n");
+    return false;
+  }
+  // cuttExecute reads alpha and beta as float or double, matching the size of the element
+  typedef typename std::conditional<sizeof(T) == 4, float, double>::type Scalar;
+  Scalar alpha = (Scalar)problem.alpha;
+  Scalar beta = (Scalar)problem.beta;
+  // Input is read and output written, and also read unless beta is zero
+  problem.bytes = vol*sizeof(T)*((problem.beta != 0.0) ? 3 : 2);
+
+  cuttHandle plan;
+  std::chrono::high_resolution_clock::time_point plan_start = std::chrono::high_resolution_clock::now();
+  if (use_cuttPlanMeasure) {
+    cuttCheck(cuttPlanMeasure(&plan, rank, problem.dim.data(), problem.permutation.data(), sizeof(T), 0,
+      dataIn, dataOut, &alpha, &beta));
+  } else {
+    cuttCheck(cuttPlan(&plan, rank, problem.dim.data(), problem.permutation.data(), sizeof(T), 0));
+  }
+  std::chrono::high_resolution_clock::time_point plan_end = std::chrono::high_resolution_clock::now();
+  problem.planSeconds = std::chrono::duration_cast< std::chrono::duration<double> >(plan_end - plan_start).count();
+
+  // First execution is not timed
+  set_device_array<T>((T *)dataOut, 0, vol);
+  cuttCheck(cuttExecute(plan, dataIn, dataOut, &alpha, &beta));
+  cudaCheck(cudaDeviceSynchronize());
+  bool ok = true;
+  if (problem.alpha == 1.0 && problem.beta == 0.0) {
+    ok = tester->checkTranspose<T>(rank, problem.dim.data(), problem.permutation.data(), (T *)dataOut);
+  }
+
+  Timer replayTimer;
+  replayTimer.start();
+  for (int i=0;i < problem.numReplay;i++) {
+    cuttCheck(cuttExecute(plan, dataIn, dataOut, &alpha, &beta));
+  }
+  replayTimer.stop();
+  problem.seconds = replayTimer.seconds()/(double)problem.numReplay;
+
+  cuttCheck(cuttDestroy(plan));
+  return ok;
+}
+
+//
+// Replays workload captured into fileName. Every problem is executed in proportion to the number
+// of captured executions, numExecute executions in total but at least once per problem.
+// Throughput of the workload is the captured bytes over the captured executions times the measured
+// time per execution
+//
+bool bench_replay(const char* fileName, int numExecute, size_t dataBytes) {
+  std::vector<ReplayProblem> problems;
+  if (!readCapture(fileName, problems)) return false;
+  if (problems.size() == 0) {
+    printf("bench_replay, no executions in %s\n", fileName);
+    return false;
+  }
+
+  unsigned long long totExecute = 0;
+  for (int i=0;i < problems.size();i++) {
+    totExecute += problems[i].numExecute;
+  }
+
+  printf("replay: %d problems %llu captured executions\n", (int)problems.size(), totExecute);
+  printf("calls share replayed sizeof alpha beta plan_ms exec_us GB/s dim permutation\n");
+  double totBytes = 0.0;
+  double totSeconds = 0.0;
+  double totPlanSeconds = 0.0;
+  for (int i=0;i < problems.size();i++) {
+    ReplayProblem& problem = problems[i];
+    double share = (double)problem.numExecute/(double)totExecute;
+    problem.numReplay = std::max(1, (int)round(share*numExecute));
+    bool ok = (problem.sizeofType == 4) ? replay_problem<int>(problem, dataBytes) :
+      replay_problem<long long int>(problem, dataBytes);
+    if (!ok) return false;
+    totBytes += (double)problem.numExecute*(double)problem.bytes;
+    totSeconds += (double)problem.numExecute*problem.seconds;
+    totPlanSeconds += (double)problem.numPlan*problem.planSeconds;
+    printf("%llu %1.4lf %d %d %g %g %8.3lf %10.2lf %6.2lf ", problem.numExecute, share, problem.numReplay,
+      problem.sizeofType, problem.alpha, problem.beta, problem.planSeconds*1000.0, problem.seconds*1.0e6,
+      (double)problem.bytes/problem.seconds/1.0e9);
+    printf("%s %s\n", intList(problem.dim).c_str(), intList(problem.permutation).c_str());
+  }
+
+  printf("workload: execution %lf s %6.2lf GB/s planning %lf s\n", totSeconds, totBytes/totSeconds/1.0e9,
+    totPlanSeconds);
+  return true;
+}
+
 //
 // Returns true for trivial permutation
 //
@@ -809,7 +1065,11 @@ bool bench_tensor(std::vector<int>& dim, std::vector<int>& permutation) {
     printf("plan took %lf ms\n", plan_duration*1000.0);
   }
 
-  for (int i=0;i < 4;i++) {
+  for (int i=0;i < numWarmup;i++) {
+    cuttCheck(cuttExecute(plan, dataIn, dataOut));
+  }
+
+  for (int i=0;i < numRep;i++) {
     set_device_array<T>((T *)dataOut, -1, vol);
     cudaCheck(cudaDeviceSynchronize());
 
@@ -831,6 +1091,23 @@ void printVec(std::vector<int>& vec) {
   printf("\n");
 }
 
+//
+// Prints bandwidth statistics for every rank recorded by timer. Percentiles are those of time:
+// p90 and p99 are the bandwidths that 90% and 99% of the runs reach
+//
+void printRankStats(cuttTimer* timer) {
+  printf("rank best worst average median p90 p99\n");
+  for (auto it=timer->ranksBegin();it != timer->ranksEnd();it++) {
+    double worstBW = timer->getWorst(*it);
+    double bestBW = timer->getBest(*it);
+    double aveBW = timer->getAverage(*it);
+    double medBW = timer->getMedian(*it);
+    double p90BW = timer->getPercentile(*it, 10.0);
+    double p99BW = timer->getPercentile(*it, 1.0);
+    printf("%d %6.2lf %6.2lf %6.2lf %6.2lf %6.2lf %6.2lf\n", *it, bestBW, worstBW, aveBW, medBW, p90BW, p99BW);
+  }
+}
+
 //
 // Benchmarks memory copy. Returns bandwidth in GB/s
 //
@@ -885,6 +1162,236 @@ bool bench_memcpy(int numElem) {
   return true;
 }
 
+//
+// Benchmarks host memory copy with every method of HostMemcpy.h, on one thread and on
+// cuttNumThreads() pinned threads. Returns the best bandwidth in GB/s, which is what host
+// transposes can reach, or zero if a copy fails
+//
+template <typename T>
+double bench_host_memcpy(int numElem) {
+
+  std::vector<T> hostIn(numElem);
+  std::vector<T> hostOut(numElem);
+  TensorTester::setTensorCheckPatternHost((unsigned int *)hostIn.data(), numElem*sizeof(T)/sizeof(unsigned int));
+
+  std::vector<int> dim(1, numElem);
+  std::vector<int> permutation(1, 0);
+
+  std::vector<int> numThreads(1, 1);
+  if (cuttNumThreads() > 1) numThreads.push_back(cuttNumThreads());
+
+  double bestGBs = 0.0;
+  for (int method=0;method < NumHostCopyMethod;method++) {
+    if (!hostCopyAvailable(method)) {
+      printf("%s not available\n", hostCopyName(method));
+      continue;
+    }
+    for (int numThread : numThreads) {
+      cuttTimer timer(sizeof(T), TimerClockSteady);
+      for (int i=0;i < numWarmup + numRep;i++) {
+        std::fill(hostOut.begin(), hostOut.end(), (T)-1);
+        if (i >= numWarmup) timer.start(dim, permutation);
+        hostCopy(method, numElem*sizeof(T), hostIn.data(), hostOut.data(), numThread, true);
+        if (i >= numWarmup) {
+          timer.stop();
+          printf("%4.2lf GB/s\n", timer.GBs());
+        }
+      }
+      if (!TensorTester::checkTransposeHost<T>(1, dim.data(), permutation.data(), hostOut.data())) return 0.0;
+      printf("%s threads %d %lf GB/s (best %lf)\n", hostCopyName(method), numThread,
+        timer.getAverage(1), timer.getBest(1));
+      bestGBs = std::max(bestGBs, timer.getBest(1));
+    }
+  }
+  printf("host copy %lf GB/s\n", bestGBs);
+
+  return bestGBs;
+}
+
+//
+// Tensors of the host benchmarks: dim and permutation, or numSample random tensors of each of
+// ranks 2-7 with numElem elements. Returns the number of elements of the largest tensor
+//
+int hostTensors(int numElem, std::vector<int>& dim, std::vector<int>& permutation, int numSample,
+  std::vector<std::vector<int> >& dims, std::vector<std::vector<int> >& permutations) {
+
+  if (dim.size() > 0) {
+    dims.push_back(dim);
+    permutations.push_back(permutation);
+  } else {
+    for (int rank=2;rank <= 7;rank++) {
+      std::vector<int> dimr(rank);
+      std::vector<int> permutationr(rank);
+      for (int r=0;r < rank;r++) permutationr[r] = r;
+      for (int nsample=0;nsample < numSample;nsample++) {
+        std::random_shuffle(permutationr.begin(), permutationr.end());
+        getRandomDim((double)numElem, dimr);
+        dims.push_back(dimr);
+        permutations.push_back(permutationr);
+      }
+    }
+  }
+
+  int maxVol = 0;
+  for (int i=0;i < (int)dims.size();i++) {
+    int vol = 1;
+    for (int r=0;r < (int)dims[i].size();r++) vol *= dims[i][r];
+    maxVol = std::max(maxVol, vol);
+  }
+  return maxVol;
+}
+
+//
+// Benchmarks host transposes (cuttPlanHost, or cuttPlanHostMeasure with -measure) of dim and
+// permutation, or of random tensors of ranks 2-7 with numElem elements. Bandwidths are also reported
+// relative to the host copy. Timed executions are written to outputFile with label "host" unless
+// it is NULL
+//
+template <typename T>
+bool bench_host(int numElem, std::vector<int>& dim, std::vector<int>& permutation, const char* outputFile) {
+
+  std::vector<std::vector<int> > dims;
+  std::vector<std::vector<int> > permutations;
+  int maxVol = hostTensors(numElem, dim, permutation, 10, dims, permutations);
+  if (dim.size() > 0) numElem = maxVol;
+
+  double copyGBs = bench_host_memcpy<T>(numElem);
+  if (copyGBs == 0.0) return false;
+
+  std::vector<T> hostIn(maxVol);
+  std::vector<T> hostOut(maxVol);
+  TensorTester::setTensorCheckPatternHost((unsigned int *)hostIn.data(), maxVol*sizeof(T)/sizeof(unsigned int));
+
+  cuttTimer hostTimer(sizeof(T), TimerClockSteady);
+  for (int i=0;i < (int)dims.size();i++) {
+    int rank = dims[i].size();
+    printf("dimensions\n");
+    printVec(dims[i]);
+    printf("permutation\n");
+    printVec(permutations[i]);
+
+    cuttHandle plan;
+    if (use_cuttPlanMeasure) {
+      cuttCheck(cuttPlanHostMeasure(&plan, rank, dims[i].data(), permutations[i].data(), sizeof(T), 0,
+        hostIn.data(), hostOut.data()));
+    } else {
+      cuttCheck(cuttPlanHost(&plan, rank, dims[i].data(), permutations[i].data(), sizeof(T), 0));
+    }
+    for (int j=0;j < numWarmup;j++) {
+      cuttCheck(cuttExecute(plan, hostIn.data(), hostOut.data()));
+    }
+    for (int j=0;j < numRep;j++) {
+      hostTimer.start(dims[i], permutations[i]);
+      cuttCheck(cuttExecute(plan, hostIn.data(), hostOut.data()));
+      hostTimer.stop();
+      printf("wall time %lf ms %lf GB/s %3.0lf%% of copy\n", hostTimer.seconds()*1000.0, hostTimer.GBs(),
+        hostTimer.GBs()/copyGBs*100.0);
+    }
+    cuttCheck(cuttDestroy(plan));
+    if (!TensorTester::checkTransposeHost<T>(rank, dims[i].data(), permutations[i].data(), hostOut.data())) return false;
+  }
+
+  for (auto it=hostTimer.ranksBegin();it != hostTimer.ranksEnd();it++) {
+    double avgBW = hostTimer.getAverage(*it);
+    printf("rank %d avg %4.2lf GB/s %3.0lf%% of copy\n", *it, avgBW, avgBW/copyGBs*100.0);
+  }
+
+  if (outputFile != NULL && !hostTimer.writeSamples(outputFile, "host")) printf("unable to write %s\n", outputFile);
+
+  return true;
+}
+
+//
+// Benchmarks host transposes of dim and permutation, or of one random tensor of each of ranks 2-7
+// with numElem elements, on the threads of each NUMA node alone, and with the NUMA placements on all
+// nodes. Every run writes freshly allocated output placed with cuttHostTouch(). For the placements
+// the share of the output pages on each node is reported as well
+//
+template <typename T>
+bool bench_host_numa(int numElem, std::vector<int>& dim, std::vector<int>& permutation) {
+
+  std::vector<std::vector<int> > dims;
+  std::vector<std::vector<int> > permutations;
+  int maxVol = hostTensors(numElem, dim, permutation, 1, dims, permutations);
+
+  const std::vector<HostNumaNode>& nodes = hostNumaNodes();
+  printf("%d NUMA nodes\n", (int)nodes.size());
+  for (int n=0;n < (int)nodes.size();n++) printf("node %d: %d CPUs\n", nodes[n].id, (int)nodes[n].cpus.size());
+
+  std::vector<T> hostIn(maxVol);
+  TensorTester::setTensorCheckPatternHost((unsigned int *)hostIn.data(), maxVol*sizeof(T)/sizeof(unsigned int));
+
+  // Each node alone, then the placements on all nodes
+  std::vector<cuttHostOptions> runs;
+  std::vector<std::string> labels;
+  for (int n=0;n < (int)nodes.size();n++) {
+    if (nodes[n].id >= 64) continue;
+    cuttHostOptions options = {(int)nodes[n].cpus.size(), CUTT_HOST_PLACEMENT_NODE_MASK, 1ULL << nodes[n].id};
+    runs.push_back(options);
+    labels.push_back("node " + std::to_string(nodes[n].id));
+  }
+  const char* placementNames[3] = {"none", "first-touch", "interleave"};
+  for (int placement=CUTT_HOST_PLACEMENT_NONE;placement <= CUTT_HOST_PLACEMENT_INTERLEAVE;placement++) {
+    cuttHostOptions options = {0, (cuttHostPlacement)placement, 0};
+    runs.push_back(options);
+    labels.push_back(placementNames[placement]);
+  }
+
+  const size_t pageBytes = 4096;
+  for (int i=0;i < (int)dims.size();i++) {
+    int rank = dims[i].size();
+    int vol = 1;
+    for (int r=0;r < rank;r++) vol *= dims[i][r];
+    printf("dimensions\n");
+    printVec(dims[i]);
+    printf("permutation\n");
+    printVec(permutations[i]);
+
+    for (int j=0;j < (int)runs.size();j++) {
+      cuttHandle plan;
+      cuttCheck(cuttPlanHostWithOptions(&plan, rank, dims[i].data(), permutations[i].data(), sizeof(T), &runs[j]));
+      // Not initialized, so that cuttHostTouch() places the pages
+      std::unique_ptr<T[]> hostOut(new T[vol]);
+      cuttCheck(cuttHostTouch(plan, hostOut.get()));
+      for (int k=0;k < numWarmup;k++) {
+        cuttCheck(cuttExecute(plan, hostIn.data(), hostOut.get()));
+      }
+      cuttTimer hostTimer(sizeof(T), TimerClockSteady);
+      double bestGBs = 0.0;
+      for (int k=0;k < numRep;k++) {
+        hostTimer.start(dims[i], permutations[i]);
+        cuttCheck(cuttExecute(plan, hostIn.data(), hostOut.get()));
+        hostTimer.stop();
+        bestGBs = std::max(bestGBs, hostTimer.GBs());
+      }
+      cuttCheck(cuttDestroy(plan));
+      if (!TensorTester::checkTransposeHost<T>(rank, dims[i].data(), permutations[i].data(), hostOut.get())) return false;
+
+      printf("%-12s %4.2lf GB/s", labels[j].c_str(), bestGBs);
+      if (runs[j].placement != CUTT_HOST_PLACEMENT_NODE_MASK && nodes.size() > 1) {
+        // Output pages on each node
+        std::vector<int> numPage(nodes.size(), 0);
+        int numKnown = 0;
+        for (size_t b=0;b < (size_t)vol*sizeof(T);b += pageBytes) {
+          int node = hostPageNode((const char *)hostOut.get() + b);
+          for (int n=0;n < (int)nodes.size();n++) {
+            if (nodes[n].id == node) {
+              numPage[n]++;
+              numKnown++;
+            }
+          }
+        }
+        for (int n=0;n < (int)nodes.size() && numKnown > 0;n++) {
+          printf(" node %d %3.0lf%% of pages", nodes[n].id, numPage[n]*100.0/numKnown);
+        }
+      }
+      printf("\n");
+    }
+  }
+
+  return true;
+}
+
 void printDeviceInfo() {
   int deviceID;
   cudaCheck(cudaGetDevice(&deviceID));
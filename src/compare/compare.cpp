@@ -0,0 +1,241 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+//
+// Compares two sets of benchmark results written by cutt_bench -output.
+// For every tensor timed in both, the ratio of median times (new/old) is computed together
+// with a bootstrap confidence interval. Tensors whose interval lies entirely above 1 + threshold
+// are flagged as regressions, entirely below 1 - threshold as improvements
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <random>
+#include "cuttTimer.h"  // percentileSorted
+
+static void split(const std::string& line, std::vector<std::string>& fields) {
+  fields.clear();
+  std::stringstream ss(line);
+  std::string field;
+  while (std::getline(ss, field, ',')) fields.push_back(field);
+}
+
+//
+// Reads results file into seconds per tensor. Returns false on error
+//
+bool readResults(const char* filename, std::map<std::string, std::vector<double> >& samples) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    fprintf(stderr, "Unable to open file %s\n", filename);
+    return false;
+  }
+  std::map<std::string, int> col;
+  std::vector<std::string> fields;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty()) continue;
+    split(line, fields);
+    if (fields[0] == "label") {
+      // Header, columns are looked up by name
+      col.clear();
+      for (int i=0;i < (int)fields.size();i++) col[fields[i]] = i;
+      const char* required[] = {"sizeof_type", "dim", "permutation", "seconds"};
+      for (int i=0;i < 4;i++) {
+        if (col.count(required[i]) == 0) {
+          fprintf(stderr, "File %s is missing column %s\n", filename, required[i]);
+          return false;
+        }
+      }
+      continue;
+    }
+    if (col.empty()) {
+      fprintf(stderr, "File %s has no header\n", filename);
+      return false;
+    }
+    if (fields.size() < col.size()) {
+      fprintf(stderr, "File %s has truncated line, skipping it\n", filename);
+      continue;
+    }
+    std::string tensor = fields[col["sizeof_type"]] + " " + fields[col["dim"]] + " " + fields[col["permutation"]];
+    double sec = atof(fields[col["seconds"]].c_str());
+    if (sec > 0.0) samples[tensor].push_back(sec);
+  }
+  return true;
+}
+
+//
+// Returns median of val, reorders val
+//
+double median(std::vector<double>& val) {
+  int n = val.size();
+  std::nth_element(val.begin(), val.begin() + n/2, val.end());
+  double med = val[n/2];
+  if (n % 2 == 0) {
+    med = 0.5*(med + *std::max_element(val.begin(), val.begin() + n/2));
+  }
+  return med;
+}
+
+//
+// Draws bootstrap resample of val into res
+//
+void resample(std::mt19937& gen, const std::vector<double>& val, std::vector<double>& res) {
+  std::uniform_int_distribution<int> pick(0, (int)val.size() - 1);
+  res.resize(val.size());
+  for (int i=0;i < (int)val.size();i++) res[i] = val[pick(gen)];
+}
+
+// Ratio of median times of one tensor with its confidence interval
+struct Comparison {
+  std::string tensor;
+  int numOld;
+  int numNew;
+  double ratio;
+  double lo;
+  double hi;
+  // Bootstrap ratios, one per resample
+  std::vector<double> boot;
+};
+
+int main(int argc, char *argv[]) {
+
+  std::vector<const char*> filenames;
+  double level = 0.95;
+  double threshold = 0.02;
+  int numResample = 2000;
+  unsigned seed = 1;
+  bool arg_ok = true;
+  for (int i=1;i < argc;i++) {
+    if (strcmp(argv[i], "-level") == 0 && i + 1 < argc) {
+      level = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-threshold") == 0 && i + 1 < argc) {
+      threshold = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-resamples") == 0 && i + 1 < argc) {
+      numResample = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+      seed = (unsigned)atoi(argv[++i]);
+    } else if (argv[i][0] == '-') {
+      arg_ok = false;
+      break;
+    } else {
+      filenames.push_back(argv[i]);
+    }
+  }
+
+  if (!arg_ok || filenames.size() != 2 || level <= 0.0 || level >= 1.0 || numResample < 1) {
+    printf("cutt_compare [options] old.csv new.csv\n");
+    printf("Compares benchmark results written by cutt_bench -output, tensor by tensor.\n");
+    printf("Ratio = (median time of new)/(median time of old), > 1 is slower\n");
+    printf("Options:\n");
+    printf("-level [float]     : confidence level of the bootstrap intervals (default is 0.95)\n");
+    printf("-threshold [float] : smallest relative change that is flagged (default is 0.02)\n");
+    printf("-resamples [int]   : number of bootstrap resamples (default is 2000)\n");
+    printf("-seed [int]        : seed of the resampling (default is 1)\n");
+    printf("Returns 1 if any tensor is a significant regression\n");
+    return 2;
+  }
+
+  std::map<std::string, std::vector<double> > oldSamples;
+  std::map<std::string, std::vector<double> > newSamples;
+  if (!readResults(filenames[0], oldSamples)) return 2;
+  if (!readResults(filenames[1], newSamples)) return 2;
+
+  std::mt19937 gen(seed);
+  std::vector<Comparison> comp;
+  std::vector<double> resOld;
+  std::vector<double> resNew;
+  int numOnlyOne = 0;
+  for (auto it=oldSamples.begin();it != oldSamples.end();it++) {
+    auto jt = newSamples.find(it->first);
+    if (jt == newSamples.end()) {
+      numOnlyOne++;
+      continue;
+    }
+    Comparison c;
+    c.tensor = it->first;
+    c.numOld = it->second.size();
+    c.numNew = jt->second.size();
+    resOld = it->second;
+    resNew = jt->second;
+    c.ratio = median(resNew)/median(resOld);
+    c.boot.resize(numResample);
+    for (int b=0;b < numResample;b++) {
+      resample(gen, it->second, resOld);
+      resample(gen, jt->second, resNew);
+      c.boot[b] = median(resNew)/median(resOld);
+    }
+    std::vector<double> sorted = c.boot;
+    std::sort(sorted.begin(), sorted.end());
+    c.lo = percentileSorted(sorted, 50.0*(1.0 - level));
+    c.hi = percentileSorted(sorted, 100.0 - 50.0*(1.0 - level));
+    comp.push_back(c);
+  }
+  numOnlyOne += newSamples.size() - comp.size();
+
+  if (comp.size() == 0) {
+    printf("No tensors in common\n");
+    return 2;
+  }
+
+  printf("%8s %8s %8s %8s %6s %6s  %s\n", "ratio", "lo", "hi", "", "n_old", "n_new", "sizeof dim permutation");
+  int numRegression = 0;
+  int numImprovement = 0;
+  for (int i=0;i < (int)comp.size();i++) {
+    const Comparison& c = comp[i];
+    const char* flag = "";
+    if (c.lo > 1.0 + threshold) {
+      flag = "SLOWER";
+      numRegression++;
+    } else if (c.hi < 1.0 - threshold) {
+      flag = "faster";
+      numImprovement++;
+    }
+    printf("%8.4lf %8.4lf %8.4lf %8s %6d %6d  %s\n", c.ratio, c.lo, c.hi, flag, c.numOld, c.numNew, c.tensor.c_str());
+  }
+
+  // Geometric mean of the ratios. Its interval comes from the same resamples of every tensor
+  double logSum = 0.0;
+  for (int i=0;i < (int)comp.size();i++) logSum += log(comp[i].ratio);
+  std::vector<double> bootMean(numResample, 0.0);
+  for (int b=0;b < numResample;b++) {
+    for (int i=0;i < (int)comp.size();i++) bootMean[b] += log(comp[i].boot[b]);
+    bootMean[b] = exp(bootMean[b]/(double)comp.size());
+  }
+  std::sort(bootMean.begin(), bootMean.end());
+  printf("\n%d tensors compared, %d not in both files\n", (int)comp.size(), numOnlyOne);
+  printf("geometric mean ratio %1.4lf [%1.4lf, %1.4lf] at %g%% confidence\n", exp(logSum/(double)comp.size()),
+    percentileSorted(bootMean, 50.0*(1.0 - level)), percentileSorted(bootMean, 100.0 - 50.0*(1.0 - level)),
+    100.0*level);
+  printf("%d significant regressions, %d significant improvements (threshold %g%%)\n",
+    numRegression, numImprovement, 100.0*threshold);
+
+  return (numRegression > 0) ? 1 : 0;
+}
@@ -23,18 +23,29 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 *******************************************************************************/
 #include <cuda.h>
-#include <list>
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include "CudaUtils.h"
 #include "CudaMem.h"
 #include "cuttplan.h"
 #include "cuttkernel.h"
 #include "cuttTimer.h"
+#include "cuttTelemetry.h"
+#include "cuttCapture.h"
+#include "cuttArena.h"
+#include "cuttGpuModel.h"  // posTableCache
+#include "cuttParallel.h"
+#include "cuttTrace.h"
+#include "cuttHost.h"
 #include "cutt.h"
 #include <atomic>
 #include <mutex>
 #include <cstdlib>
-// #include <chrono>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <chrono>
 
 // global Umpire allocator
 #ifdef CUTT_HAS_UMPIRE
@@ -45,6 +56,12 @@ umpire::Allocator cutt_umpire_allocator;
 static std::unordered_map<cuttHandle, cuttPlan_t* > planStorage;
 static std::mutex planStorageMutex;
 
+// Host plans, protected by planStorageMutex. Handles are shared with planStorage
+static std::unordered_map<cuttHandle, cuttHostPlan_t* > hostPlanStorage;
+
+// Execution statistics of destroyed plans, protected by planStorageMutex
+static cuttStats destroyedStats;
+
 // Current handle
 static std::atomic<cuttHandle> curHandle(0);
 
@@ -82,7 +99,8 @@ static cuttResult cuttPlanCheckInput(int rank, const int* dim, const int* permut
   }
   // Check permutation
   bool permutation_fail = false;
-  int* check = new int[rank];
+  PlanArenaScope arenaScope;
+  int* check = planArena().alloc<int>(rank);
   for (int i=0;i < rank;i++) check[i] = 0;
   for (int i=0;i < rank;i++) {
     if (permutation[i] < 0 || permutation[i] >= rank || check[permutation[i]]++) {
@@ -90,7 +108,6 @@ static cuttResult cuttPlanCheckInput(int rank, const int* dim, const int* permut
       break;
     }
   }
-  delete [] check;
   if (permutation_fail) return CUTT_INVALID_PARAMETER;  
 
   return CUTT_SUCCESS;
@@ -99,9 +116,11 @@ static cuttResult cuttPlanCheckInput(int rank, const int* dim, const int* permut
 cuttResult cuttPlan(cuttHandle* handle, int rank, const int* dim, const int* permutation, size_t sizeofType,
   cudaStream_t stream) {
 
-#ifdef ENABLE_NVTOOLS
-  gpuRangeStart("init");
-#endif
+  CUTT_TRACE_SCOPE("cuttPlan");
+
+  // Start planning with an empty scratch arena and position table cache
+  planArena().reset();
+  posTableCache().clear();
 
   // Check that input parameters are valid
   cuttResult inpCheck = cuttPlanCheckInput(rank, dim, permutation, sizeofType);
@@ -128,7 +147,7 @@ cuttResult cuttPlan(cuttHandle* handle, int rank, const int* dim, const int* per
   reduceRanks(rank, dim, permutation, redDim, redPermutation);
 
   // Create plans from reduced ranks
-  std::list<cuttPlan_t> plans;
+  PlanCandidates plans;
   // if (rank != redDim.size()) {
   //   if (!createPlans(redDim.size(), redDim.data(), redPermutation.data(), sizeofType, prop, plans)) return CUTT_INTERNAL_ERROR;
   // }
@@ -140,11 +159,6 @@ cuttResult cuttPlan(cuttHandle* handle, int rank, const int* dim, const int* per
   if (!cuttKernelDatabase(deviceID, prop)) return CUTT_INTERNAL_ERROR;
 #endif
 
-#ifdef ENABLE_NVTOOLS
-  gpuRangeStop();
-  gpuRangeStart("createPlans");
-#endif
-
   // std::chrono::high_resolution_clock::time_point plan_start;
   // plan_start = std::chrono::high_resolution_clock::now();
 
@@ -156,34 +170,24 @@ cuttResult cuttPlan(cuttHandle* handle, int rank, const int* dim, const int* per
   // double plan_duration = std::chrono::duration_cast< std::chrono::duration<double> >(plan_end - plan_start).count();
   // printf("createPlans took %lf ms\n", plan_duration*1000.0);
 
-#ifdef ENABLE_NVTOOLS
-  gpuRangeStop();
-  gpuRangeStart("countCycles");
-#endif
-
   // Count cycles
-  for (auto it=plans.begin();it != plans.end();it++) {
-    if (!it->countCycles(prop, 10)) return CUTT_INTERNAL_ERROR;
-  }
-
-#ifdef ENABLE_NVTOOLS
-  gpuRangeStop();
-  gpuRangeStart("rest");
-#endif
+  if (!plans.countCycles(prop, 10)) return CUTT_INTERNAL_ERROR;
 
   // Choose the plan
-  std::list<cuttPlan_t>::iterator bestPlan = choosePlanHeuristic(plans);
-  if (bestPlan == plans.end()) return CUTT_INTERNAL_ERROR;
-
-  // bestPlan->print();
+  int bestPlan = choosePlanHeuristic(plans);
+  if (bestPlan == -1) return CUTT_INTERNAL_ERROR;
 
-  // Create copy of the plan outside the list
+  // Build the chosen candidate into a plan
   cuttPlan_t* plan = new cuttPlan_t();
-  // NOTE: No deep copy needed here since device memory hasn't been allocated yet
-  *plan = *bestPlan;
-  // Set device pointers to NULL in the old copy of the plan so
-  // that they won't be deallocated later when the object is destroyed
-  bestPlan->nullDevicePointers();
+  if (!plans.setup(bestPlan, *plan)) {
+    delete plan;
+    return CUTT_INTERNAL_ERROR;
+  }
+
+  // plan->print();
+
+  // Keep the structure for cuttPlanUpdateDims()
+  plan->structure = std::make_shared<PlanStructure>(plans);
 
   // Set stream
   plan->setStream(stream);
@@ -191,21 +195,24 @@ cuttResult cuttPlan(cuttHandle* handle, int rank, const int* dim, const int* per
   // Activate plan
   plan->activate();
 
+  cuttCaptureRecordPlan(*plan);
+
   // Insert plan into storage
   {
     std::lock_guard<std::mutex> lock(planStorageMutex);
     planStorage.insert( {*handle, plan} );
   }
 
-#ifdef ENABLE_NVTOOLS
-  gpuRangeStop();
-#endif
-
   return CUTT_SUCCESS;
 }
 
 cuttResult cuttPlanMeasure(cuttHandle* handle, int rank, const int* dim, const int* permutation, size_t sizeofType,
   cudaStream_t stream, const void* idata, void* odata, const void* alpha, const void *beta) {
+  CUTT_TRACE_SCOPE("cuttPlanMeasure");
+
+  // Start planning with an empty scratch arena and position table cache
+  planArena().reset();
+  posTableCache().clear();
 
   // Check that input parameters are valid
   cuttResult inpCheck = cuttPlanCheckInput(rank, dim, permutation, sizeofType);
@@ -234,7 +241,7 @@ cuttResult cuttPlanMeasure(cuttHandle* handle, int rank, const int* dim, const i
   reduceRanks(rank, dim, permutation, redDim, redPermutation);
 
   // Create plans from reduced ranks
-  std::list<cuttPlan_t> plans;
+  PlanCandidates plans;
 #if 0
   // if (rank != redDim.size()) {
     if (!createPlans(redDim.size(), redDim.data(), redPermutation.data(), sizeofType, prop, plans)) return CUTT_INTERNAL_ERROR;
@@ -247,53 +254,56 @@ cuttResult cuttPlanMeasure(cuttHandle* handle, int rank, const int* dim, const i
     sizeofType, deviceID, prop, plans)) return CUTT_INTERNAL_ERROR;
 #endif
 
-  // // Count cycles
-  // for (auto it=plans.begin();it != plans.end();it++) {
-  //   if (!it->countCycles(prop, 10)) return CUTT_INTERNAL_ERROR;
-  // }
+  // Telemetry compares the measured choice against the heuristic choice
+  bool telemetry = cuttTelemetryEnabled();
+  int heurPlan = -1;
+  if (telemetry) {
+    // Count cycles
+    if (!plans.countCycles(prop, 10)) return CUTT_INTERNAL_ERROR;
+    heurPlan = choosePlanHeuristic(plans);
+  }
 
   // // Count the number of elements
   size_t numBytes = sizeofType;
   for (int i=0;i < rank;i++) numBytes *= dim[i];
 
-  // Choose the plan
+  // Choose the plan. Candidates are built and activated one at a time,
+  // the fastest one so far is kept
   double bestTime = 1.0e40;
-  auto bestPlan = plans.end();
+  int bestPlan = -1;
+  std::unique_ptr<cuttPlan_t> plan;
   Timer timer;
   std::vector<double> times;
-  for (auto it=plans.begin();it != plans.end();it++) {
+  for (int i=0;i < plans.size();i++) {
+    cuttPlan_t trial;
+    if (!plans.setup(i, trial)) return CUTT_INTERNAL_ERROR;
     // Activate plan
-    it->activate();
+    trial.activate();
     // Clear output data to invalidate caches
     set_device_array<char>((char *)odata, -1, numBytes);
     cudaCheck(cudaDeviceSynchronize());
     timer.start();
     // Execute plan
-    if (!cuttKernel(*it, idata, odata, alpha, beta)) return CUTT_INTERNAL_ERROR;
+    if (!cuttKernel(trial, idata, odata, alpha, beta)) return CUTT_INTERNAL_ERROR;
     timer.stop();
     double curTime = timer.seconds();
-    // it->print();
+    // trial.print();
     // printf("curTime %1.2lf\n", curTime*1000.0);
     times.push_back(curTime);
     if (curTime < bestTime) {
       bestTime = curTime;
-      bestPlan = it;
+      bestPlan = i;
+      plan.reset(new cuttPlan_t(std::move(trial)));
     }
   }
-  if (bestPlan == plans.end()) return CUTT_INTERNAL_ERROR;
+  if (bestPlan == -1) return CUTT_INTERNAL_ERROR;
 
-  // bestPlan = plans.begin();
-
-  // printMatlab(prop, plans, times);
-  // findMispredictionBest(plans, times, bestPlan, bestTime);
-  // bestPlan->print();
+  if (telemetry) {
+    cuttTelemetryRecord(prop, rank, dim, permutation, sizeofType, plans, times, heurPlan, bestPlan);
+  }
 
-  // Create copy of the plan outside the list
-  cuttPlan_t* plan = new cuttPlan_t();
-  *plan = *bestPlan;
-  // Set device pointers to NULL in the old copy of the plan so
-  // that they won't be deallocated later when the object is destroyed
-  bestPlan->nullDevicePointers();
+  // Keep the structure for cuttPlanUpdateDims()
+  plan->structure = std::make_shared<PlanStructure>(plans);
 
   // Set stream
   plan->setStream(stream);
@@ -301,42 +311,530 @@ cuttResult cuttPlanMeasure(cuttHandle* handle, int rank, const int* dim, const i
   // Activate plan
   plan->activate();
 
+  cuttCaptureRecordPlan(*plan);
+
   // Insert plan into storage
   {
     std::lock_guard<std::mutex> lock(planStorageMutex);
-    planStorage.insert( {*handle, plan} );
+    planStorage.insert( {*handle, plan.release()} );
+  }
+
+  return CUTT_SUCCESS;
+}
+
+cuttResult cuttPlanWithBudget(cuttHandle* handle, int rank, const int* dim, const int* permutation,
+  size_t sizeofType, cudaStream_t stream, double maxSeconds, bool* complete) {
+  CUTT_TRACE_SCOPE("cuttPlanWithBudget");
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  // Start planning with an empty scratch arena and position table cache
+  planArena().reset();
+  posTableCache().clear();
+
+  // Check that input parameters are valid
+  cuttResult inpCheck = cuttPlanCheckInput(rank, dim, permutation, sizeofType);
+  if (inpCheck != CUTT_SUCCESS) return inpCheck;
+  if (maxSeconds < 0.0) return CUTT_INVALID_PARAMETER;
+
+  // Prepare device
+  int deviceID;
+  cudaDeviceProp prop;
+  getDeviceProp(deviceID, prop);
+
+  // Reduce ranks
+  std::vector<int> redDim;
+  std::vector<int> redPermutation;
+  reduceRanks(rank, dim, permutation, redDim, redPermutation);
+
+  PlanCandidates plans;
+  if (!cuttPlan_t::createPlans(rank, dim, permutation, redDim.size(), redDim.data(), redPermutation.data(),
+    sizeofType, deviceID, prop, plans)) return CUTT_INTERNAL_ERROR;
+
+  // Count cycles in priority order until time runs out. At least one candidate is evaluated
+  std::vector<int> order;
+  plans.priorityOrder(order);
+  int numDone = 0;
+  {
+    cuttPlan_t scratch;
+    while (numDone < order.size()) {
+      if (numDone > 0 &&
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > maxSeconds) break;
+      if (!plans.countCycles(order[numDone], scratch, prop, 10)) return CUTT_INTERNAL_ERROR;
+      numDone++;
+    }
+  }
+  if (complete != NULL) *complete = (numDone == order.size());
+
+  // Choose among the evaluated candidates
+  int bestPlan = choosePlanHeuristic(plans, order.data(), numDone);
+  if (bestPlan == -1) return CUTT_INTERNAL_ERROR;
+
+  // Build the chosen candidate into a plan
+  std::unique_ptr<cuttPlan_t> plan(new cuttPlan_t());
+  if (!plans.setup(bestPlan, *plan)) return CUTT_INTERNAL_ERROR;
+
+  // Keep the structure for cuttPlanUpdateDims(). Candidates that were not evaluated count as competitive
+  plan->structure = std::make_shared<PlanStructure>(plans);
+
+  plan->setStream(stream);
+  plan->activate();
+
+  cuttCaptureRecordPlan(*plan);
+
+  // Insert plan into storage
+  *handle = curHandle++;
+  {
+    std::lock_guard<std::mutex> lock(planStorageMutex);
+    if (planStorage.count(*handle) != 0) return CUTT_INTERNAL_ERROR;
+    planStorage.insert( {*handle, plan.release()} );
   }
 
   return CUTT_SUCCESS;
 }
 
+//
+// One distinct problem of cuttPlanMany()
+//
+struct PlanManyProblem {
+  int rank;
+  const int* dim;
+  const int* permutation;
+  size_t sizeofType;
+  std::vector<int> redDim;
+  std::vector<int> redPermutation;
+  PlanCandidates plans;
+  int bestPlan;
+  std::shared_ptr<const PlanStructure> structure;
+};
+
+//
+// Returns key made of sizeofType, rank, and two arrays of length rank
+//
+static std::string planManyKey(const size_t sizeofType, const int rank, const int* first, const int* second) {
+  std::string key((const char*)&sizeofType, sizeof(size_t));
+  key.append((const char*)&rank, sizeof(int));
+  key.append((const char*)first, rank*sizeof(int));
+  key.append((const char*)second, rank*sizeof(int));
+  return key;
+}
+
+cuttResult cuttPlanMany(int count, cuttHandle* handles, const int* ranks, const int* const* dims,
+  const int* const* permutations, const size_t* sizeofTypes, cudaStream_t stream) {
+  CUTT_TRACE_SCOPE("cuttPlanMany");
+
+  if (count < 0) return CUTT_INVALID_PARAMETER;
+  if (count == 0) return CUTT_SUCCESS;
+
+  planArena().reset();
+  posTableCache().clear();
+
+  // Check all inputs before creating anything
+  for (int i=0;i < count;i++) {
+    cuttResult inpCheck = cuttPlanCheckInput(ranks[i], dims[i], permutations[i], sizeofTypes[i]);
+    if (inpCheck != CUTT_SUCCESS) return inpCheck;
+  }
+
+  // Prepare device
+  int deviceID;
+  cudaDeviceProp prop;
+  getDeviceProp(deviceID, prop);
+
+  // Deduplicate identical problems
+  std::vector<PlanManyProblem> problems;
+  std::vector<int> problemOf(count);
+  {
+    std::unordered_map<std::string, int> problemIndex;
+    for (int i=0;i < count;i++) {
+      std::string key = planManyKey(sizeofTypes[i], ranks[i], permutations[i], dims[i]);
+      auto it = problemIndex.find(key);
+      if (it == problemIndex.end()) {
+        problemIndex.insert( {key, (int)problems.size()} );
+        problemOf[i] = (int)problems.size();
+        problems.push_back(PlanManyProblem());
+        PlanManyProblem& problem = problems.back();
+        problem.rank = ranks[i];
+        problem.dim = dims[i];
+        problem.permutation = permutations[i];
+        problem.sizeofType = sizeofTypes[i];
+        problem.bestPlan = -1;
+        reduceRanks(problem.rank, problem.dim, problem.permutation, problem.redDim, problem.redPermutation);
+      } else {
+        problemOf[i] = it->second;
+      }
+    }
+  }
+
+  // Process problems in order of their reduced permutation and dimensions, so that related shapes
+  // are handled by the same thread one after another and share its position table cache
+  std::vector<int> order(problems.size());
+  std::vector<std::string> redKey(problems.size());
+  for (int i=0;i < (int)problems.size();i++) {
+    order[i] = i;
+    const PlanManyProblem& problem = problems[i];
+    redKey[i] = planManyKey(problem.sizeofType, (int)problem.redDim.size(), problem.redPermutation.data(),
+      problem.redDim.data());
+  }
+  std::sort(order.begin(), order.end(), [&](const int a, const int b) {return redKey[a] < redKey[b];});
+
+  const int numThread = cuttNumThreads();
+  std::atomic<bool> fail(false);
+
+  // Create candidates
+  parallelFor((int)order.size(), 1, numThread, [&](const int begin, const int end) {
+    cudaCheck(cudaSetDevice(deviceID));
+    for (int k=begin;k < end;k++) {
+      PlanManyProblem& problem = problems[order[k]];
+      if (!cuttPlan_t::createPlans(problem.rank, problem.dim, problem.permutation,
+        problem.redDim.size(), problem.redDim.data(), problem.redPermutation.data(),
+        problem.sizeofType, deviceID, prop, problem.plans)) fail = true;
+    }
+  });
+  if (fail) return CUTT_INTERNAL_ERROR;
+
+  // Count cycles of all candidates of all problems
+  std::vector<std::pair<int, int> > tasks;
+  for (int k=0;k < (int)order.size();k++) {
+    for (int j=0;j < problems[order[k]].plans.size();j++) {
+      tasks.push_back( {order[k], j} );
+    }
+  }
+  parallelFor((int)tasks.size(), 8, numThread, [&](const int begin, const int end) {
+    cudaCheck(cudaSetDevice(deviceID));
+    cudaDeviceProp propThread = prop;
+    cuttPlan_t plan;
+    int prevProblem = -1;
+    for (int k=begin;k < end;k++) {
+      PlanManyProblem& problem = problems[tasks[k].first];
+      // Position tables are only shared by problems with the same reduced permutation,
+      // drop them when moving on to the next group
+      if (prevProblem != -1 && problems[prevProblem].redPermutation != problem.redPermutation) {
+        posTableCache().clear();
+      }
+      prevProblem = tasks[k].first;
+      if (!problem.plans.countCycles(tasks[k].second, plan, propThread, 10)) fail = true;
+    }
+    posTableCache().clear();
+  });
+  if (fail) return CUTT_INTERNAL_ERROR;
+
+  // Choose the plans
+  for (int i=0;i < (int)problems.size();i++) {
+    problems[i].bestPlan = choosePlanHeuristic(problems[i].plans);
+    if (problems[i].bestPlan == -1) return CUTT_INTERNAL_ERROR;
+    problems[i].structure = std::make_shared<PlanStructure>(problems[i].plans);
+  }
+
+  // Build the chosen candidates into plans, one for each handle
+  for (int i=0;i < count;i++) {
+    const PlanManyProblem& problem = problems[problemOf[i]];
+    std::unique_ptr<cuttPlan_t> plan(new cuttPlan_t());
+    bool ok = problem.plans.setup(problem.bestPlan, *plan);
+    if (ok) {
+      plan->structure = problem.structure;
+      plan->setStream(stream);
+      plan->activate();
+      cuttCaptureRecordPlan(*plan);
+      handles[i] = curHandle++;
+      std::lock_guard<std::mutex> lock(planStorageMutex);
+      ok = (planStorage.count(handles[i]) == 0);
+      if (ok) planStorage.insert( {handles[i], plan.release()} );
+    }
+    if (!ok) {
+      // Destroy the plans created so far
+      for (int j=0;j < i;j++) cuttDestroy(handles[j]);
+      return CUTT_INTERNAL_ERROR;
+    }
+  }
+
+  return CUTT_SUCCESS;
+}
+
+//
+// Creates plan for dimensions dim[] from the candidates of structure, see cuttPlan_t::updatePlans()
+//
+static cuttResult cuttPlanFromStructure(std::shared_ptr<const PlanStructure> structure, const int* dim,
+  size_t sizeofType, cudaStream_t stream, int deviceID, cudaDeviceProp& prop, cuttPlan_t& plan) {
+
+  // Start planning with an empty scratch arena and position table cache
+  planArena().reset();
+  posTableCache().clear();
+
+  // Create candidates. If the splits are the same as in structure, only the ones that were
+  // competitive are evaluated, otherwise all of them
+  PlanCandidates plans;
+  bool reuse = cuttPlan_t::updatePlans(*structure, dim, sizeofType, deviceID, prop, plans);
+  if (plans.empty()) return CUTT_INTERNAL_ERROR;
+
+  // Count cycles and choose the plan
+  if (!plans.countCycles(prop, 10)) return CUTT_INTERNAL_ERROR;
+  int bestPlan = choosePlanHeuristic(plans);
+  if (bestPlan == -1) return CUTT_INTERNAL_ERROR;
+  if (!reuse) structure = std::make_shared<PlanStructure>(plans);
+
+  if (!plans.setup(bestPlan, plan)) return CUTT_INTERNAL_ERROR;
+  plan.structure = structure;
+  plan.setStream(stream);
+  plan.activate();
+
+  return CUTT_SUCCESS;
+}
+
 void CUDART_CB cuttDestroy_callback(cudaStream_t stream, cudaError_t status, void *userData){
   cuttPlan_t* plan = (cuttPlan_t*) userData;
   delete plan;
 }
 
+//
+// Deletes plan that has been removed from plan storage. With Umpire, deallocation is deferred
+// until the work queued on the stream of the plan is done, otherwise cudaFree() waits for it
+//
+static void releasePlan(cuttPlan_t* plan) {
+#ifdef CUTT_HAS_UMPIRE
+  // register callback to deallocate plan
+  cudaStreamAddCallback(plan->stream, cuttDestroy_callback, plan, 0);
+#else
+  // Delete instance of cuttPlan_t
+  delete plan;
+#endif
+}
+
+cuttResult cuttPlanUpdateDims(cuttHandle handle, const int* dim) {
+  CUTT_TRACE_SCOPE("cuttPlanUpdateDims");
+
+  std::shared_ptr<const PlanStructure> structure;
+  size_t sizeofType;
+  cudaStream_t stream;
+  int planDeviceID;
+  {
+    std::lock_guard<std::mutex> lock(planStorageMutex);
+    auto it = planStorage.find(handle);
+    if (it == planStorage.end()) return CUTT_INVALID_PLAN;
+    structure = it->second->structure;
+    sizeofType = it->second->sizeofType;
+    stream = it->second->stream;
+    planDeviceID = it->second->deviceID;
+  }
+  if (structure == NULL) return CUTT_INVALID_PLAN;
+
+  // Check that input parameters are valid
+  const int rank = structure->permutation.size();
+  cuttResult inpCheck = cuttPlanCheckInput(rank, dim, structure->permutation.data(), sizeofType);
+  if (inpCheck != CUTT_SUCCESS) return inpCheck;
+
+  // Prepare device
+  int deviceID;
+  cudaDeviceProp prop;
+  getDeviceProp(deviceID, prop);
+  if (deviceID != planDeviceID) return CUTT_INVALID_DEVICE;
+
+  cuttPlan_t plan;
+  cuttResult res = cuttPlanFromStructure(structure, dim, sizeofType, stream, deviceID, prop, plan);
+  if (res != CUTT_SUCCESS) return res;
+
+  cuttCaptureRecordPlan(plan);
+
+  // Replace the plan behind the handle. The old plan is released as in cuttDestroy(), its device
+  // buffers may still be read by executions queued on its stream
+  cuttPlan_t* oldPlan;
+  {
+    std::lock_guard<std::mutex> lock(planStorageMutex);
+    auto it = planStorage.find(handle);
+    if (it == planStorage.end()) return CUTT_INVALID_PLAN;
+    // Statistics belong to the handle
+    plan.stats = std::move(it->second->stats);
+    oldPlan = new cuttPlan_t(std::move(*(it->second)));
+    *(it->second) = std::move(plan);
+  }
+  releasePlan(oldPlan);
+
+  return CUTT_SUCCESS;
+}
+
+cuttResult cuttPlanInverse(cuttHandle handle, cuttHandle* invHandle) {
+  CUTT_TRACE_SCOPE("cuttPlanInverse");
+
+  std::shared_ptr<const PlanStructure> structure;
+  std::vector<int> dim;
+  size_t sizeofType;
+  cudaStream_t stream;
+  int planDeviceID;
+  {
+    std::lock_guard<std::mutex> lock(planStorageMutex);
+    auto it = planStorage.find(handle);
+    if (it == planStorage.end()) return CUTT_INVALID_PLAN;
+    structure = it->second->structure;
+    dim = it->second->tensorDim;
+    sizeofType = it->second->sizeofType;
+    stream = it->second->stream;
+    planDeviceID = it->second->deviceID;
+  }
+  if (structure == NULL || dim.size() != structure->permutation.size()) return CUTT_INVALID_PLAN;
+
+  // Input of the inverse transpose is the output of the plan
+  const int rank = dim.size();
+  std::vector<int> invDim(rank);
+  for (int i=0;i < rank;i++) invDim[i] = dim[structure->permutation[i]];
+
+  // Prepare device
+  int deviceID;
+  cudaDeviceProp prop;
+  getDeviceProp(deviceID, prop);
+  if (deviceID != planDeviceID) return CUTT_INVALID_DEVICE;
+
+  std::unique_ptr<cuttPlan_t> plan(new cuttPlan_t());
+  cuttResult res = cuttPlanFromStructure(structure->inverse(), invDim.data(), sizeofType, stream,
+    deviceID, prop, *plan);
+  if (res != CUTT_SUCCESS) return res;
+
+  cuttCaptureRecordPlan(*plan);
+
+  // Insert plan into storage
+  *invHandle = curHandle++;
+  {
+    std::lock_guard<std::mutex> lock(planStorageMutex);
+    if (planStorage.count(*invHandle) != 0) return CUTT_INTERNAL_ERROR;
+    planStorage.insert( {*invHandle, plan.release()} );
+  }
+
+  return CUTT_SUCCESS;
+}
+
+cuttResult cuttPlanHost(cuttHandle* handle, int rank, const int* dim, const int* permutation,
+  size_t sizeofType, int numThread) {
+
+  CUTT_TRACE_SCOPE("cuttPlanHost");
+
+  cuttResult inpCheck = cuttPlanCheckInput(rank, dim, permutation, sizeofType);
+  if (inpCheck != CUTT_SUCCESS) return inpCheck;
+  if (numThread < 0) return CUTT_INVALID_PARAMETER;
+
+  std::unique_ptr<cuttHostPlan_t> plan(new cuttHostPlan_t());
+  if (!plan->setup(rank, dim, permutation, sizeofType, numThread)) return CUTT_INTERNAL_ERROR;
+
+  *handle = curHandle++;
+  {
+    std::lock_guard<std::mutex> lock(planStorageMutex);
+    if (planStorage.count(*handle) != 0 || hostPlanStorage.count(*handle) != 0) return CUTT_INTERNAL_ERROR;
+    hostPlanStorage.insert( {*handle, plan.release()} );
+  }
+  return CUTT_SUCCESS;
+}
+
+cuttResult cuttPlanHostWithOptions(cuttHandle* handle, int rank, const int* dim, const int* permutation,
+  size_t sizeofType, const cuttHostOptions* options) {
+
+  CUTT_TRACE_SCOPE("cuttPlanHostWithOptions");
+
+  cuttHostOptions opt = {0, CUTT_HOST_PLACEMENT_NONE, 0};
+  if (options != NULL) opt = *options;
+
+  cuttResult inpCheck = cuttPlanCheckInput(rank, dim, permutation, sizeofType);
+  if (inpCheck != CUTT_SUCCESS) return inpCheck;
+  if (opt.numThread < 0 || opt.placement < CUTT_HOST_PLACEMENT_NONE ||
+    opt.placement > CUTT_HOST_PLACEMENT_NODE_MASK) return CUTT_INVALID_PARAMETER;
+
+  std::unique_ptr<cuttHostPlan_t> plan(new cuttHostPlan_t());
+  // Fails only for a node mask without nodes of the host
+  if (!plan->setup(rank, dim, permutation, sizeofType, opt.numThread, opt.placement, opt.nodeMask)) {
+    return CUTT_INVALID_PARAMETER;
+  }
+
+  *handle = curHandle++;
+  {
+    std::lock_guard<std::mutex> lock(planStorageMutex);
+    if (planStorage.count(*handle) != 0 || hostPlanStorage.count(*handle) != 0) return CUTT_INTERNAL_ERROR;
+    hostPlanStorage.insert( {*handle, plan.release()} );
+  }
+  return CUTT_SUCCESS;
+}
+
+cuttResult cuttHostTouch(cuttHandle handle, void* odata) {
+  CUTT_TRACE_SCOPE("cuttHostTouch");
+  cuttHostPlan_t* hostPlan = NULL;
+  {
+    std::lock_guard<std::mutex> lock(planStorageMutex);
+    auto it = hostPlanStorage.find(handle);
+    if (it != hostPlanStorage.end()) hostPlan = it->second;
+  }
+  if (hostPlan == NULL) return CUTT_INVALID_PLAN;
+  hostPlan->touch(odata);
+  return CUTT_SUCCESS;
+}
+
+cuttResult cuttPlanHostMeasure(cuttHandle* handle, int rank, const int* dim, const int* permutation,
+  size_t sizeofType, int numThread, const void* idata, void* odata) {
+
+  CUTT_TRACE_SCOPE("cuttPlanHostMeasure");
+
+  cuttResult inpCheck = cuttPlanCheckInput(rank, dim, permutation, sizeofType);
+  if (inpCheck != CUTT_SUCCESS) return inpCheck;
+  if (numThread < 0 || idata == odata) return CUTT_INVALID_PARAMETER;
+
+  std::unique_ptr<cuttHostPlan_t> plan(new cuttHostPlan_t());
+  if (!plan->setup(rank, dim, permutation, sizeofType, numThread)) return CUTT_INTERNAL_ERROR;
+  plan->measure(idata, odata);
+
+  *handle = curHandle++;
+  {
+    std::lock_guard<std::mutex> lock(planStorageMutex);
+    if (planStorage.count(*handle) != 0 || hostPlanStorage.count(*handle) != 0) return CUTT_INTERNAL_ERROR;
+    hostPlanStorage.insert( {*handle, plan.release()} );
+  }
+  return CUTT_SUCCESS;
+}
+
 cuttResult cuttDestroy(cuttHandle handle) {
   std::lock_guard<std::mutex> lock(planStorageMutex);
+  auto hostIt = hostPlanStorage.find(handle);
+  if (hostIt != hostPlanStorage.end()) {
+    addStats(destroyedStats, hostIt->second->stats);
+    delete hostIt->second;
+    hostPlanStorage.erase(hostIt);
+    return CUTT_SUCCESS;
+  }
   auto it = planStorage.find(handle);
   if (it == planStorage.end()) return CUTT_INVALID_PLAN;
-#ifdef CUTT_HAS_UMPIRE
+  if (it->second->stats != NULL) addStats(destroyedStats, it->second->stats->get());
+  // Statistics own CUDA events, destroy them here and not in the deferred callback of releasePlan()
+  it->second->stats.reset();
   // get the pointer cuttPlan_t
   cuttPlan_t* plan = it->second;
-  cudaStream_t stream = plan->stream;
   // Delete entry from plan storage
   planStorage.erase(it);
-  // register callback to deallocate plan
-  cudaStreamAddCallback(stream, cuttDestroy_callback, plan, 0);
-#else
-  // Delete instance of cuttPlan_t	 
-  delete it->second;	  
-  // Delete entry from plan storage	  
-  planStorage.erase(it);
-#endif
+  releasePlan(plan);
   return CUTT_SUCCESS;
 }
 
 cuttResult cuttExecute(cuttHandle handle, const void* idata, void* odata, const void* alpha, const void* beta) {
+  CUTT_TRACE_SCOPE("cuttExecute");
+  // Host plans are executed without holding the lock, so that they can run concurrently
+  cuttHostPlan_t* hostPlan = NULL;
+  {
+    std::lock_guard<std::mutex> lock(planStorageMutex);
+    auto it = hostPlanStorage.find(handle);
+    if (it != hostPlanStorage.end()) hostPlan = it->second;
+  }
+  if (hostPlan != NULL) {
+    if (idata == odata) return CUTT_INVALID_PARAMETER;
+    if (!statsEnabled()) {
+      hostPlan->execute(idata, odata, alpha, beta);
+      return CUTT_SUCCESS;
+    }
+    // Host execution is synchronous, every execution is timed
+    bool readOut = (beta != NULL) &&
+      ((hostPlan->sizeofType == 4 && *((float*)beta) != 0) || (hostPlan->sizeofType == 8 && *((double*)beta) != 0));
+    auto start = std::chrono::steady_clock::now();
+    hostPlan->execute(idata, odata, alpha, beta);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(planStorageMutex);
+    hostPlan->stats.numExecute++;
+    hostPlan->stats.numBytes += hostPlan->executeBytes(readOut);
+    hostPlan->stats.numTimed++;
+    hostPlan->stats.seconds += seconds;
+    return CUTT_SUCCESS;
+  }
+
   // prevent modification when find
   std::lock_guard<std::mutex> lock(planStorageMutex);
   auto it = planStorage.find(handle);
@@ -350,7 +848,112 @@ cuttResult cuttExecute(cuttHandle handle, const void* idata, void* odata, const
   cudaCheck(cudaGetDevice(&deviceID));
   if (deviceID != plan.deviceID) return CUTT_INVALID_DEVICE;
 
+  cuttCaptureRecordExecute(plan, alpha, beta);
+
+  if (!statsEnabled()) {
+    if (!cuttKernel(plan, idata, odata, alpha, beta)) return CUTT_INTERNAL_ERROR;
+    return CUTT_SUCCESS;
+  }
+
+  // Input is read and output written, and also read unless beta is zero
+  size_t bytes = (size_t)plan.tensorSplit.volMmk*(size_t)plan.tensorSplit.volMbar*plan.sizeofType;
+  bool readOut = (beta != NULL) &&
+    ((plan.sizeofType == 4 && *((float*)beta) != 0) || (plan.sizeofType == 8 && *((double*)beta) != 0));
+  bytes *= (readOut ? 3 : 2);
+
+  if (plan.stats == NULL) plan.stats.reset(new PlanStats());
+  plan.stats->begin(plan.stream);
   if (!cuttKernel(plan, idata, odata, alpha, beta)) return CUTT_INTERNAL_ERROR;
+  plan.stats->end(plan.stream, bytes);
+  return CUTT_SUCCESS;
+}
+
+cuttResult cuttPlanMemory(cuttHandle handle, size_t* hostBytes, size_t* deviceBytes) {
+  if (hostBytes == NULL || deviceBytes == NULL) return CUTT_INVALID_PARAMETER;
+  std::lock_guard<std::mutex> lock(planStorageMutex);
+  auto hostIt = hostPlanStorage.find(handle);
+  if (hostIt != hostPlanStorage.end()) {
+    *hostBytes = hostIt->second->memoryUsage();
+    *deviceBytes = 0;
+    return CUTT_SUCCESS;
+  }
+  auto it = planStorage.find(handle);
+  if (it == planStorage.end()) return CUTT_INVALID_PLAN;
+  *hostBytes = it->second->hostMemoryUsage();
+  *deviceBytes = it->second->deviceMemoryUsage();
+  return CUTT_SUCCESS;
+}
+
+cuttResult cuttPlanTrim(cuttHandle handle) {
+  std::lock_guard<std::mutex> lock(planStorageMutex);
+  auto hostIt = hostPlanStorage.find(handle);
+  if (hostIt != hostPlanStorage.end()) {
+    hostIt->second->dropAnalysis();
+    return CUTT_SUCCESS;
+  }
+  auto it = planStorage.find(handle);
+  if (it == planStorage.end()) return CUTT_INVALID_PLAN;
+  it->second->dropAnalysis();
+  return CUTT_SUCCESS;
+}
+
+cuttResult cuttPlanMemoryTotal(size_t* numPlan, size_t* hostBytes, size_t* deviceBytes) {
+  if (numPlan == NULL || hostBytes == NULL || deviceBytes == NULL) return CUTT_INVALID_PARAMETER;
+  std::lock_guard<std::mutex> lock(planStorageMutex);
+  *numPlan = planStorage.size() + hostPlanStorage.size();
+  *hostBytes = 0;
+  *deviceBytes = 0;
+  // Plans of duplicate problems share their structure, count each structure once
+  std::unordered_set<const PlanStructure*> structures;
+  for (auto it=planStorage.begin();it != planStorage.end();it++) {
+    const PlanStructure* structure = it->second->structure.get();
+    bool first = (structure != NULL && structures.insert(structure).second);
+    *hostBytes += it->second->hostMemoryUsage(first);
+    *deviceBytes += it->second->deviceMemoryUsage();
+  }
+  for (auto it=hostPlanStorage.begin();it != hostPlanStorage.end();it++) {
+    *hostBytes += it->second->memoryUsage();
+  }
+  return CUTT_SUCCESS;
+}
+
+cuttResult cuttGetStats(cuttHandle handle, cuttStats* stats) {
+  if (stats == NULL) return CUTT_INVALID_PARAMETER;
+  std::lock_guard<std::mutex> lock(planStorageMutex);
+  auto hostIt = hostPlanStorage.find(handle);
+  if (hostIt != hostPlanStorage.end()) {
+    *stats = hostIt->second->stats;
+    return CUTT_SUCCESS;
+  }
+  auto it = planStorage.find(handle);
+  if (it == planStorage.end()) return CUTT_INVALID_PLAN;
+  memset(stats, 0, sizeof(cuttStats));
+  if (it->second->stats != NULL) *stats = it->second->stats->get();
+  return CUTT_SUCCESS;
+}
+
+cuttResult cuttGetStatsTotal(size_t* numPlan, cuttStats* stats) {
+  if (numPlan == NULL || stats == NULL) return CUTT_INVALID_PARAMETER;
+  std::lock_guard<std::mutex> lock(planStorageMutex);
+  *numPlan = planStorage.size() + hostPlanStorage.size();
+  *stats = destroyedStats;
+  for (auto it=planStorage.begin();it != planStorage.end();it++) {
+    if (it->second->stats != NULL) addStats(*stats, it->second->stats->get());
+  }
+  for (auto it=hostPlanStorage.begin();it != hostPlanStorage.end();it++) {
+    addStats(*stats, it->second->stats);
+  }
+  return CUTT_SUCCESS;
+}
+
+cuttResult cuttPlanTrimAll() {
+  std::lock_guard<std::mutex> lock(planStorageMutex);
+  for (auto it=planStorage.begin();it != planStorage.end();it++) {
+    it->second->dropAnalysis();
+  }
+  for (auto it=hostPlanStorage.begin();it != hostPlanStorage.end();it++) {
+    it->second->dropAnalysis();
+  }
   return CUTT_SUCCESS;
 }
 
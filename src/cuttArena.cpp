@@ -0,0 +1,145 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <cstdlib>
+#include <new>                  // std::bad_alloc
+#include <algorithm>
+#include "cuttArena.h"
+
+// Size of the first block
+const size_t ARENA_BLOCK_MIN = 64*1024;
+
+#ifdef NO_ALIGNED_ALLOC
+//
+// From: http://stackoverflow.com/questions/12504776/aligned-malloc-in-c
+//
+void *aligned_malloc(size_t required_bytes, size_t alignment) {
+    void *p1;
+    void **p2;
+    int offset=alignment-1+sizeof(void*);
+    p1 = malloc(required_bytes + offset);               // the line you are missing
+    if (p1 == NULL) return NULL;
+    p2=(void**)(((size_t)(p1)+offset)&~(alignment-1));  //line 5
+    p2[-1]=p1; //line 6
+    return p2;
+}
+
+void aligned_free( void* p ) {
+    void* p1 = ((void**)p)[-1];         // get the pointer to the buffer we allocated
+    free( p1 );
+}
+#endif
+
+static char* allocBlock(const size_t size) {
+#ifdef NO_ALIGNED_ALLOC
+  void* p = aligned_malloc(size, PlanArena::ALIGN);
+#else
+  void* p = aligned_alloc(PlanArena::ALIGN, size);
+#endif
+  if (p == NULL) throw std::bad_alloc();
+  return (char *)p;
+}
+
+static void freeBlock(char* p) {
+#ifdef NO_ALIGNED_ALLOC
+  aligned_free(p);
+#else
+  free(p);
+#endif
+}
+
+PlanArena::PlanArena() : cur(-1), offset(0), used(0), highWater(0) {}
+
+PlanArena::~PlanArena() {
+  for (int i=0;i < (int)blocks.size();i++) freeBlock(blocks[i].ptr);
+}
+
+void* PlanArena::allocBytes(size_t bytes) {
+  bytes = (bytes + ALIGN - 1) & ~(ALIGN - 1);
+  if (bytes == 0) bytes = ALIGN;
+  // Move on to the next block until one has room. Blocks that are too small stay in place
+  // and are replaced by reset()
+  while (cur < 0 || offset + bytes > blocks[cur].size) {
+    if (cur + 1 == (int)blocks.size()) {
+      size_t size = std::max(ARENA_BLOCK_MIN, bytes);
+      if (!blocks.empty()) size = std::max(size, 2*blocks.back().size);
+      Block block;
+      block.ptr = allocBlock(size);
+      block.size = size;
+      blocks.push_back(block);
+    }
+    if (cur >= 0) used += blocks[cur].size - offset;
+    cur++;
+    offset = 0;
+  }
+  void* p = blocks[cur].ptr + offset;
+  offset += bytes;
+  used += bytes;
+  highWater = std::max(highWater, used);
+  return p;
+}
+
+PlanArena::Mark PlanArena::getMark() const {
+  Mark mark;
+  mark.block = cur;
+  mark.offset = offset;
+  return mark;
+}
+
+void PlanArena::rewind(const Mark& mark) {
+  // Bytes handed out from the blocks between mark and the current position
+  while (cur > mark.block) {
+    used -= offset;
+    cur--;
+    offset = (cur >= 0) ? blocks[cur].size : 0;
+  }
+  if (cur >= 0) used -= offset - mark.offset;
+  offset = mark.offset;
+}
+
+void PlanArena::reset() {
+  if (blocks.size() > 1) {
+    size_t size = std::max(capacity(), highWater);
+    for (int i=0;i < (int)blocks.size();i++) freeBlock(blocks[i].ptr);
+    blocks.clear();
+    Block block;
+    block.ptr = allocBlock(size);
+    block.size = size;
+    blocks.push_back(block);
+  }
+  cur = blocks.empty() ? -1 : 0;
+  offset = 0;
+  used = 0;
+}
+
+size_t PlanArena::capacity() const {
+  size_t size = 0;
+  for (int i=0;i < (int)blocks.size();i++) size += blocks[i].size;
+  return size;
+}
+
+PlanArena& planArena() {
+  static thread_local PlanArena arena;
+  return arena;
+}
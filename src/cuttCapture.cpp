@@ -0,0 +1,112 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <map>
+#include <mutex>
+#include "cuttCapture.h"
+#include "cuttTimer.h"  // intList
+
+// Name of the capture file, empty if capture is disabled
+static std::string captureFileName() {
+  const char* env = std::getenv("CUTT_CAPTURE_FILE");
+  return (env != NULL) ? std::string(env) : std::string();
+}
+
+// Columns of the capture file
+static const char* captureHeader = "event,count,sizeof_type,rank,dim,permutation,alpha,beta\n";
+
+//
+// Counts per problem, written into the capture file at exit
+//
+class CaptureLog {
+public:
+  std::string fileName;
+  std::mutex mutex;
+  // Key is the capture row without the count, value is the count
+  std::map<std::string, unsigned long long> count;
+
+  CaptureLog() : fileName(captureFileName()) {}
+
+  ~CaptureLog() {
+    if (fileName.empty() || count.empty()) return;
+    FILE* fp = fopen(fileName.c_str(), "a");
+    if (fp == NULL) {
+      fprintf(stderr, "cuTT capture, unable to open file %s\n", fileName.c_str());
+      return;
+    }
+    // Write header if this is a new file
+    fseek(fp, 0, SEEK_END);
+    if (ftell(fp) == 0) fputs(captureHeader, fp);
+    for (auto it=count.begin();it != count.end();it++) {
+      // Event name is the first field of the key
+      size_t pos = it->first.find(',');
+      fprintf(fp, "%s,%llu%s\n", it->first.substr(0, pos).c_str(), it->second, it->first.substr(pos).c_str());
+    }
+    fclose(fp);
+  }
+};
+
+static CaptureLog captureLog;
+
+// Set before any plan is made and not changed afterwards
+static const bool captureOn = !captureLog.fileName.empty();
+
+//
+// Returns the capture row of plan without the count
+//
+static std::string captureKey(const char* event, const cuttPlan_t& plan, const double alpha, const double beta) {
+  const std::vector<int>& dim = plan.tensorDim;
+  std::vector<int> permutation;
+  if (plan.structure != NULL) permutation = plan.structure->permutation;
+  char buf[64];
+  snprintf(buf, sizeof(buf), ",%.17g,%.17g", alpha, beta);
+  return std::string(event) + "," + std::to_string(plan.sizeofType) + "," + std::to_string(dim.size()) + "," +
+    intList(dim) + "," + intList(permutation) + buf;
+}
+
+bool cuttCaptureEnabled() {
+  return captureOn;
+}
+
+void cuttCaptureRecordPlan(const cuttPlan_t& plan) {
+  if (!captureOn) return;
+  std::string key = captureKey("plan", plan, 1.0, 0.0);
+  std::lock_guard<std::mutex> lock(captureLog.mutex);
+  captureLog.count[key]++;
+}
+
+void cuttCaptureRecordExecute(const cuttPlan_t& plan, const void* alphaPtr, const void* betaPtr) {
+  if (!captureOn) return;
+  // Same conversion as in cuttKernel()
+  double alpha = 1;
+  double beta = 0;
+  if (alphaPtr != NULL) alpha = (plan.sizeofType == 4) ? *((float*)alphaPtr) : *((double*)alphaPtr);
+  if (betaPtr != NULL) beta = (plan.sizeofType == 4) ? *((float*)betaPtr) : *((double*)betaPtr);
+  std::string key = captureKey("execute", plan, alpha, beta);
+  std::lock_guard<std::mutex> lock(captureLog.mutex);
+  captureLog.count[key]++;
+}
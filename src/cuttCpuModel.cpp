@@ -0,0 +1,327 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+#include "cuttGpuModel.h"  // computePos, computePos0, countCacheLines
+#include "cuttCpuModel.h"
+
+static HostModelProp detectHostModelProp() {
+  HostModelProp prop;
+  prop.lineBytes = 64;
+  prop.pageBytes = 4096;
+  prop.l1Bytes = 32*1024;
+  prop.l2Bytes = 1024*1024;
+  prop.tlbEntries = 64;
+  prop.prefetchStreams = 16;
+  prop.coreGBs = 10.0;
+  prop.tlbMissNs = 10.0;
+  prop.leafNs = 2.0;
+  prop.itemNs = 10.0;
+#if defined(__unix__) || defined(__APPLE__)
+  long val;
+  if ((val = sysconf(_SC_PAGESIZE)) > 0) prop.pageBytes = (int)val;
+#ifdef _SC_LEVEL1_DCACHE_LINESIZE
+  if ((val = sysconf(_SC_LEVEL1_DCACHE_LINESIZE)) > 0) prop.lineBytes = (int)val;
+  if ((val = sysconf(_SC_LEVEL1_DCACHE_SIZE)) > 0) prop.l1Bytes = val;
+  if ((val = sysconf(_SC_LEVEL2_CACHE_SIZE)) > 0) prop.l2Bytes = val;
+#endif
+#endif
+  int numCore = std::max(1, (int)std::thread::hardware_concurrency());
+  prop.memGBs = prop.coreGBs*std::max(1, numCore/2);
+  const char* env = std::getenv("CUTT_HOST_GBS");
+  if (env != NULL && std::atof(env) > 0.0) prop.memGBs = std::atof(env);
+  return prop;
+}
+
+const HostModelProp& hostModelProp() {
+  static const HostModelProp prop = detectHostModelProp();
+  return prop;
+}
+
+//
+// Number of pages spanned by rows rows stride elements apart
+//
+static double pagesRows(const int rows, const int stride, const size_t sizeofType, const HostModelProp& prop) {
+  double rowBytes = (double)stride*sizeofType;
+  if (rowBytes >= prop.pageBytes) return rows;
+  return std::floor(rows*rowBytes/prop.pageBytes) + 1.0;
+}
+
+//
+// Positions of Mbar samples: first, last, and two in between
+//
+static void mbarSamples(const cuttHostPlan_t& plan, std::vector<int>& baseIn, std::vector<int>& baseOut) {
+  int p[4] = {0, plan.volMbar/3, (2*plan.volMbar)/3, plan.volMbar - 1};
+  for (int i=0;i < 4;i++) {
+    if (i > 0 && p[i] == p[i - 1]) continue;
+    int posIn;
+    int posOut;
+    computePos(p[i], p[i], plan.mbar.data(), (int)plan.mbar.size(), &posIn, &posOut);
+    baseIn.push_back(posIn);
+    baseOut.push_back(posOut);
+  }
+}
+
+//
+// Cache lines per element of one side, seg[] are the positions of the n elements of a block in
+// increasing order. Lines that are only partially used by the block count only for the part used
+// if fraction reuse (0...1) of them is still in cache when the neighbouring block uses the rest
+//
+static double linesPerElem(const std::vector<int>& pos, const std::vector<int>& base, const int cacheWidth,
+  const double reuse) {
+
+  int n = (int)pos.size();
+  std::vector<int> seg(n);
+  double lines = 0.0;
+  for (int j=0;j < (int)base.size();j++) {
+    for (int i=0;i < n;i++) seg[i] = (base[j] + pos[i])/cacheWidth;
+    int cl_full;
+    int cl_part;
+    countCacheLines(seg.data(), n, cacheWidth, cl_full, cl_part);
+    double usedPart = (double)(n - cl_full*cacheWidth)/cacheWidth;
+    lines += cl_full + usedPart + (1.0 - reuse)*(cl_part - usedPart);
+  }
+  return lines/(base.size()*(double)n);
+}
+
+//
+// Distinct cache lines and pages per element of one side, pos[] are the positions of the elements
+//
+static void distinctPerElem(std::vector<size_t>& pos, const size_t sizeofType, const HostModelProp& prop,
+  double& lines, double& pages) {
+
+  for (int i=0;i < (int)pos.size();i++) pos[i] = pos[i]*sizeofType/prop.lineBytes;
+  std::sort(pos.begin(), pos.end());
+  size_t numLine = std::unique(pos.begin(), pos.end()) - pos.begin();
+  pos.resize(numLine);
+  const size_t linesPerPage = std::max(1, prop.pageBytes/prop.lineBytes);
+  for (int i=0;i < (int)numLine;i++) pos[i] /= linesPerPage;
+  size_t numPage = std::unique(pos.begin(), pos.end()) - pos.begin();
+  lines += (double)numLine;
+  pages += (double)numPage;
+}
+
+//
+// Blocks that are small compared to L1 are counted over a window of consecutive blocks in the
+// order of execution. Each side of the window fills L1, so that both stay in L2. Lines of a block
+// are completed by its neighbours in the innermost Mbar loops if these are contiguous on that side,
+// so that the loop order decides the traffic
+//
+static void countWindow(const cuttHostPlan_t& plan, const HostModelProp& prop, HostPlanCounters& counters) {
+
+  const HostLoopNest& nest = plan.nest;
+  const int numTileMm = (plan.volMm - 1)/nest.tileMm + 1;
+  const int numTileMk = (plan.volMk - 1)/nest.tileMk + 1;
+  const int numTile = numTileMm*numTileMk;
+  const long long numItem = plan.numItem();
+  const size_t itemBytes = (size_t)nest.tileMm*nest.tileMk*plan.sizeofType;
+  const int numWindow = (int)std::max(1LL, std::min(numItem, (long long)(prop.l1Bytes/itemBytes)));
+
+  double linesIn = 0.0;
+  double linesOut = 0.0;
+  double pagesIn = 0.0;
+  double pagesOut = 0.0;
+  double numElem = 0.0;
+  long long start[3] = {0, numItem/3, (2*numItem)/3};
+  for (int j=0;j < 3;j++) {
+    if (j > 0 && start[j] == start[j - 1]) continue;
+    std::vector<size_t> posIn;
+    std::vector<size_t> posOut;
+    for (long long item=start[j];item < std::min(numItem, start[j] + numWindow);item++) {
+      int p = (int)(item/numTile);
+      int tile = (int)(item - (long long)p*numTile);
+      int baseIn;
+      int baseOut;
+      computePos(p, p, plan.mbar.data(), (int)plan.mbar.size(), &baseIn, &baseOut);
+      int a0 = (tile % numTileMm)*nest.tileMm;
+      int a1 = std::min(plan.volMm, a0 + nest.tileMm);
+      int b0 = (tile/numTileMm)*nest.tileMk;
+      int b1 = std::min(plan.volMk, b0 + nest.tileMk);
+      for (int b=b0;b < b1;b++) {
+        for (int a=a0;a < a1;a++) {
+          posIn.push_back((size_t)baseIn + a + (size_t)b*plan.strideMkIn);
+          posOut.push_back((size_t)baseOut + (size_t)a*plan.strideMmOut + b);
+        }
+      }
+    }
+    numElem += (double)posIn.size();
+    distinctPerElem(posIn, plan.sizeofType, prop, linesIn, pagesIn);
+    distinctPerElem(posOut, plan.sizeofType, prop, linesOut, pagesOut);
+  }
+
+  counters.linesIn = linesIn/numElem;
+  counters.linesOut = linesOut/numElem;
+  counters.tlbIn = pagesIn/numElem;
+  counters.tlbOut = pagesOut/numElem;
+  // The prefetcher follows sides that use a few lines of each page
+  counters.prefetchIn = (linesIn >= 2.0*pagesIn);
+  counters.prefetchOut = (linesOut >= 2.0*pagesOut);
+}
+
+void countHostPlan(const cuttHostPlan_t& plan, const HostModelProp& prop, HostPlanCounters& counters) {
+
+  const int cacheWidth = std::max(1, prop.lineBytes/(int)plan.sizeofType);
+  const HostLoopNest& nest = plan.nest;
+
+  std::vector<int> baseIn;
+  std::vector<int> baseOut;
+  mbarSamples(plan, baseIn, baseOut);
+
+  // Blocks that take at most an eighth of L1 on both sides
+  const bool smallItems = (16*(size_t)nest.tileMm*nest.tileMk*plan.sizeofType <= prop.l1Bytes);
+
+  if (nest.method == HostCopy) {
+    // Runs of tileMm elements. The neighbouring run continues the lines if the innermost Mbar
+    // loop is contiguous on that side
+    int n = nest.tileMm;
+    std::vector<int> pos(n);
+    for (int i=0;i < n;i++) pos[i] = i;
+    bool nextIn = (plan.mbar.size() == 0 || plan.mbar[0].ct_in == plan.volMm || n < plan.volMm);
+    bool nextOut = (plan.mbar.size() == 0 || plan.mbar[0].ct_out == plan.volMm || n < plan.volMm);
+    counters.linesIn = linesPerElem(pos, baseIn, cacheWidth, nextIn ? 1.0 : 0.0);
+    counters.linesOut = linesPerElem(pos, baseOut, cacheWidth, nextOut ? 1.0 : 0.0);
+    counters.tlbIn = (double)plan.sizeofType/prop.pageBytes;
+    counters.tlbOut = counters.tlbIn;
+    counters.prefetchIn = ((int)(n*plan.sizeofType) >= 2*prop.lineBytes);
+    counters.prefetchOut = counters.prefetchIn;
+    counters.leafs = 0.0;
+    counters.items = 1.0/n;
+    if (smallItems) countWindow(plan, prop, counters);
+    return;
+  }
+
+  const int leafMm = nest.leafMm;
+  const int leafMk = nest.leafMk;
+  const int n = leafMm*leafMk;
+
+  // Positions in a leaf, input-contiguous and output-contiguous order
+  std::vector<int> posIn(n);
+  std::vector<int> posOut(n);
+  std::vector<int> posTmp(n);
+  TensorConvInOut conv[2];
+  conv[0].c_in = conv[0].c_out = 1;
+  conv[0].d_in = conv[0].d_out = leafMm;
+  conv[0].ct_in = 1;
+  conv[0].ct_out = plan.strideMmOut;
+  conv[1].c_in = conv[1].c_out = leafMm;
+  conv[1].d_in = conv[1].d_out = leafMk;
+  conv[1].ct_in = plan.strideMkIn;
+  conv[1].ct_out = 1;
+  computePos0(n, conv, 2, posIn.data(), posTmp.data());
+  std::swap(conv[0], conv[1]);
+  conv[0].c_in = conv[0].c_out = 1;
+  conv[1].c_in = conv[1].c_out = leafMk;
+  computePos0(n, conv, 2, posTmp.data(), posOut.data());
+
+  // Leaf blocks at a few origins in the tile
+  std::vector<int> leafIn;
+  std::vector<int> leafOut;
+  for (int j=0;j < (int)baseIn.size();j++) {
+    for (int k=0;k < 4;k++) {
+      int a0 = (k & 1) ? leafMm : 0;
+      int b0 = (k & 2) ? leafMk : 0;
+      if (a0 + leafMm > plan.volMm || b0 + leafMk > plan.volMk) continue;
+      leafIn.push_back(baseIn[j] + a0 + b0*plan.strideMkIn);
+      leafOut.push_back(baseOut[j] + a0*plan.strideMmOut + b0);
+    }
+  }
+
+  // Partial lines are completed by the next leaf. Recursion visits it right away, as do loops on
+  // the output side. On the input side loops return to it after a sweep over the tile
+  double reuseIn = 1.0;
+  if (nest.method == HostBlocked) {
+    double sweepBytes = 2.0*nest.tileMk*prop.lineBytes;
+    reuseIn = (sweepBytes <= prop.l1Bytes) ? 1.0 : ((sweepBytes <= prop.l2Bytes) ? 0.5 : 0.0);
+  }
+  counters.linesIn = linesPerElem(posIn, leafIn, cacheWidth, reuseIn);
+  counters.linesOut = linesPerElem(posOut, leafOut, cacheWidth, 1.0);
+
+  if (nest.method == HostRecursive) {
+    // Recursion reaches blocks whose pages fit in the TLB
+    int s = std::max(leafMm, leafMk);
+    while (2*s <= std::max(nest.tileMm, nest.tileMk) &&
+      pagesRows(2*s, plan.strideMkIn, plan.sizeofType, prop) +
+      pagesRows(2*s, plan.strideMmOut, plan.sizeofType, prop) <= prop.tlbEntries) s *= 2;
+    int sm = std::min(s, nest.tileMm);
+    int sk = std::min(s, nest.tileMk);
+    counters.tlbIn = pagesRows(sk, plan.strideMkIn, plan.sizeofType, prop)/((double)sm*sk);
+    counters.tlbOut = pagesRows(sm, plan.strideMmOut, plan.sizeofType, prop)/((double)sm*sk);
+  } else {
+    // Output rows of a leaf stay in the TLB for the sweep over Mk, input rows only if
+    // all of the tile fit
+    double pagesOut = pagesRows(leafMm, plan.strideMmOut, plan.sizeofType, prop);
+    double pagesIn = pagesRows(nest.tileMk, plan.strideMkIn, plan.sizeofType, prop);
+    counters.tlbOut = pagesOut/((double)leafMm*nest.tileMk);
+    if (pagesIn + pagesOut <= prop.tlbEntries) {
+      counters.tlbIn = pagesIn/((double)nest.tileMm*nest.tileMk);
+    } else {
+      counters.tlbIn = pagesRows(leafMk, plan.strideMkIn, plan.sizeofType, prop)/n;
+    }
+  }
+
+  // Each row of the leaf is a stream
+  counters.prefetchIn = ((int)(leafMm*plan.sizeofType) >= 2*prop.lineBytes && leafMk <= prop.prefetchStreams);
+  counters.prefetchOut = ((int)(leafMk*plan.sizeofType) >= 2*prop.lineBytes && leafMm <= prop.prefetchStreams);
+
+  // Recursion makes about one extra call per leaf
+  counters.leafs = ((nest.method == HostRecursive) ? 2.0 : 1.0)/n;
+  counters.items = 1.0/((double)nest.tileMm*nest.tileMk);
+  if (smallItems) countWindow(plan, prop, counters);
+}
+
+double secondsHostPlan(const cuttHostPlan_t& plan, const HostModelProp& prop, const HostPlanCounters& counters) {
+  // Lines the prefetcher does not follow wait for memory latency, written lines are also read
+  double pfIn = counters.prefetchIn ? 1.0 : 1.5;
+  double pfOut = counters.prefetchOut ? 1.0 : 1.5;
+  double lineSeconds = prop.lineBytes/(prop.coreGBs*1.0e9);
+  // Starting a block costs itemNs plus about a nanosecond per Mbar rank
+  double perElem = (counters.linesIn*pfIn + 2.0*counters.linesOut*pfOut)*lineSeconds +
+    (counters.tlbIn + counters.tlbOut)*prop.tlbMissNs*1.0e-9 + counters.leafs*prop.leafNs*1.0e-9 +
+    counters.items*(prop.itemNs + plan.mbar.size())*1.0e-9;
+
+  double vol = (double)plan.volMm*plan.volMk*plan.volMbar;
+  long long numItem = plan.numItem();
+  int numWorker = (int)std::min((long long)plan.numThread, numItem);
+  // Threads that get one block less are idle at the end
+  double numRound = std::ceil((double)numItem/numWorker);
+  double parallel = numItem/numRound;
+
+  double computeSeconds = vol*perElem/parallel;
+  double memorySeconds = vol*(counters.linesIn + 2.0*counters.linesOut)*prop.lineBytes/(prop.memGBs*1.0e9);
+  // Computation and memory traffic overlap, but not perfectly
+  return std::max(computeSeconds, memorySeconds) + 0.25*std::min(computeSeconds, memorySeconds);
+}
+
+double secondsHostPlan(const cuttHostPlan_t& plan, const HostModelProp& prop) {
+  HostPlanCounters counters;
+  countHostPlan(plan, prop, counters);
+  return secondsHostPlan(plan, prop, counters);
+}
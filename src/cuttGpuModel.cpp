@@ -25,13 +25,15 @@ SOFTWARE.
 
 #include <algorithm>
 #include <random>
+#include <cmath>
 #include <cuda_runtime.h>
 #include <cstring>               // memcpy
+#include <cstdlib>
+#include <atomic>
 #include "cuttGpuModel.h"
 #include "cuttGpuModelKernel.h"
-#ifdef ENABLE_NVTOOLS
-#include "CudaUtils.h"
-#endif
+#include "cuttArena.h"
+#include "cuttTrace.h"
 
 // #define CALC_L1_CACHELINES
 
@@ -114,39 +116,6 @@ void countCacheLines(const int* seg, const int n, const int cacheWidth, int& cl_
   }
 }
 
-void countCacheLines0(int_vector* segbuf, const int n, const int cacheWidth, int_vector& cl_full, int_vector& cl_part) {
-  int_vector topbit(1 << 31);
-  int_vector lowbits( ~(1 << 31) );
-
-  cl_full = int_vector(0);
-  cl_part = int_vector(0);
-
-  for (int i=0;i < n;i++) {
-    // seg[i] is at the beginning of a full cache line, if seg[i] matches seg[i + cacheWidth - 1]
-    int i1 = i + (cacheWidth - 1);
-    int_vector val(0);
-    if (i1 < n) val = ((segbuf[i] & lowbits) == (segbuf[i1] & lowbits));
-    cl_full += val;
-    // Mark full cache lines with top bit set to 1
-    if (val) {
-      int_vector topbit_mask = bool_to_mask(val) & topbit;
-      int m = std::min(i + cacheWidth, n);
-      for (int j=i;j < m;j++) {
-        segbuf[j] |= topbit_mask;
-      }
-    }
-  }
-
-  for (int i=0;i < n;i++) {
-    int_vector seg = segbuf[i];
-    int_vector segP1 = (i + 1 < n) ? segbuf[i + 1] : int_vector(-1);
-    int_vector part = ((seg & topbit) == int_vector(0));
-    int_vector val2 = (part & (seg != segP1));
-    cl_part += val2;
-  }
-
-}
-
 //
 // Slower reference version of countCacheLines
 //
@@ -235,8 +204,8 @@ void computePos0(const int vol,
   int* __restrict__ posIn, int* __restrict__ posOut) {
 
   // Element position vector
-  std::vector<int> pIn(32, 0);
-  std::vector<int> pOut(32, 0);
+  int pIn[32] = {0};
+  int pOut[32] = {0};
   // Scalar element position
   int posInVal = 0;
   int posOutVal = 0;
@@ -294,6 +263,112 @@ void computePos0(const int vol,
   computePos0(vol, dIn, cIn, dOut, cOut, posIn, posOut);
 }
 
+//
+// Returns position table for one side (input or output)
+//
+const int* PosTableCache::getSide(const int vol, const int numConv, const int* d, const int* ct) {
+
+  // Find the cached table that shares the most leading ranks
+  int kBest = 0;
+  const Entry* best = NULL;
+  for (int i=0;i < (int)entries.size();i++) {
+    const Entry& e = entries[i];
+    int k = 0;
+    while (k < numConv && k < e.numConv && e.d[k] == d[k] && e.ct[k] == ct[k]) k++;
+    if (k == numConv && e.numConv == numConv && e.vol == vol) {
+      numHit++;
+      return e.pos;
+    }
+    if (k > kBest) {
+      kBest = k;
+      best = &e;
+    }
+  }
+
+  Entry e;
+  e.vol = vol;
+  e.numConv = numConv;
+  int* dCopy = arena.alloc<int>(numConv);
+  int* ctCopy = arena.alloc<int>(numConv);
+  std::copy(d, d + numConv, dCopy);
+  std::copy(ct, ct + numConv, ctCopy);
+  e.d = dCopy;
+  e.ct = ctCopy;
+  int* pos = arena.alloc<int>(vol);
+  e.pos = pos;
+
+  // Volume of the shared leading ranks
+  int volPrefix = 1;
+  for (int i=0;i < kBest;i++) volPrefix *= d[i];
+
+  if (best != NULL && volPrefix > 1 && volPrefix <= best->vol) {
+    numPrefix++;
+    // pos[j] = prefix[j % volPrefix] + (position of the remaining ranks)
+    const int* prefix = best->pos;
+    int p[32] = {0};
+    int offset = 0;
+    for (int j0=0;j0 < vol;j0+=volPrefix) {
+      int n = std::min(volPrefix, vol - j0);
+      for (int j1=0;j1 < n;j1++) {
+        pos[j0 + j1] = prefix[j1] + offset;
+      }
+      // Advance the remaining ranks
+      for (int i=kBest;i < numConv;i++) {
+        offset += ct[i];
+        if (++p[i] < d[i]) break;
+        offset -= d[i]*ct[i];
+        p[i] = 0;
+      }
+    }
+  } else {
+    numMiss++;
+    int p[32] = {0};
+    int offset = 0;
+    for (int j=0;j < vol;j++) {
+      pos[j] = offset;
+      for (int i=0;i < numConv;i++) {
+        offset += ct[i];
+        if (++p[i] < d[i]) break;
+        offset -= d[i]*ct[i];
+        p[i] = 0;
+      }
+    }
+  }
+
+  entries.push_back(e);
+  return pos;
+}
+
+void PosTableCache::get(const int vol, const TensorConvInOut* conv, const int numConv,
+  const int*& posIn, const int*& posOut) {
+  int dIn[32];
+  int ctIn[32];
+  int dOut[32];
+  int ctOut[32];
+  for (int i=0;i < numConv;i++) {
+    dIn[i]   = conv[i].d_in;
+    ctIn[i]  = conv[i].ct_in;
+    dOut[i]  = conv[i].d_out;
+    ctOut[i] = conv[i].ct_out;
+  }
+  posIn  = getSide(vol, numConv, dIn, ctIn);
+  posOut = getSide(vol, numConv, dOut, ctOut);
+}
+
+void PosTableCache::clear() {
+  entries.clear();
+  arena.reset();
+}
+
+void PosTableCache::trim(const size_t maxBytes) {
+  if (arena.getUsed() > maxBytes) clear();
+}
+
+PosTableCache& posTableCache() {
+  static thread_local PosTableCache cache;
+  return cache;
+}
+
 //
 // Compute memory element positions
 // *** Slow reference version
@@ -319,7 +394,7 @@ void computePosRef(int vol0, int vol1,
 //
 void countPackedGlTransactions(const int warpSize, const int accWidth, const int cacheWidth,
   const int numthread, const int posMbarIn, const int posMbarOut, const int volMmk, 
-  std::vector<int>& posMmkIn, std::vector<int>& posMmkOut,
+  const int* posMmkIn, const int* posMmkOut,
   int& gld_tran, int& gst_tran, int& gld_req, int& gst_req,
   int& cl_full_l2, int& cl_part_l2, int& cl_full_l1, int& cl_part_l1) {
 
@@ -369,75 +444,150 @@ void countPackedGlTransactions(const int warpSize, const int accWidth, const int
 
 }
 
-#ifdef NO_ALIGNED_ALLOC
+
+MbarSampler::MbarSampler(const int vol_in, const int numSampleMin_in,
+  const int numSampleMax_in, const double tol_in) : vol(vol_in), tol(tol_in) {
+  // Positions are drawn in full vectors
+  batchLen = cpuVectorLen();
+  numSampleMin = ((numSampleMin_in - 1)/batchLen + 1)*batchLen;
+  numSampleMax = std::max(numSampleMin, numSampleMax_in);
+  exact = (numSampleMin_in == 0 || vol <= numSampleMin);
+  numDrawn = 0;
+  num = 0;
+  mean = 0.0;
+  m2 = 0.0;
+}
+
+int MbarSampler::next(int pos[CPU_VECTOR_LEN_MAX]) {
+  int numPos;
+  if (exact) {
+    numPos = std::min(batchLen, vol - numDrawn);
+    for (int i=0;i < numPos;i++) pos[i] = numDrawn + i;
+  } else {
+    if (numDrawn >= numSampleMax || (numDrawn >= numSampleMin && converged())) return 0;
+    numPos = batchLen;
+    // Golden ratio sequence
+    const double phi = 0.6180339887498949;
+    for (int i=0;i < numPos;i++) {
+      double x = 0.5 + (double)(numDrawn + i)*phi;
+      x -= floor(x);
+      pos[i] = std::min(vol - 1, (int)(x*(double)vol));
+    }
+  }
+  numDrawn += numPos;
+  return numPos;
+}
+
+void MbarSampler::add(const int val) {
+  num++;
+  double delta = (double)val - mean;
+  mean += delta/(double)num;
+  m2 += delta*((double)val - mean);
+}
+
+double MbarSampler::getVariance() const {
+  if (exact || num < 2) return 0.0;
+  return m2/(double)((num - 1)*num);
+}
+
+bool MbarSampler::converged() const {
+  if (num < 2) return false;
+  double var = getVariance();
+  return (var == 0.0 || sqrt(var) <= tol*fabs(mean));
+}
+
 //
-// From: http://stackoverflow.com/questions/12504776/aligned-malloc-in-c
+// Returns vector kernels for instruction set type, or NULL if the CPU does not support it
 //
-void *aligned_malloc(size_t required_bytes, size_t alignment) {
-    void *p1;
-    void **p2;
-    int offset=alignment-1+sizeof(void*);
-    p1 = malloc(required_bytes + offset);               // the line you are missing
-    p2=(void**)(((size_t)(p1)+offset)&~(alignment-1));  //line 5
-    p2[-1]=p1; //line 6
-    return p2;
+static const CpuVectorKernels* findCpuVectorKernels(const char* type) {
+  const CpuVectorKernels* kernels[] = {
+#ifdef CUTT_INT_VECTOR_DISPATCH
+    &cpuVectorKernelsAVX512, &cpuVectorKernelsAVX2,
+#endif
+    &cpuVectorKernelsNative};
+  for (const CpuVectorKernels* k : kernels) {
+    if (strcmp(type, k->type) != 0) continue;
+#ifdef CUTT_INT_VECTOR_DISPATCH
+    __builtin_cpu_init();
+    if (k == &cpuVectorKernelsAVX512 && !__builtin_cpu_supports("avx512f")) return NULL;
+    if (k == &cpuVectorKernelsAVX2 && !__builtin_cpu_supports("avx2")) return NULL;
+#endif
+    return k;
+  }
+  return NULL;
 }
 
-void aligned_free( void* p ) {
-    void* p1 = ((void**)p)[-1];         // get the pointer to the buffer we allocated
-    free( p1 );
-}
+//
+// Chooses the widest instruction set supported by the CPU. Can be overridden with
+// environment variable CUTT_CPU_VECTOR, e.g. CUTT_CPU_VECTOR=AVX2
+//
+static const CpuVectorKernels* selectCpuVectorKernels() {
+  const char* env = getenv("CUTT_CPU_VECTOR");
+  if (env != NULL) {
+    const CpuVectorKernels* k = findCpuVectorKernels(env);
+    if (k != NULL) return k;
+  }
+#ifdef CUTT_INT_VECTOR_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return &cpuVectorKernelsAVX512;
+  if (__builtin_cpu_supports("avx2")) return &cpuVectorKernelsAVX2;
 #endif
+  return &cpuVectorKernelsNative;
+}
+
+static std::atomic<const CpuVectorKernels*> cpuVectorKernels(NULL);
+
+static const CpuVectorKernels* getCpuVectorKernels() {
+  const CpuVectorKernels* k = cpuVectorKernels.load(std::memory_order_relaxed);
+  if (k == NULL) {
+    // Racing threads select the same kernels
+    k = selectCpuVectorKernels();
+    cpuVectorKernels.store(k, std::memory_order_relaxed);
+  }
+  return k;
+}
+
+const char* cpuVectorType() {
+  return getCpuVectorKernels()->type;
+}
+
+int cpuVectorLen() {
+  return getCpuVectorKernels()->len;
+}
+
+bool setCpuVectorType(const char* type) {
+  const CpuVectorKernels* k = findCpuVectorKernels(type);
+  if (k == NULL) return false;
+  cpuVectorKernels.store(k, std::memory_order_relaxed);
+  return true;
+}
 
 //
 // Count number of global memory transactions for Packed -method
+// If tranPos != NULL, returns the number of transactions (gld_tran + gst_tran + cl_part_l2) for each
+// position in tranPos[0...numPos-1]
 //
 void countPackedGlTransactions0(const int warpSize, const int accWidth, const int cacheWidth,
   const int numthread, 
-  const int numPos, const int posMbarIn[INT_VECTOR_LEN], const int posMbarOut[INT_VECTOR_LEN],
+  const int numPos, const int posMbarIn[CPU_VECTOR_LEN_MAX], const int posMbarOut[CPU_VECTOR_LEN_MAX],
   const int volMmk,  const int* __restrict__ posMmkIn, const int* __restrict__ posMmkOut,
   int& gld_tran, int& gst_tran, int& gld_req, int& gst_req,
-  int& cl_full_l2, int& cl_part_l2, int& cl_full_l1, int& cl_part_l1) {
-
-#ifdef NO_ALIGNED_ALLOC
-  int_vector* writeSegVolMmk = (int_vector *)aligned_malloc(volMmk*sizeof(int_vector), sizeof(int_vector));
-#else
-  int_vector* writeSegVolMmk = (int_vector *)aligned_alloc(sizeof(int_vector), volMmk*sizeof(int_vector));
-#endif
-
-  const int accWidthShift = ilog2(accWidth);
-  const int cacheWidthShift = ilog2(cacheWidth);
+  int& cl_full_l2, int& cl_part_l2, int& cl_full_l1, int& cl_part_l1,
+  int* tranPos) {
 
-  int_vector posMbarInVec(posMbarIn);
-  int_vector posMbarOutVec(posMbarOut);
-  int_vector readSeg_prev(-1);
-  int_vector writeSeg_prev(-1);
-  int_vector gld_tran_tmp(0);
-  int_vector gst_tran_tmp(0);
-  for (int j=0;j < volMmk;) {
-    int_vector posMmkInVec(posMmkIn[j]);
-    int_vector posMmkOutVec(posMmkOut[j]);
-
-    int_vector posIn  = posMbarInVec + posMmkInVec;
-    int_vector posOut = posMbarOutVec + posMmkOutVec;
-    int_vector readSeg = posIn >> accWidthShift;
-    int_vector writeSeg = posOut >> accWidthShift;
-
-    gld_tran_tmp += (readSeg != readSeg_prev);
-    gst_tran_tmp += (writeSeg != writeSeg_prev);
-
-    writeSegVolMmk[j] = (posOut >> cacheWidthShift);
-
-    j++;
-    readSeg_prev  = (j & 31) ? readSeg : int_vector(-1);
-    writeSeg_prev = (j & 31) ? writeSeg : int_vector(-1);
+  int gld_tran_array[CPU_VECTOR_LEN_MAX];
+  int gst_tran_array[CPU_VECTOR_LEN_MAX];
+  int cl_full_array[CPU_VECTOR_LEN_MAX];
+  int cl_part_array[CPU_VECTOR_LEN_MAX];
+  {
+    const CpuVectorKernels* kernels = getCpuVectorKernels();
+    PlanArenaScope arenaScope;
+    int* work = planArena().alloc<int>(volMmk*kernels->len);
+    kernels->countPackedGlTransactions(accWidth, cacheWidth, numPos, posMbarIn, posMbarOut,
+      volMmk, posMmkIn, posMmkOut, gld_tran_array, gst_tran_array, cl_full_array, cl_part_array, work);
   }
 
   // Global memory transactions
-  int gld_tran_array[INT_VECTOR_LEN];
-  int gst_tran_array[INT_VECTOR_LEN];
-  gld_tran_tmp.copy(gld_tran_array);
-  gst_tran_tmp.copy(gst_tran_array);
   for (int i=0;i < numPos;i++) {
     gld_tran += gld_tran_array[i];
     gst_tran += gst_tran_array[i];
@@ -446,16 +596,15 @@ void countPackedGlTransactions0(const int warpSize, const int accWidth, const in
   gst_req += ((volMmk + warpSize - 1)/warpSize)*numPos;
 
   // Global write non-full cache-lines
-  int_vector cl_full_tmp, cl_part_tmp;
-  countCacheLines0(writeSegVolMmk, volMmk, cacheWidth, cl_full_tmp, cl_part_tmp);
-  int cl_full_array[INT_VECTOR_LEN];
-  int cl_part_array[INT_VECTOR_LEN];
-  cl_full_tmp.copy(cl_full_array);
-  cl_part_tmp.copy(cl_part_array);
   for (int i=0;i < numPos;i++) {
     cl_full_l2 += cl_full_array[i];
     cl_part_l2 += cl_part_array[i];
   }
+  if (tranPos != NULL) {
+    for (int i=0;i < numPos;i++) {
+      tranPos[i] = gld_tran_array[i] + gst_tran_array[i] + cl_part_array[i];
+    }
+  }
 
 #ifdef CALC_L1_CACHELINES
 #error "CALC_L1_CACHELINES currently not functional"
@@ -463,21 +612,22 @@ void countPackedGlTransactions0(const int warpSize, const int accWidth, const in
   cl_full_l1 += cl_full_tmp;
   cl_part_l1 += cl_part_tmp;
 #endif
-
-#ifdef NO_ALIGNED_ALLOC
-  aligned_free(writeSegVolMmk);
-#else
-  free(writeSegVolMmk);
-#endif
 }
 
 //
 // Count numnber of shared memory transactions for Packed -method
+// Bank conflicts are counted for cpuVectorLen() warps at a time
 //
 void countPackedShTransactions0(const int warpSize, const int bankWidth, const int numthread,
   const int volMmk, const TensorConv* msh, const int numMsh,
   int& sld_tran, int& sst_tran, int& sld_req, int& sst_req) {
 
+  if (warpSize > 32 || bankWidth > 32 || numthread % warpSize != 0) {
+    countPackedShTransactionsRef(warpSize, bankWidth, numthread, volMmk, msh, numMsh,
+      sld_tran, sst_tran, sld_req, sst_req);
+    return;
+  }
+
   int p[32];
   int d[32];
   int add[32];
@@ -496,32 +646,40 @@ void countPackedShTransactions0(const int warpSize, const int bankWidth, const i
 
   const int bankWidthMask = bankWidth - 1;
 
-  int pos = 0;
+  // Warps tile volMmk since numthread is a multiple of warpSize
+  const int numWarp = (volMmk + warpSize - 1)/warpSize;
+  const CpuVectorKernels* kernels = getCpuVectorKernels();
+  const int vecLen = kernels->len;
 
-  for (int j00=0;j00 < volMmk;j00+=numthread) {
-    int n0 = std::min(volMmk, j00 + numthread);
-    for (int j0=j00;j0 < n0;j0+=warpSize) {
-      // Number of accesses for each bank
-      std::vector<int> numAccess(warpSize, 0);
-      int maxNumAccess = 0;
-      int n = std::min(warpSize, volMmk - j0);
-      for (int j1=0;j1 < n;j1++) {
-        int bank = pos & bankWidthMask;
-        maxNumAccess = std::max(maxNumAccess, ++numAccess[bank]);
-        // Advance position
+  // Bank accessed by each thread as a bit, vecLen warps interleaved
+  const int numBit = ((numWarp + vecLen - 1)/vecLen)*vecLen*warpSize;
+  PlanArenaScope arenaScope;
+  int* bankBit = planArena().alloc<int>(numBit);
+  std::fill(bankBit, bankBit + numBit, 0);
+  int pos = 0;
+  for (int j0=0,w=0;j0 < volMmk;j0+=warpSize,w++) {
+    int* bits = bankBit + (w - w % vecLen)*warpSize + w % vecLen;
+    int n = std::min(warpSize, volMmk - j0);
+    for (int j1=0;j1 < n;j1++) {
+      bits[j1*vecLen] = (int)(1u << (pos & bankWidthMask));
+      // Advance position
+      if (++p[0] < d[0]) {
+        pos += add[0];
+      } else {
         int ii = 0;
-        while (++p[ii] == d[ii]) {
+        do {
           p[ii] = 0;
           ii++;
-        }
+        } while (++p[ii] == d[ii]);
         pos += add[ii];
       }
-      sld_tran += maxNumAccess;
-      sst_tran++;
-      sld_req++;
-      sst_req++;
     }
   }
+
+  sld_tran += kernels->countPackedShTransactions(warpSize, numWarp, bankBit);
+  sst_tran += numWarp;
+  sld_req += numWarp;
+  sst_req += numWarp;
 }
 
 //
@@ -558,11 +716,88 @@ void countPackedShTransactionsRef(const int warpSize, const int bankWidth, const
   }
 }
 
+//
+// Histogram of residues (i*c) % mod for i = 0 ... n-1
+//
+void residueHist(const int n, const int c, const int mod, long long* hist) {
+  std::fill(hist, hist + mod, 0);
+  // Residues repeat with period mod/gcd(c, mod)
+  int period = mod;
+  for (int i=1;i < mod;i++) {
+    if (((long long)i*c) % mod == 0) {
+      period = i;
+      break;
+    }
+  }
+  for (int i=0;i < std::min(n, period);i++) {
+    hist[((long long)i*c) % mod] += (n - i - 1)/period + 1;
+  }
+}
+
+//
+// Cyclic convolution of residue histograms: c[(i + j) % mod] += a[i]*b[j]
+// c can be the same array as a or b
+//
+void residueConv(const int mod, const long long* a, const long long* b, long long* c) {
+  PlanArenaScope arenaScope;
+  long long* tmp = planArena().alloc<long long>(mod);
+  std::fill(tmp, tmp + mod, 0);
+  for (int i=0;i < mod;i++) {
+    if (a[i] == 0) continue;
+    for (int j=0;j < mod;j++) {
+      tmp[(i + j) % mod] += a[i]*b[j];
+    }
+  }
+  std::copy(tmp, tmp + mod, c);
+}
+
+//
+// Histogram of Mbar position residues modulo mod. Mbar position is the sum of independent
+// terms ((posMbar / c) % d)*ct, so its histogram is the convolution of the histograms of the terms
+//
+void mbarResidueHist(const bool isIn, const std::vector<TensorConvInOut>& hostMbar, const int sizeMbar,
+  const int mod, long long* hist) {
+  PlanArenaScope arenaScope;
+  std::fill(hist, hist + mod, 0);
+  hist[0] = 1;
+  long long* histTerm = planArena().alloc<long long>(mod);
+  for (int i=0;i < sizeMbar;i++) {
+    if (isIn) {
+      residueHist(hostMbar[i].d_in, hostMbar[i].ct_in, mod, histTerm);
+    } else {
+      residueHist(hostMbar[i].d_out, hostMbar[i].ct_out, mod, histTerm);
+    }
+    residueConv(mod, hist, histTerm, hist);
+  }
+}
+
+//
+// Adds transactions of contiguous accesses of length n starting at positions with residue histogram hist
+//
+void addResidueTransactions(const long long* hist, const int n, const int accWidth, const int cacheWidth,
+  const bool countCl, long long& tran, long long& cl_full, long long& cl_part) {
+  for (int r=0;r < accWidth;r++) {
+    if (hist[r] == 0) continue;
+    tran += hist[r]*glTransactions(r, n, accWidth);
+    if (countCl) {
+      int cl_full_tmp, cl_part_tmp;
+      countCacheLines(r, n, cacheWidth, cl_full_tmp, cl_part_tmp);
+      cl_full += hist[r]*cl_full_tmp;
+      cl_part += hist[r]*cl_part_tmp;
+    }
+  }
+}
+
 //
 // Count number of global memory transactions for Tiled method
 //
+// Transactions are counted exactly over all Mbar positions and all tiles. Number of transactions
+// of a contiguous access only depends on the start position modulo accWidth, and start positions
+// are sums of independent affine terms (Mbar position, tile offset, row offset). Therefore the
+// residue histogram of start positions is obtained by convolving the residue histograms of the terms.
+//
 void countTiledGlTransactions(const bool isCopy,
-  const int numPosMbarSample, const int volMm, const int volMk, const int volMbar,
+  const int volMm, const int volMk, const int volMbar,
   const int cIn, const int cOut, const int accWidth, const int cacheWidth,
   std::vector<TensorConvInOut>& hostMbar, const int sizeMbar,
   int& num_iter, float& mlp, int& gld_tran, int& gst_tran, int& gld_req, int& gst_req, int& cl_full, int& cl_part) {
@@ -570,17 +805,6 @@ void countTiledGlTransactions(const bool isCopy,
   int ntile = ((volMm - 1)/TILEDIM + 1)*((volMk - 1)/TILEDIM + 1);
   num_iter = volMbar*ntile;
 
-  gld_tran = 0;
-  gst_tran = 0;
-  gld_req = 0;
-  gst_req = 0;
-  cl_full = 0;
-  cl_part = 0;
-
-  // Random number generator
-  std::default_random_engine generator;
-  std::uniform_int_distribution<int> distribution(0, volMbar - 1);
-
   // Number of elements inside the horizontally clipped tiles
   int h = volMm % TILEDIM;
   // Number of elements inside the vertically clipped tiles
@@ -608,156 +832,130 @@ void countTiledGlTransactions(const bool isCopy,
     mlp = (float)mlp_tot/(float)(2*ntile);
   }
 
-  int num_iposMbar = (numPosMbarSample == 0) ? volMbar : numPosMbarSample;
-
-  for (int iposMbar=0;iposMbar < num_iposMbar;iposMbar++) {
-    int posMbar = (numPosMbarSample == 0) ? iposMbar : distribution(generator);
-
-    int posMbarIn;
-    int posMbarOut;
-    computePos(posMbar, posMbar, hostMbar.data(), sizeMbar, &posMbarIn, &posMbarOut);
-    // computePos(posMbar, posMbar, hostMbar.begin(), hostMbar.begin() + sizeMbar, posMbarInV, posMbarOutV);
-
-    // Reads happen at {posMbarIn, posMbarIn + cuDimMk, posMbarIn + 2*cuDimMk, ..., posMbarIn + (TILEDIM - 1)*cuDimMk}
-    // Each tile has same number of transactions
-
-    if (ntile_full > 0) {
-      int gld_tran_tmp = 0;
-      int gst_tran_tmp = 0;
-      int cl_full_tmp = 0;
-      int cl_part_tmp = 0;
-      for (int i=0;i < TILEDIM;i++) {
-        int posIn  = posMbarIn + i*cIn;
-        int posOut = posMbarOut + i*cOut;
-        gld_tran_tmp += glTransactions(posIn, TILEDIM, accWidth);
-        gst_tran_tmp += glTransactions(posOut, TILEDIM, accWidth);
-        int cl_full_tmp2, cl_part_tmp2;
-        countCacheLines(posOut, TILEDIM, cacheWidth, cl_full_tmp2, cl_part_tmp2);
-        cl_full_tmp += cl_full_tmp2;
-        cl_part_tmp += cl_part_tmp2;
-      }
-      gld_tran += gld_tran_tmp*ntile_full;
-      gst_tran += gst_tran_tmp*ntile_full;
-      cl_full += cl_full_tmp*ntile_full;
-      cl_part += cl_part_tmp*ntile_full;
-    }
+  long long gld_tran_tot = 0;
+  long long gst_tran_tot = 0;
+  long long cl_full_tot = 0;
+  long long cl_part_tot = 0;
+  long long cl_dummy = 0;
+
+  // Residue histograms of length accWidth
+  PlanArenaScope arenaScope;
+  PlanArena& arena = planArena();
+  long long* histMbarIn  = arena.alloc<long long>(accWidth);
+  long long* histMbarOut = arena.alloc<long long>(accWidth);
+  mbarResidueHist(true, hostMbar, sizeMbar, accWidth, histMbarIn);
+  mbarResidueHist(false, hostMbar, sizeMbar, accWidth, histMbarOut);
+
+  // Tile offsets in x (Mm) direction: full tiles and the horizontally clipped tile
+  long long* histTileX[2] = {arena.alloc<long long>(accWidth), arena.alloc<long long>(accWidth)};
+  residueHist(volMm/TILEDIM, TILEDIM, accWidth, histTileX[0]);
+  std::fill(histTileX[1], histTileX[1] + accWidth, 0);
+  histTileX[1][((volMm/TILEDIM)*TILEDIM) % accWidth] = (h > 0);
+  const int tileWidth[2] = {TILEDIM, h};
+
+  // Reads happen along x at rows y = 0 ... volMk - 1: posMbarIn + x + y*cIn
+  long long* histRow = arena.alloc<long long>(accWidth);
+  long long* hist    = arena.alloc<long long>(accWidth);
+  residueHist(volMk, cIn, accWidth, histRow);
+  residueConv(accWidth, histMbarIn, histRow, histRow);
+  for (int i=0;i < 2;i++) {
+    if (tileWidth[i] == 0) continue;
+    residueConv(accWidth, histRow, histTileX[i], hist);
+    addResidueTransactions(hist, tileWidth[i], accWidth, cacheWidth, false, gld_tran_tot, cl_dummy, cl_dummy);
+  }
 
-    if (ntile_horz > 0) {
-      int gld_tran_tmp = 0;
-      int gst_tran_tmp = 0;
-      int cl_full_tmp = 0;
-      int cl_part_tmp = 0;
-      if (isCopy) {
-        for (int i=0;i < TILEDIM;i++) {
-          int posIn  = posMbarIn + i*cIn;
-          int posOut = posMbarOut + i*cOut;
-          gld_tran_tmp += glTransactions(posIn, h, accWidth);
-          gst_tran_tmp += glTransactions(posOut, h, accWidth);
-          int cl_full_tmp2, cl_part_tmp2;
-          countCacheLines(posOut, h, cacheWidth, cl_full_tmp2, cl_part_tmp2);
-          cl_full_tmp += cl_full_tmp2;
-          cl_part_tmp += cl_part_tmp2;
-        }
-      } else {
-        for (int i=0;i < TILEDIM;i++) {
-          int posIn  = posMbarIn + i*cIn;
-          gld_tran_tmp += glTransactions(posIn, h, accWidth);
-        }
-        for (int i=0;i < h;i++) {
-          int posOut = posMbarOut + i*cOut;
-          gst_tran_tmp += glTransactions(posOut, TILEDIM, accWidth);
-          int cl_full_tmp2, cl_part_tmp2;
-          countCacheLines(posOut, TILEDIM, cacheWidth, cl_full_tmp2, cl_part_tmp2);
-          cl_full_tmp += cl_full_tmp2;
-          cl_part_tmp += cl_part_tmp2;
-        }
-      }
-      gld_tran += gld_tran_tmp*ntile_horz;
-      gst_tran += gst_tran_tmp*ntile_horz;
-      cl_full += cl_full_tmp*ntile_horz;
-      cl_part += cl_part_tmp*ntile_horz;
+  if (isCopy) {
+    // Writes happen along x at rows y = 0 ... volMk - 1: posMbarOut + x + y*cOut
+    residueHist(volMk, cOut, accWidth, histRow);
+    residueConv(accWidth, histMbarOut, histRow, histRow);
+    for (int i=0;i < 2;i++) {
+      if (tileWidth[i] == 0) continue;
+      residueConv(accWidth, histRow, histTileX[i], hist);
+      addResidueTransactions(hist, tileWidth[i], accWidth, cacheWidth, true, gst_tran_tot, cl_full_tot, cl_part_tot);
     }
-
-    if (ntile_vert > 0) {
-      int gld_tran_tmp = 0;
-      int gst_tran_tmp = 0;
-      int cl_full_tmp = 0;
-      int cl_part_tmp = 0;
-      if (isCopy) {
-        for (int i=0;i < v;i++) {
-          int posIn  = posMbarIn + i*cIn;
-          int posOut = posMbarOut + i*cOut;
-          gld_tran_tmp += glTransactions(posIn, TILEDIM, accWidth);
-          gst_tran_tmp += glTransactions(posOut, TILEDIM, accWidth);
-          int cl_full_tmp2, cl_part_tmp2;
-          countCacheLines(posOut, TILEDIM, cacheWidth, cl_full_tmp2, cl_part_tmp2);
-          cl_full_tmp += cl_full_tmp2;
-          cl_part_tmp += cl_part_tmp2;
-        }
-      } else {
-        for (int i=0;i < v;i++) {
-          int posIn  = posMbarIn + i*cIn;
-          gld_tran_tmp += glTransactions(posIn, TILEDIM, accWidth);
-        }
-        for (int i=0;i < TILEDIM;i++) {
-          int posOut = posMbarOut + i*cOut;
-          gst_tran_tmp += glTransactions(posOut, v, accWidth);
-          int cl_full_tmp2, cl_part_tmp2;
-          countCacheLines(posOut, v, cacheWidth, cl_full_tmp2, cl_part_tmp2);
-          cl_full_tmp += cl_full_tmp2;
-          cl_part_tmp += cl_part_tmp2;
-        }
-      }
-      gld_tran += gld_tran_tmp*ntile_vert;
-      gst_tran += gst_tran_tmp*ntile_vert;
-      cl_full += cl_full_tmp*ntile_vert;
-      cl_part += cl_part_tmp*ntile_vert;
+  } else {
+    // Writes happen along y at columns x = 0 ... volMm - 1: posMbarOut + y + x*cOut
+    long long* histTileY[2] = {arena.alloc<long long>(accWidth), arena.alloc<long long>(accWidth)};
+    residueHist(volMk/TILEDIM, TILEDIM, accWidth, histTileY[0]);
+    std::fill(histTileY[1], histTileY[1] + accWidth, 0);
+    histTileY[1][((volMk/TILEDIM)*TILEDIM) % accWidth] = (v > 0);
+    const int tileHeight[2] = {TILEDIM, v};
+    residueHist(volMm, cOut, accWidth, histRow);
+    residueConv(accWidth, histMbarOut, histRow, histRow);
+    for (int i=0;i < 2;i++) {
+      if (tileHeight[i] == 0) continue;
+      residueConv(accWidth, histRow, histTileY[i], hist);
+      addResidueTransactions(hist, tileHeight[i], accWidth, cacheWidth, true, gst_tran_tot, cl_full_tot, cl_part_tot);
     }
+  }
 
-    if (ntile_corn > 0) {
-      int gld_tran_tmp = 0;
-      int gst_tran_tmp = 0;
-      int cl_full_tmp = 0;
-      int cl_part_tmp = 0;
-      if (isCopy) {
-        for (int i=0;i < v;i++) {
-          int posIn  = posMbarIn + i*cIn;
-          int posOut = posMbarOut + i*cOut;
-          gld_tran_tmp += glTransactions(posIn, h, accWidth);
-          gst_tran_tmp += glTransactions(posOut, h, accWidth);
-          int cl_full_tmp2, cl_part_tmp2;
-          countCacheLines(posOut, h, cacheWidth, cl_full_tmp2, cl_part_tmp2);
-          cl_full_tmp += cl_full_tmp2;
-          cl_part_tmp += cl_part_tmp2;
-        }
-      } else {
-        for (int i=0;i < v;i++) {
-          int posIn  = posMbarIn + i*cIn;
-          gld_tran_tmp += glTransactions(posIn, h, accWidth);
-        }
-        for (int i=0;i < h;i++) {
-          int posOut = posMbarOut + i*cOut;
-          gst_tran_tmp += glTransactions(posOut, v, accWidth);
-          int cl_full_tmp2, cl_part_tmp2;
-          countCacheLines(posOut, v, cacheWidth, cl_full_tmp2, cl_part_tmp2);
-          cl_full_tmp += cl_full_tmp2;
-          cl_part_tmp += cl_part_tmp2;
-        }
-      }
-      gld_tran += gld_tran_tmp*ntile_corn;
-      gst_tran += gst_tran_tmp*ntile_corn;
-      cl_full += cl_full_tmp*ntile_corn;
-      cl_part += cl_part_tmp*ntile_corn;
-    }
+  gld_tran = (int)gld_tran_tot;
+  gst_tran = (int)gst_tran_tot;
+  cl_full = (int)cl_full_tot;
+  cl_part = (int)cl_part_tot;
 
-  }
   // Requests
   if (isCopy) {
-    gld_req = num_iposMbar*( TILEDIM*ntile_full + TILEDIM*ntile_horz + v*ntile_vert + v*ntile_corn );
+    gld_req = volMbar*( TILEDIM*ntile_full + TILEDIM*ntile_horz + v*ntile_vert + v*ntile_corn );
     gst_req = gld_req;
   } else {
-    gld_req = num_iposMbar*( TILEDIM*ntile_full + TILEDIM*ntile_horz + v*ntile_vert + v*ntile_corn );
-    gst_req = num_iposMbar*( TILEDIM*ntile_full + TILEDIM*ntile_vert + h*ntile_horz + h*ntile_corn );
+    gld_req = volMbar*( TILEDIM*ntile_full + TILEDIM*ntile_horz + v*ntile_vert + v*ntile_corn );
+    gst_req = volMbar*( TILEDIM*ntile_full + TILEDIM*ntile_vert + h*ntile_horz + h*ntile_corn );
+  }
+}
+
+//
+// Count number of global memory transactions for Tiled method
+// *** Slow reference version that visits every row of every tile at every Mbar position
+//
+void countTiledGlTransactionsRef(const bool isCopy,
+  const int volMm, const int volMk, const int volMbar,
+  const int cIn, const int cOut, const int accWidth, const int cacheWidth,
+  std::vector<TensorConvInOut>& hostMbar, const int sizeMbar,
+  int& gld_tran, int& gst_tran, int& gld_req, int& gst_req, int& cl_full, int& cl_part) {
+
+  gld_tran = 0;
+  gst_tran = 0;
+  gld_req = 0;
+  gst_req = 0;
+  cl_full = 0;
+  cl_part = 0;
+
+  for (int posMbar=0;posMbar < volMbar;posMbar++) {
+    int posMbarIn;
+    int posMbarOut;
+    computePos(posMbar, posMbar, hostMbar.data(), sizeMbar, &posMbarIn, &posMbarOut);
+    for (int bx=0;bx < volMm;bx+=TILEDIM) {
+      int w = std::min(TILEDIM, volMm - bx);
+      for (int by=0;by < volMk;by+=TILEDIM) {
+        int hgt = std::min(TILEDIM, volMk - by);
+        for (int y=by;y < by + hgt;y++) {
+          gld_tran += glTransactions(posMbarIn + bx + y*cIn, w, accWidth);
+          gld_req++;
+        }
+        if (isCopy) {
+          for (int y=by;y < by + hgt;y++) {
+            int posOut = posMbarOut + bx + y*cOut;
+            gst_tran += glTransactions(posOut, w, accWidth);
+            int cl_full_tmp, cl_part_tmp;
+            countCacheLines(posOut, w, cacheWidth, cl_full_tmp, cl_part_tmp);
+            cl_full += cl_full_tmp;
+            cl_part += cl_part_tmp;
+            gst_req++;
+          }
+        } else {
+          for (int x=bx;x < bx + w;x++) {
+            int posOut = posMbarOut + by + x*cOut;
+            gst_tran += glTransactions(posOut, hgt, accWidth);
+            int cl_full_tmp, cl_part_tmp;
+            countCacheLines(posOut, hgt, cacheWidth, cl_full_tmp, cl_part_tmp);
+            cl_full += cl_full_tmp;
+            cl_part += cl_part_tmp;
+            gst_req++;
+          }
+        }
+      }
+    }
   }
 }
 
@@ -1295,19 +1493,13 @@ const int shTestData[138][3] =
         std::vector<int> posOut(vol, -1);
         std::vector<int> posInRef(vol, -2);
         std::vector<int> posOutRef(vol, -2);
-#ifdef ENABLE_NVTOOLS
-        gpuRangeStart("computePos0");
-#endif
+        CUTT_TRACE_BEGIN("computePos0");
         computePos0(vol, conv.data(), subrank, posIn.data(), posOut.data());
         // computePos0(vol, dIn, cIn, dIn, cIn, posIn.data(), posOut.data());
-#ifdef ENABLE_NVTOOLS
-        gpuRangeStop();
-        gpuRangeStart("computePosRef");
-#endif
+        CUTT_TRACE_END();
+        CUTT_TRACE_BEGIN("computePosRef");
         computePosRef(0, vol - 1, conv.begin(), conv.begin() + subrank, posInRef, posOutRef);
-#ifdef ENABLE_NVTOOLS
-        gpuRangeStop();
-#endif
+        CUTT_TRACE_END();
         for (int i=0;i < vol;i++) {
           if (posIn[i] != posInRef[i] || posOut[i] != posOutRef[i]) {
             printf("computePos0 fails rank %d subrank %d\n", rank, subrank);
@@ -1347,6 +1539,148 @@ const int shTestData[138][3] =
 
   }
 
+  //
+  // Test Tiled transaction counter against the reference version
+  //
+  {
+    std::default_random_engine generator;
+    std::uniform_int_distribution<int> voldist(1, 80);
+    std::uniform_int_distribution<int> paddist(0, 9);
+    std::uniform_int_distribution<int> ranksdist(0, 3);
+    std::uniform_int_distribution<int> dimdist(2, 5);
+    std::uniform_int_distribution<int> ctdist(1, 1000);
+    for (int nsample=0;nsample < 200;nsample++) {
+      bool isCopy = (nsample % 2 == 1);
+      int volMm = voldist(generator);
+      int volMk = voldist(generator);
+      int cIn  = volMm + paddist(generator);
+      int cOut = (isCopy ? volMm : volMk) + paddist(generator);
+      // Mbar ranks: input in order, output in reverse order
+      int sizeMbar = ranksdist(generator);
+      std::vector<TensorConvInOut> hostMbar(sizeMbar);
+      int volMbar = 1;
+      for (int i=0;i < sizeMbar;i++) {
+        hostMbar[i].c_in  = volMbar;
+        hostMbar[i].d_in  = dimdist(generator);
+        hostMbar[i].ct_in = ctdist(generator);
+        volMbar *= hostMbar[i].d_in;
+      }
+      for (int i=sizeMbar-1,c=1;i >= 0;i--) {
+        hostMbar[i].c_out  = c;
+        hostMbar[i].d_out  = hostMbar[i].d_in;
+        hostMbar[i].ct_out = ctdist(generator);
+        c *= hostMbar[i].d_out;
+      }
+
+      int num_iter;
+      float mlp;
+      int gld_tran, gst_tran, gld_req, gst_req, cl_full, cl_part;
+      countTiledGlTransactions(isCopy, volMm, volMk, volMbar, cIn, cOut, accWidth, cacheWidth,
+        hostMbar, sizeMbar, num_iter, mlp, gld_tran, gst_tran, gld_req, gst_req, cl_full, cl_part);
+      int gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref, cl_full_ref, cl_part_ref;
+      countTiledGlTransactionsRef(isCopy, volMm, volMk, volMbar, cIn, cOut, accWidth, cacheWidth,
+        hostMbar, sizeMbar, gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref, cl_full_ref, cl_part_ref);
+      if (gld_tran != gld_tran_ref || gst_tran != gst_tran_ref || gld_req != gld_req_ref ||
+        gst_req != gst_req_ref || cl_full != cl_full_ref || cl_part != cl_part_ref) {
+        printf("Error in countTiledGlTransactions. Test %d isCopy %d volMm %d volMk %d cIn %d cOut %d\n",
+          nsample, isCopy, volMm, volMk, cIn, cOut);
+        printf("Ref: %d %d %d %d %d %d\n", gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref, cl_full_ref, cl_part_ref);
+        printf("Res: %d %d %d %d %d %d\n", gld_tran, gst_tran, gld_req, gst_req, cl_full, cl_part);
+        return false;
+      }
+    }
+  }
+
+  //
+  // Test vectorized Packed transaction counters against the reference versions
+  // for every instruction set available on this CPU
+  //
+  {
+    const char* types[] = {
+#ifdef CUTT_INT_VECTOR_DISPATCH
+      cpuVectorKernelsAVX512.type, cpuVectorKernelsAVX2.type,
+#endif
+      cpuVectorKernelsNative.type};
+    const char* typeOrig = cpuVectorType();
+    bool ok = true;
+    for (const char* type : types) {
+      if (!setCpuVectorType(type)) continue;
+      std::default_random_engine generator;
+      std::uniform_int_distribution<int> voldist(1, 200);
+      std::uniform_int_distribution<int> posdist(0, 5000);
+      std::uniform_int_distribution<int> numposdist(1, CPU_VECTOR_LEN_MAX);
+      const int numthread = 4*warpSize;
+      for (int nsample=0;nsample < 100 && ok;nsample++) {
+        int volMmk = voldist(generator);
+        std::vector<int> posMmkIn(volMmk);
+        std::vector<int> posMmkOut(volMmk);
+        // Contiguous or scattered positions
+        for (int j=0;j < volMmk;j++) {
+          posMmkIn[j]  = (j > 0 && (nsample & 1)) ? posMmkIn[j-1] + 1 : posdist(generator);
+          posMmkOut[j] = (j > 0 && (nsample & 2)) ? posMmkOut[j-1] + 1 : posdist(generator);
+        }
+        int numPos = numposdist(generator);
+        int posMbarIn[CPU_VECTOR_LEN_MAX];
+        int posMbarOut[CPU_VECTOR_LEN_MAX];
+        for (int i=0;i < numPos;i++) {
+          posMbarIn[i]  = posdist(generator);
+          posMbarOut[i] = posdist(generator);
+        }
+        int gld_tran = 0, gst_tran = 0, gld_req = 0, gst_req = 0;
+        int cl_full_l2 = 0, cl_part_l2 = 0, cl_full_l1 = 0, cl_part_l1 = 0;
+        countPackedGlTransactions0(warpSize, accWidth, cacheWidth, numthread,
+          numPos, posMbarIn, posMbarOut, volMmk, posMmkIn.data(), posMmkOut.data(),
+          gld_tran, gst_tran, gld_req, gst_req, cl_full_l2, cl_part_l2, cl_full_l1, cl_part_l1);
+        int gld_tran_ref = 0, gst_tran_ref = 0, gld_req_ref = 0, gst_req_ref = 0;
+        int cl_full_l2_ref = 0, cl_part_l2_ref = 0;
+        for (int i=0;i < numPos;i++) {
+          countPackedGlTransactions(warpSize, accWidth, cacheWidth, numthread,
+            posMbarIn[i], posMbarOut[i], volMmk, posMmkIn.data(), posMmkOut.data(),
+            gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref,
+            cl_full_l2_ref, cl_part_l2_ref, cl_full_l1, cl_part_l1);
+        }
+        if (gld_tran != gld_tran_ref || gst_tran != gst_tran_ref || gld_req != gld_req_ref ||
+          gst_req != gst_req_ref || cl_full_l2 != cl_full_l2_ref || cl_part_l2 != cl_part_l2_ref) {
+          printf("Error in countPackedGlTransactions0 (%s). Test %d volMmk %d numPos %d\n",
+            type, nsample, volMmk, numPos);
+          printf("Ref: %d %d %d %d %d %d\n", gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref, cl_full_l2_ref, cl_part_l2_ref);
+          printf("Res: %d %d %d %d %d %d\n", gld_tran, gst_tran, gld_req, gst_req, cl_full_l2, cl_part_l2);
+          ok = false;
+        }
+      }
+      std::uniform_int_distribution<int> rankdist(1, 4);
+      std::uniform_int_distribution<int> dimdist(1, 12);
+      std::uniform_int_distribution<int> ctdist(1, 100);
+      for (int nsample=0;nsample < 100 && ok;nsample++) {
+        int numMsh = rankdist(generator);
+        TensorConv msh[4];
+        int volMmk = 1;
+        for (int i=0;i < numMsh;i++) {
+          msh[i].c  = volMmk;
+          msh[i].d  = dimdist(generator);
+          msh[i].ct = ctdist(generator);
+          volMmk *= msh[i].d;
+        }
+        int sld_tran = 0, sst_tran = 0, sld_req = 0, sst_req = 0;
+        countPackedShTransactions0(warpSize, warpSize, numthread, volMmk, msh, numMsh,
+          sld_tran, sst_tran, sld_req, sst_req);
+        int sld_tran_ref = 0, sst_tran_ref = 0, sld_req_ref = 0, sst_req_ref = 0;
+        countPackedShTransactionsRef(warpSize, warpSize, numthread, volMmk, msh, numMsh,
+          sld_tran_ref, sst_tran_ref, sld_req_ref, sst_req_ref);
+        if (sld_tran != sld_tran_ref || sst_tran != sst_tran_ref ||
+          sld_req != sld_req_ref || sst_req != sst_req_ref) {
+          printf("Error in countPackedShTransactions0 (%s). Test %d volMmk %d numMsh %d\n",
+            type, nsample, volMmk, numMsh);
+          printf("Ref: %d %d %d %d\n", sld_tran_ref, sst_tran_ref, sld_req_ref, sst_req_ref);
+          printf("Res: %d %d %d %d\n", sld_tran, sst_tran, sld_req, sst_req);
+          ok = false;
+        }
+      }
+    }
+    setCpuVectorType(typeOrig);
+    if (!ok) return false;
+  }
+
   //
   // Test GPU version
   //
@@ -0,0 +1,193 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+//
+// Vectorized CPU kernels of the GPU model. This file is compiled once with the default
+// compiler flags and once more for each instruction set in src/isa/, which define
+// CUTT_VECTOR_KERNELS before including this file.
+//
+#include <cstdio>
+#include <algorithm>
+#include "cuttGpuModelVec.h"
+
+#ifndef CUTT_VECTOR_KERNELS
+#define CUTT_VECTOR_KERNELS cpuVectorKernelsNative
+#endif
+
+#define CUTT_VECTOR_CONCAT0(a, b) a ## b
+#define CUTT_VECTOR_CONCAT(a, b) CUTT_VECTOR_CONCAT0(a, b)
+#define INT_VECTOR_NAMESPACE CUTT_VECTOR_CONCAT(CUTT_VECTOR_KERNELS, _ns)
+#include "int_vector.h"
+
+namespace INT_VECTOR_NAMESPACE {
+
+static int ilog2(int a) {
+  int k = 0;
+  while (a >>= 1) k++;
+  return k;
+}
+
+void countCacheLines0(int_vector* segbuf, const int n, const int cacheWidth, int_vector& cl_full, int_vector& cl_part) {
+  int_vector topbit(1 << 31);
+  int_vector lowbits( ~(1 << 31) );
+
+  cl_full = int_vector(0);
+  cl_part = int_vector(0);
+
+  for (int i=0;i < n;i++) {
+    // seg[i] is at the beginning of a full cache line, if seg[i] matches seg[i + cacheWidth - 1]
+    int i1 = i + (cacheWidth - 1);
+    int_vector val(0);
+    if (i1 < n) val = ((segbuf[i] & lowbits) == (segbuf[i1] & lowbits));
+    cl_full += val;
+    // Mark full cache lines with top bit set to 1
+    if (val) {
+      int_vector topbit_mask = bool_to_mask(val) & topbit;
+      int m = std::min(i + cacheWidth, n);
+      for (int j=i;j < m;j++) {
+        segbuf[j] |= topbit_mask;
+      }
+    }
+  }
+
+  for (int i=0;i < n;i++) {
+    int_vector seg = segbuf[i];
+    int_vector segP1 = (i + 1 < n) ? segbuf[i + 1] : int_vector(-1);
+    int_vector part = ((seg & topbit) == int_vector(0));
+    int_vector val2 = (part & (seg != segP1));
+    cl_part += val2;
+  }
+
+}
+
+//
+// Count number of global memory transactions for Packed -method.
+// Mbar positions are processed INT_VECTOR_LEN at a time
+// work = volMmk int_vectors, aligned to sizeof(int_vector)
+//
+void countPackedGlTransactions(const int accWidth, const int cacheWidth,
+  const int numPos, const int* posMbarIn, const int* posMbarOut,
+  const int volMmk, const int* __restrict__ posMmkIn, const int* __restrict__ posMmkOut,
+  int* gld_tran, int* gst_tran, int* cl_full, int* cl_part, void* work) {
+
+  int_vector* writeSegVolMmk = (int_vector *)work;
+
+  const int accWidthShift = ilog2(accWidth);
+  const int cacheWidthShift = ilog2(cacheWidth);
+
+  for (int ipos=0;ipos < numPos;ipos+=INT_VECTOR_LEN) {
+    int n = std::min(numPos - ipos, INT_VECTOR_LEN);
+    // Pad unused vector elements with the last position
+    int posMbarInPad[INT_VECTOR_LEN];
+    int posMbarOutPad[INT_VECTOR_LEN];
+    for (int i=0;i < INT_VECTOR_LEN;i++) {
+      posMbarInPad[i]  = posMbarIn[ipos + std::min(i, n - 1)];
+      posMbarOutPad[i] = posMbarOut[ipos + std::min(i, n - 1)];
+    }
+
+    int_vector posMbarInVec(posMbarInPad);
+    int_vector posMbarOutVec(posMbarOutPad);
+    int_vector readSeg_prev(-1);
+    int_vector writeSeg_prev(-1);
+    int_vector gld_tran_tmp(0);
+    int_vector gst_tran_tmp(0);
+    for (int j=0;j < volMmk;) {
+      int_vector posMmkInVec(posMmkIn[j]);
+      int_vector posMmkOutVec(posMmkOut[j]);
+
+      int_vector posIn  = posMbarInVec + posMmkInVec;
+      int_vector posOut = posMbarOutVec + posMmkOutVec;
+      int_vector readSeg = posIn >> accWidthShift;
+      int_vector writeSeg = posOut >> accWidthShift;
+
+      gld_tran_tmp += (readSeg != readSeg_prev);
+      gst_tran_tmp += (writeSeg != writeSeg_prev);
+
+      writeSegVolMmk[j] = (posOut >> cacheWidthShift);
+
+      j++;
+      readSeg_prev  = (j & 31) ? readSeg : int_vector(-1);
+      writeSeg_prev = (j & 31) ? writeSeg : int_vector(-1);
+    }
+
+    // Global write non-full cache-lines
+    int_vector cl_full_tmp, cl_part_tmp;
+    countCacheLines0(writeSegVolMmk, volMmk, cacheWidth, cl_full_tmp, cl_part_tmp);
+
+    int gld_tran_array[INT_VECTOR_LEN];
+    int gst_tran_array[INT_VECTOR_LEN];
+    int cl_full_array[INT_VECTOR_LEN];
+    int cl_part_array[INT_VECTOR_LEN];
+    gld_tran_tmp.copy(gld_tran_array);
+    gst_tran_tmp.copy(gst_tran_array);
+    cl_full_tmp.copy(cl_full_array);
+    cl_part_tmp.copy(cl_part_array);
+    for (int i=0;i < n;i++) {
+      gld_tran[ipos + i] = gld_tran_array[i];
+      gst_tran[ipos + i] = gst_tran_array[i];
+      cl_full[ipos + i]  = cl_full_array[i];
+      cl_part[ipos + i]  = cl_part_array[i];
+    }
+  }
+}
+
+//
+// Count number of shared memory load transactions for Packed -method, INT_VECTOR_LEN warps at a time.
+// bankBit[(w/INT_VECTOR_LEN)*warpSize*INT_VECTOR_LEN + j1*INT_VECTOR_LEN + (w % INT_VECTOR_LEN)]
+// has the bit of the bank accessed by thread j1 of warp w set.
+// level[t] has the bit of bank b set if bank b is accessed more than t times,
+// and the number of non-empty levels is the number of transactions
+//
+int countPackedShTransactions(const int warpSize, const int numWarp, const int* bankBit) {
+  int_vector numTran(0);
+  for (int w=0;w < numWarp;w+=INT_VECTOR_LEN) {
+    const int* bits = bankBit + w*warpSize;
+    int_vector level[32];
+    int numLevel = 0;
+    for (int j1=0;j1 < warpSize;j1++) {
+      int_vector carry(&bits[j1*INT_VECTOR_LEN]);
+      for (int t=0;t < numLevel;t++) {
+        int_vector prev = level[t];
+        level[t] |= carry;
+        carry = carry & prev;
+      }
+      if (carry) level[numLevel++] = carry;
+    }
+    for (int t=0;t < numLevel;t++) {
+      numTran += (level[t] != int_vector(0));
+    }
+  }
+  int numTranArray[INT_VECTOR_LEN];
+  numTran.copy(numTranArray);
+  int sld_tran = 0;
+  for (int i=0;i < INT_VECTOR_LEN;i++) {
+    sld_tran += numTranArray[i];
+  }
+  return sld_tran;
+}
+
+}
+
+extern const CpuVectorKernels CUTT_VECTOR_KERNELS = {INT_VECTOR_TYPE, INT_VECTOR_LEN,
+  INT_VECTOR_NAMESPACE::countPackedGlTransactions, INT_VECTOR_NAMESPACE::countPackedShTransactions};
@@ -0,0 +1,521 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include "cuttplan.h"      // reduceRanks
+#include "cuttParallel.h"
+#include "cuttTrace.h"
+#include "cuttCpuModel.h"
+#include "cuttNuma.h"
+#include "cuttHost.h"
+
+const char* hostMethodName(const int method) {
+  switch(method) {
+    case HostCopy: return "Copy";
+    case HostRecursive: return "Recursive";
+    case HostBlocked: return "Blocked";
+  }
+  return "Unknown";
+}
+
+static bool sameLoopNest(const HostLoopNest& a, const HostLoopNest& b) {
+  return (a.method == b.method && a.leafMm == b.leafMm && a.leafMk == b.leafMk && a.tileMm == b.tileMm &&
+    a.tileMk == b.tileMk && a.order == b.order);
+}
+
+//
+// Element operations of execute()
+//
+template <typename T> struct HostCopyOp {
+  void operator()(const T& in, T& out) const {out = in;}
+};
+
+template <typename T> struct HostZeroOp {
+  void operator()(const T&, T& out) const {out = (T)0;}
+};
+
+template <typename T> struct HostScaleOp {
+  T alpha;
+  void operator()(const T& in, T& out) const {out = alpha*in;}
+};
+
+template <typename T> struct HostScaleAddOp {
+  T alpha;
+  T beta;
+  void operator()(const T& in, T& out) const {out = alpha*in + beta*out;}
+};
+
+bool cuttHostPlan_t::setup(const int rank_in, const int* dim_in, const int* permutation_in,
+  const size_t sizeofType_in, const int numThread_in, const cuttHostPlacement placement_in,
+  const unsigned long long nodeMask) {
+
+  if (sizeofType_in != 4 && sizeofType_in != 8) return false;
+  sizeofType = sizeofType_in;
+  memset(&stats, 0, sizeof(stats));
+  numThread = (numThread_in > 0) ? numThread_in : cuttNumThreads();
+  if (!setPlacement(placement_in, nodeMask)) return false;
+
+  dim.clear();
+  permutation.clear();
+  reduceRanks(rank_in, dim_in, permutation_in, dim, permutation);
+  rank = (int)dim.size();
+
+  // Input stride of each dimension, and its output stride
+  strideIn.resize(rank);
+  strideOut.resize(rank);
+  int vol = 1;
+  for (int i=0;i < rank;i++) {
+    strideIn[i] = vol;
+    vol *= dim[i];
+  }
+  vol = 1;
+  for (int i=0;i < rank;i++) {
+    strideOut[permutation[i]] = vol;
+    vol *= dim[permutation[i]];
+  }
+
+  isCopy = (permutation[0] == 0);
+  volMm = dim[0];
+  volMk = isCopy ? 1 : dim[permutation[0]];
+  strideMkIn = isCopy ? 0 : strideIn[permutation[0]];
+  strideMmOut = strideOut[0];
+
+  // Mbar in input order to start with
+  std::vector<int> order;
+  for (int i=1;i < rank;i++) {
+    if (i != permutation[0]) order.push_back(i);
+  }
+  setLoopOrder(order);
+
+  std::vector< std::vector<int> > orders;
+  loopOrders(orders);
+  std::vector<HostLoopNest> blocks;
+  blockShapes(blocks);
+
+  // Estimated times of the loop nests tried
+  const HostModelProp& prop = hostModelProp();
+  std::vector< std::pair<double, HostLoopNest> > ranked;
+  auto tryNest = [&](HostLoopNest trial, const std::vector<int>& trialOrder) {
+    trial.order = trialOrder;
+    setLoopNest(trial);
+    ranked.push_back( {secondsHostPlan(*this, prop), nest} );
+    if (ranked.back().first < ranked.front().first) std::swap(ranked.front(), ranked.back());
+  };
+
+  // Block shapes in input order, then loop orders with the best block shape, then block shapes
+  // again in the best loop order
+  for (int i=0;i < (int)blocks.size();i++) tryNest(blocks[i], orders[0]);
+  HostLoopNest best = ranked.front().second;
+  for (int i=1;i < (int)orders.size();i++) tryNest(best, orders[i]);
+  if (ranked.front().second.order != orders[0]) {
+    best = ranked.front().second;
+    for (int i=0;i < (int)blocks.size();i++) tryNest(blocks[i], best.order);
+  }
+
+  // Keep the fastest distinct loop nests. Half of them come from different loop orders, since the
+  // model tells block shapes apart better than loop orders
+  std::stable_sort(ranked.begin(), ranked.end(),
+    [](const std::pair<double, HostLoopNest>& a, const std::pair<double, HostLoopNest>& b) {
+    return (a.first < b.first);
+  });
+  candidates.clear();
+  for (int pass=0;pass < 2;pass++) {
+    int numCandidate = (pass == 0) ? (HOST_MEASURE_NEST + 1)/2 : HOST_MEASURE_NEST;
+    for (int i=0;i < (int)ranked.size() && (int)candidates.size() < numCandidate;i++) {
+      bool found = false;
+      for (int j=0;j < (int)candidates.size();j++) {
+        found = found || sameLoopNest(candidates[j], ranked[i].second) ||
+          (pass == 0 && candidates[j].order == ranked[i].second.order);
+      }
+      if (!found) candidates.push_back(ranked[i].second);
+    }
+  }
+  setLoopNest(candidates[0]);
+  modelSeconds = ranked[0].first;
+  return true;
+}
+
+//
+// Spreads threads over the nodes of the placement in groups of consecutive threads, so that
+// neighbouring ranges of blocks are written from the same node
+//
+bool cuttHostPlan_t::setPlacement(const cuttHostPlacement placement_in, const unsigned long long nodeMask) {
+  if (placement_in < CUTT_HOST_PLACEMENT_NONE || placement_in > CUTT_HOST_PLACEMENT_NODE_MASK) return false;
+  placement = placement_in;
+  threadNode.clear();
+  if (placement == CUTT_HOST_PLACEMENT_NONE) return true;
+  const std::vector<HostNumaNode>& nodes = hostNumaNodes();
+  std::vector<int> used;
+  for (int i=0;i < (int)nodes.size();i++) {
+    if (placement != CUTT_HOST_PLACEMENT_NODE_MASK || (nodes[i].id < 64 && ((nodeMask >> nodes[i].id) & 1))) {
+      used.push_back(i);
+    }
+  }
+  if (used.size() == 0) return false;
+  for (int i=0;i < numThread;i++) threadNode.push_back(used[(size_t)i*used.size()/numThread]);
+  return true;
+}
+
+//
+// Builds mbar in the given loop order
+//
+void cuttHostPlan_t::setLoopOrder(const std::vector<int>& order) {
+  nest.order = order;
+  mbar.clear();
+  volMbar = 1;
+  for (int j=0;j < (int)order.size();j++) {
+    int i = order[j];
+    TensorConvInOut conv;
+    conv.c_in = volMbar;
+    conv.d_in = dim[i];
+    conv.ct_in = strideIn[i];
+    conv.c_out = volMbar;
+    conv.d_out = dim[i];
+    conv.ct_out = strideOut[i];
+    mbar.push_back(conv);
+    volMbar *= dim[i];
+  }
+}
+
+//
+// Candidate loop orders of Mbar, input order first. All of them for a few Mbar dimensions.
+// Otherwise orders by input stride, by output stride, by the smaller of the two, and by their
+// product, so that dimensions contiguous on one side or in between get the inner loops. With a
+// NUMA placement, the outermost loop is over the dimension of the largest output stride
+//
+void cuttHostPlan_t::loopOrders(std::vector< std::vector<int> >& orders) const {
+  std::vector<int> order = nest.order;
+  std::sort(order.begin(), order.end());
+  std::vector< std::vector<int> > all;
+  if ((int)order.size() <= HOST_ORDER_ALL) {
+    do {
+      all.push_back(order);
+    } while (std::next_permutation(order.begin(), order.end()));
+  } else {
+    all.push_back(order);
+    for (int k=0;k < 3;k++) {
+      std::stable_sort(order.begin(), order.end(), [&](const int a, const int b) {
+        if (k == 0) return (strideOut[a] < strideOut[b]);
+        if (k == 1) return (std::min(strideIn[a], strideOut[a]) < std::min(strideIn[b], strideOut[b]));
+        return ((double)strideIn[a]*strideOut[a] < (double)strideIn[b]*strideOut[b]);
+      });
+      all.push_back(order);
+    }
+  }
+  int outer = -1;
+  if (placement != CUTT_HOST_PLACEMENT_NONE && order.size() > 0) {
+    outer = *std::max_element(order.begin(), order.end(), [&](const int a, const int b) {
+      return (strideOut[a] < strideOut[b]);
+    });
+  }
+  orders.clear();
+  for (int i=0;i < (int)all.size();i++) {
+    std::stable_partition(all[i].begin(), all[i].end(), [&](const int a) {return (a != outer);});
+    if (std::find(orders.begin(), orders.end(), all[i]) == orders.end()) orders.push_back(all[i]);
+  }
+}
+
+//
+// Candidate methods, leaf blocks, and largest blocks for threads
+//
+void cuttHostPlan_t::blockShapes(std::vector<HostLoopNest>& blocks) const {
+  blocks.clear();
+  HostLoopNest block;
+  if (isCopy) {
+    block.method = HostCopy;
+    block.leafMm = std::min(volMm, HOST_LEAF_DIM);
+    block.leafMk = 1;
+    block.tileMk = 1;
+    for (int tile=HOST_COPY_TILE;tile >= HOST_LEAF_DIM;tile /= 16) {
+      // Blocks that cover Mm are all the same
+      if (tile < HOST_COPY_TILE && tile >= volMm) continue;
+      block.tileMm = tile;
+      blocks.push_back(block);
+    }
+    return;
+  }
+  for (int method=HostRecursive;method <= HostBlocked;method++) {
+    block.method = method;
+    for (int leafMm=4;leafMm <= HOST_LEAF_DIM;leafMm *= 2) {
+      for (int leafMk=4;leafMk <= HOST_LEAF_DIM;leafMk *= 2) {
+        // Leaves larger than the extents are the same as the smallest one that covers them
+        if ((leafMm > 4 && leafMm/2 >= volMm) || (leafMk > 4 && leafMk/2 >= volMk)) continue;
+        block.leafMm = leafMm;
+        block.leafMk = leafMk;
+        // Blocks that cover the extents are all the same
+        for (int tileMm=HOST_TILE_DIM;tileMm >= HOST_LEAF_DIM;tileMm /= 4) {
+          if (tileMm < HOST_TILE_DIM && (tileMm < leafMm || tileMm >= volMm)) continue;
+          for (int tileMk=HOST_TILE_DIM;tileMk >= HOST_LEAF_DIM;tileMk /= 4) {
+            if (tileMk < HOST_TILE_DIM && (tileMk < leafMk || tileMk >= volMk)) continue;
+            block.tileMm = tileMm;
+            block.tileMk = tileMk;
+            blocks.push_back(block);
+          }
+        }
+      }
+    }
+  }
+}
+
+bool cuttHostPlan_t::setLoopNest(const HostLoopNest& nest_in) {
+  const int method = nest_in.method;
+  if ((method == HostCopy) != isCopy || method < 0 || method >= NumHostMethods) return false;
+  if (!nest_in.order.empty()) {
+    // Loop order must be a permutation of Mbar
+    std::vector<int> a = nest_in.order;
+    std::vector<int> b = nest.order;
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    if (a != b) return false;
+    setLoopOrder(nest_in.order);
+  }
+  nest.method = method;
+  nest.leafMm = std::max(1, std::min(volMm, nest_in.leafMm));
+  nest.leafMk = isCopy ? 1 : std::max(1, std::min(volMk, nest_in.leafMk));
+
+  // Blocks for threads: at most HOST_TILE_DIM (HOST_COPY_TILE for copy) on a side by default,
+  // halved until every thread gets a few blocks or they reach the leaf size
+  const int numItemMin = numThread*4;
+  int tileMm = (nest_in.tileMm > 0) ? nest_in.tileMm : (isCopy ? HOST_COPY_TILE : HOST_TILE_DIM);
+  int tileMk = (nest_in.tileMk > 0) ? nest_in.tileMk : HOST_TILE_DIM;
+  nest.tileMm = std::min(volMm, std::max(nest.leafMm, tileMm));
+  nest.tileMk = std::min(volMk, std::max(nest.leafMk, tileMk));
+  while (numItem() < numItemMin) {
+    if (nest.tileMm >= nest.tileMk && nest.tileMm > nest.leafMm) {
+      nest.tileMm = std::max(nest.leafMm, (nest.tileMm + 1)/2);
+    } else if (nest.tileMk > nest.leafMk) {
+      nest.tileMk = std::max(nest.leafMk, (nest.tileMk + 1)/2);
+    } else {
+      break;
+    }
+  }
+  return true;
+}
+
+bool cuttHostPlan_t::setLoopNest(const int method, const int leafMm, const int leafMk) {
+  HostLoopNest trial;
+  trial.method = method;
+  trial.leafMm = leafMm;
+  trial.leafMk = leafMk;
+  trial.tileMm = 0;
+  trial.tileMk = 0;
+  return setLoopNest(trial);
+}
+
+void cuttHostPlan_t::touch(void* out) const {
+  CUTT_TRACE_SCOPE("cuttHostPlan_t::touch");
+  if (placement == CUTT_HOST_PLACEMENT_INTERLEAVE) {
+    unsigned long long nodeMask = 0;
+    for (int i=0;i < (int)threadNode.size();i++) {
+      int id = hostNumaNodes()[threadNode[i]].id;
+      if (id < 64) nodeMask |= (1ULL << id);
+    }
+    hostInterleave(out, (size_t)volMm*volMk*volMbar*sizeofType, nodeMask);
+  }
+  // Input is not read
+  if (sizeofType == 4) {
+    executeOp((const unsigned int*)out, (unsigned int*)out, HostZeroOp<unsigned int>());
+  } else {
+    executeOp((const unsigned long long int*)out, (unsigned long long int*)out, HostZeroOp<unsigned long long int>());
+  }
+}
+
+double cuttHostPlan_t::measure(const void* in, void* out) {
+  CUTT_TRACE_SCOPE("cuttHostPlan_t::measure");
+  std::vector<HostLoopNest> trials = candidates;
+  if (trials.empty()) trials.push_back(nest);
+  // First run touches the pages of out, so that the candidates are timed alike
+  execute(in, out);
+  double bestSeconds = 0.0;
+  HostLoopNest best = nest;
+  for (int i=0;i < (int)trials.size();i++) {
+    setLoopNest(trials[i]);
+    auto start = std::chrono::steady_clock::now();
+    execute(in, out);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (i == 0 || seconds < bestSeconds) {
+      bestSeconds = seconds;
+      best = nest;
+    }
+  }
+  setLoopNest(best);
+  return bestSeconds;
+}
+
+long long cuttHostPlan_t::numItem() const {
+  return (long long)volMbar*((volMm - 1)/nest.tileMm + 1)*((volMk - 1)/nest.tileMk + 1);
+}
+
+//
+// Leaf kernel, transposes block [a0, a1) x [b0, b1) of Mm x Mk
+//
+template <typename T, typename Op>
+static inline void transposeLeaf(const T* in, T* out, const int strideMkIn, const int strideMmOut,
+  const int a0, const int a1, const int b0, const int b1, const Op& op) {
+  for (int b=b0;b < b1;b++) {
+    const T* src = in + (size_t)b*strideMkIn;
+    T* dst = out + b;
+    for (int a=a0;a < a1;a++) op(src[a], dst[(size_t)a*strideMmOut]);
+  }
+}
+
+//
+// Transposes block [a0, a1) x [b0, b1) of Mm x Mk by halving the larger extent
+// until the block fits the leaf
+//
+template <typename T, typename Op>
+static void transposeRec(const T* in, T* out, const int strideMkIn, const int strideMmOut,
+  const int leafMm, const int leafMk, const int a0, const int a1, const int b0, const int b1, const Op& op) {
+
+  if (a1 - a0 <= leafMm && b1 - b0 <= leafMk) {
+    transposeLeaf(in, out, strideMkIn, strideMmOut, a0, a1, b0, b1, op);
+  } else if ((a1 - a0)*leafMk >= (b1 - b0)*leafMm) {
+    int am = a0 + (a1 - a0)/2;
+    transposeRec(in, out, strideMkIn, strideMmOut, leafMm, leafMk, a0, am, b0, b1, op);
+    transposeRec(in, out, strideMkIn, strideMmOut, leafMm, leafMk, am, a1, b0, b1, op);
+  } else {
+    int bm = b0 + (b1 - b0)/2;
+    transposeRec(in, out, strideMkIn, strideMmOut, leafMm, leafMk, a0, a1, b0, bm, op);
+    transposeRec(in, out, strideMkIn, strideMmOut, leafMm, leafMk, a0, a1, bm, b1, op);
+  }
+}
+
+template <typename T, typename Op>
+void cuttHostPlan_t::executeOp(const T* in, T* out, const Op& op) const {
+  const int tileMm = nest.tileMm;
+  const int tileMk = nest.tileMk;
+  const int leafMm = nest.leafMm;
+  const int leafMk = nest.leafMk;
+  const int numTileMm = (volMm - 1)/tileMm + 1;
+  const int numTileMk = (volMk - 1)/tileMk + 1;
+  const int numTile = numTileMm*numTileMk;
+  const int numItem = volMbar*numTile;
+
+  // Blocks [begin, end)
+  auto work = [&](int begin, int end) {
+    for (int item=begin;item < end;item++) {
+      int p = item/numTile;
+      int tile = item - p*numTile;
+      size_t posIn = 0;
+      size_t posOut = 0;
+      for (int i=0;i < (int)mbar.size();i++) {
+        int idx = (p/mbar[i].c_in) % mbar[i].d_in;
+        posIn += (size_t)idx*mbar[i].ct_in;
+        posOut += (size_t)idx*mbar[i].ct_out;
+      }
+      int a0 = (tile % numTileMm)*tileMm;
+      int a1 = std::min(volMm, a0 + tileMm);
+      int b0 = (tile/numTileMm)*tileMk;
+      int b1 = std::min(volMk, b0 + tileMk);
+      if (nest.method == HostCopy) {
+        for (int a=a0;a < a1;a++) op(in[posIn + a], out[posOut + a]);
+      } else if (nest.method == HostRecursive) {
+        transposeRec(in + posIn, out + posOut, strideMkIn, strideMmOut, leafMm, leafMk, a0, a1, b0, b1, op);
+      } else {
+        for (int a=a0;a < a1;a += leafMm) {
+          for (int b=b0;b < b1;b += leafMk) {
+            transposeLeaf(in + posIn, out + posOut, strideMkIn, strideMmOut,
+              a, std::min(a1, a + leafMm), b, std::min(b1, b + leafMk), op);
+          }
+        }
+      }
+    }
+  };
+
+  if (threadNode.size() == 0) {
+    const int chunk = std::max(1, numItem/(numThread*8));
+    parallelFor(numItem, chunk, numThread, work);
+  } else {
+    // Thread i is bound to node threadNode[i] and always gets the i-th range of blocks
+    const std::vector<HostNumaNode>& nodes = hostNumaNodes();
+    std::vector<std::thread> threads;
+    for (int i=0;i < numThread;i++) {
+      threads.push_back(std::thread([&, i]() {
+        hostBindThread(nodes[threadNode[i]].cpus);
+        work((int)((long long)numItem*i/numThread), (int)((long long)numItem*(i + 1)/numThread));
+      }));
+    }
+    for (int i=0;i < numThread;i++) threads[i].join();
+  }
+}
+
+//
+// Element type T of scaling, U of plain copy of the bits when alpha = 1 and beta = 0
+//
+template <typename T, typename U>
+void cuttHostPlan_t::executeScaled(const void* in, void* out, const void* alpha, const void* beta) const {
+  T a = (alpha != NULL) ? *(const T*)alpha : (T)1;
+  T b = (beta != NULL) ? *(const T*)beta : (T)0;
+  if (b != (T)0) {
+    HostScaleAddOp<T> op = {a, b};
+    executeOp((const T*)in, (T*)out, op);
+  } else if (a != (T)1) {
+    HostScaleOp<T> op = {a};
+    executeOp((const T*)in, (T*)out, op);
+  } else {
+    executeOp((const U*)in, (U*)out, HostCopyOp<U>());
+  }
+}
+
+void cuttHostPlan_t::execute(const void* in, void* out, const void* alpha, const void* beta) const {
+  CUTT_TRACE_SCOPE("cuttHostPlan_t::execute");
+  if (sizeofType == 4) {
+    executeScaled<float, unsigned int>(in, out, alpha, beta);
+  } else {
+    executeScaled<double, unsigned long long int>(in, out, alpha, beta);
+  }
+}
+
+size_t cuttHostPlan_t::executeBytes(const bool readOut) const {
+  return (size_t)volMm*(size_t)volMk*(size_t)volMbar*sizeofType*(readOut ? 3 : 2);
+}
+
+void cuttHostPlan_t::dropAnalysis() {
+  std::vector<HostLoopNest>().swap(candidates);
+}
+
+size_t cuttHostPlan_t::memoryUsage() const {
+  size_t bytes = sizeof(cuttHostPlan_t) + (dim.capacity() + permutation.capacity() + strideIn.capacity() +
+    strideOut.capacity() + nest.order.capacity() + threadNode.capacity())*sizeof(int) + mbar.capacity()*sizeof(TensorConvInOut);
+  for (int i=0;i < (int)candidates.size();i++) {
+    bytes += sizeof(HostLoopNest) + candidates[i].order.capacity()*sizeof(int);
+  }
+  return bytes;
+}
+
+void cuttHostPlan_t::print() const {
+  printf("host %s volMm %d volMk %d volMbar %d leaf %d x %d tile %d x %d order",
+    hostMethodName(nest.method), volMm, volMk, volMbar, nest.leafMm, nest.leafMk, nest.tileMm, nest.tileMk);
+  for (int i=0;i < (int)nest.order.size();i++) printf(" %d", nest.order[i]);
+  printf(" threads %d", numThread);
+  if (placement != CUTT_HOST_PLACEMENT_NONE) {
+    printf(" on nodes");
+    for (int i=0;i < (int)threadNode.size();i++) printf(" %d", hostNumaNodes()[threadNode[i]].id);
+  }
+  printf(" model %e s\n", modelSeconds);
+}
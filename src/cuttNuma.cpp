@@ -0,0 +1,141 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+#include "cuttNuma.h"
+
+//
+// Parses a CPU or node list such as "0-3,8,10-11"
+//
+static std::vector<int> parseList(const char* str) {
+  std::vector<int> list;
+  const char* p = str;
+  while (*p != 0 && *p != '\n') {
+    char* end;
+    int first = (int)std::strtol(p, &end, 10);
+    if (end == p) break;
+    int last = first;
+    p = end;
+    if (*p == '-') {
+      last = (int)std::strtol(p + 1, &end, 10);
+      p = end;
+    }
+    for (int i=first;i <= last;i++) list.push_back(i);
+    if (*p == ',') p++;
+  }
+  return list;
+}
+
+//
+// First line of file, empty if it cannot be read
+//
+static std::string readLine(const char* fileName) {
+  std::string line;
+  FILE* fp = std::fopen(fileName, "r");
+  if (fp == NULL) return line;
+  char buf[4096];
+  if (std::fgets(buf, sizeof(buf), fp) != NULL) line = buf;
+  std::fclose(fp);
+  return line;
+}
+
+static std::vector<HostNumaNode> detectNumaNodes() {
+  std::vector<HostNumaNode> nodes;
+#ifdef __linux__
+  std::vector<int> online = parseList(readLine("/sys/devices/system/node/online").c_str());
+  for (int i=0;i < (int)online.size();i++) {
+    char fileName[128];
+    std::snprintf(fileName, sizeof(fileName), "/sys/devices/system/node/node%d/cpulist", online[i]);
+    HostNumaNode node;
+    node.id = online[i];
+    node.cpus = parseList(readLine(fileName).c_str());
+    // Nodes with memory only
+    if (node.cpus.size() > 0) nodes.push_back(node);
+  }
+#endif
+  if (nodes.size() == 0) {
+    HostNumaNode node;
+    node.id = 0;
+    int numCpu = std::max(1, (int)std::thread::hardware_concurrency());
+    for (int i=0;i < numCpu;i++) node.cpus.push_back(i);
+    nodes.push_back(node);
+  }
+  return nodes;
+}
+
+const std::vector<HostNumaNode>& hostNumaNodes() {
+  static const std::vector<HostNumaNode> nodes = detectNumaNodes();
+  return nodes;
+}
+
+bool hostBindThread(const std::vector<int>& cpus) {
+#ifdef __linux__
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (int i=0;i < (int)cpus.size();i++) {
+    if (cpus[i] >= 0 && cpus[i] < CPU_SETSIZE) CPU_SET(cpus[i], &cpuset);
+  }
+  return (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0);
+#else
+  return false;
+#endif
+}
+
+bool hostInterleave(void* ptr, const size_t bytes, const unsigned long long nodeMask) {
+#if defined(__linux__) && defined(SYS_mbind)
+  const size_t pageBytes = (size_t)sysconf(_SC_PAGESIZE);
+  size_t begin = (size_t)ptr/pageBytes*pageBytes;
+  size_t end = ((size_t)ptr + bytes + pageBytes - 1)/pageBytes*pageBytes;
+  unsigned long mask[64/(8*sizeof(unsigned long)) + 1] = {0};
+  std::memcpy(mask, &nodeMask, sizeof(nodeMask));
+  return (syscall(SYS_mbind, begin, end - begin, MPOL_INTERLEAVE, mask, 64 + 1, 0) == 0);
+#else
+  return false;
+#endif
+}
+
+int hostPageNode(const void* ptr) {
+#if defined(__linux__) && defined(SYS_move_pages)
+  const size_t pageBytes = (size_t)sysconf(_SC_PAGESIZE);
+  void* page = (void *)((size_t)ptr/pageBytes*pageBytes);
+  int status = -1;
+  // Without target nodes move_pages() only reports where the pages are
+  if (syscall(SYS_move_pages, 0, 1, &page, NULL, &status, 0) != 0) return -1;
+  return (status >= 0) ? status : -1;
+#else
+  return -1;
+#endif
+}
@@ -0,0 +1,102 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include "CudaUtils.h"
+#include "cuttStats.h"
+
+//
+// Statistics are on if environment variable CUTT_STATS is set to a non-zero value,
+// until changed by cuttStatsEnable()
+//
+static bool statsInitFromEnv() {
+  const char* env = getenv("CUTT_STATS");
+  return (env != NULL && strcmp(env, "") != 0 && strcmp(env, "0") != 0);
+}
+
+static std::atomic<bool> statsOn(statsInitFromEnv());
+
+void cuttStatsEnable(bool enable) {
+  statsOn.store(enable, std::memory_order_relaxed);
+}
+
+bool statsEnabled() {
+  return statsOn.load(std::memory_order_relaxed);
+}
+
+void addStats(cuttStats& a, const cuttStats& b) {
+  a.numExecute += b.numExecute;
+  a.numBytes += b.numBytes;
+  a.numTimed += b.numTimed;
+  a.seconds += b.seconds;
+}
+
+PlanStats::PlanStats() : numEvent(0), first(0), numPending(0), cur(-1) {
+  memset(&stats, 0, sizeof(stats));
+}
+
+PlanStats::~PlanStats() {
+  for (int i=0;i < numEvent;i++) {
+    cudaCheck(cudaEventDestroy(startEvent[i]));
+    cudaCheck(cudaEventDestroy(stopEvent[i]));
+  }
+}
+
+void PlanStats::begin(cudaStream_t stream) {
+  update();
+  cur = -1;
+  if (numPending == PLAN_STATS_MAX_PENDING) return;
+  cur = (first + numPending) % PLAN_STATS_MAX_PENDING;
+  if (cur == numEvent) {
+    cudaCheck(cudaEventCreate(&startEvent[cur]));
+    cudaCheck(cudaEventCreate(&stopEvent[cur]));
+    numEvent++;
+  }
+  cudaCheck(cudaEventRecord(startEvent[cur], stream));
+}
+
+void PlanStats::end(cudaStream_t stream, const size_t bytes) {
+  stats.numExecute++;
+  stats.numBytes += bytes;
+  if (cur == -1) return;
+  cudaCheck(cudaEventRecord(stopEvent[cur], stream));
+  numPending++;
+  cur = -1;
+}
+
+void PlanStats::update() {
+  while (numPending > 0) {
+    cudaError_t err = cudaEventQuery(stopEvent[first]);
+    if (err == cudaErrorNotReady) break;
+    cudaCheck(err);
+    float ms;
+    cudaCheck(cudaEventElapsedTime(&ms, startEvent[first], stopEvent[first]));
+    stats.numTimed++;
+    stats.seconds += ms*1.0e-3;
+    first = (first + 1) % PLAN_STATS_MAX_PENDING;
+    numPending--;
+  }
+}
@@ -0,0 +1,127 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include "cuttTelemetry.h"
+#include "cuttTimer.h"  // intList
+
+// Name of the telemetry log file, empty if telemetry is disabled
+static std::string telemetryFile;
+static std::once_flag telemetryFileFlag;
+// Serializes writes into the log file and numbering of the records
+static std::mutex telemetryMutex;
+static int telemetryCount = 0;
+// Identifies this process in the log
+static long long telemetryStamp = 0;
+
+// Columns of the telemetry log
+static const char* telemetryHeader =
+  "event,device,clock_khz,num_sm,rank,dim,permutation,sizeof_type,"
+  "plan,method,plan_rank,heuristic,best,time,cycles_measured,cycles,"
+  "num_iter,mlp,num_thread,num_active_block,"
+  "gld_req,gst_req,gld_tran,gst_tran,sld_req,sst_req,sld_tran,sst_tran,"
+  "cl_full_l2,cl_part_l2,cl_full_l1,cl_part_l1,num_pos_mbar,tran_mean,tran_var\n";
+
+static void initTelemetryFile() {
+  const char* env = std::getenv("CUTT_TELEMETRY_FILE");
+  if (env != NULL) telemetryFile = env;
+  telemetryStamp = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static const char* methodName(int method) {
+  switch(method) {
+    case Trivial: return "Trivial";
+    case Packed: return "Packed";
+    case PackedSplit: return "PackedSplit";
+    case Tiled: return "Tiled";
+    case TiledCopy: return "TiledCopy";
+  };
+  return "Unknown";
+}
+
+bool cuttTelemetryEnabled() {
+  std::call_once(telemetryFileFlag, initTelemetryFile);
+  return !telemetryFile.empty();
+}
+
+void cuttTelemetryRecord(const cudaDeviceProp& prop, const int rank, const int* dim, const int* permutation,
+  const size_t sizeofType, const PlanCandidates& plans, const std::vector<double>& times,
+  const int heurPlan, const int bestPlan) {
+
+  if (!cuttTelemetryEnabled()) return;
+
+  // Device name is free text, make sure it does not break the CSV format
+  std::string device(prop.name);
+  for (size_t i=0;i < device.size();i++) {
+    if (device[i] == ',' || device[i] == '\n') device[i] = ' ';
+  }
+  std::string dimStr = intList(rank, dim);
+  std::string permStr = intList(rank, permutation);
+
+  // Conversion factor from wallclock time to total number of cycles = (GPU clock in Hz) x #SM
+  double freq_SM = (double)(prop.clockRate*1000)*(double)prop.multiProcessorCount;
+
+  std::lock_guard<std::mutex> lock(telemetryMutex);
+
+  // Build the whole record first so that it is appended with a single write
+  std::string record;
+  char buf[1024];
+  int i = 0;
+  for (auto it=plans.begin();it != plans.end() && i < (int)times.size();it++,i++) {
+    const LaunchConfig& lc = it->launchConfig;
+    int numthread = lc.numthread.x*lc.numthread.y*lc.numthread.z;
+    snprintf(buf, sizeof(buf), "%lld.%d,%s,%d,%d,%d,%s,%s,%d,"
+      "%d,%s,%d,%d,%d,%e,%e,%e,"
+      "%d,%1.3f,%d,%d,"
+      "%d,%d,%d,%d,%d,%d,%d,%d,"
+      "%d,%d,%d,%d,%d,%e,%e\n",
+      telemetryStamp, telemetryCount, device.c_str(), prop.clockRate, prop.multiProcessorCount,
+      rank, dimStr.c_str(), permStr.c_str(), (int)sizeofType,
+      i, methodName(it->tensorSplit.method), it->rank, (int)(i == heurPlan), (int)(i == bestPlan),
+      times[i], times[i]*freq_SM, it->cycles,
+      it->num_iter, it->mlp, numthread, it->numActiveBlock,
+      it->gld_req, it->gst_req, it->gld_tran, it->gst_tran,
+      it->sld_req, it->sst_req, it->sld_tran, it->sst_tran,
+      it->cl_full_l2, it->cl_part_l2, it->cl_full_l1, it->cl_part_l1,
+      it->numPosMbar, it->tranMean, it->tranVar);
+    record += buf;
+  }
+  telemetryCount++;
+
+  FILE* fp = fopen(telemetryFile.c_str(), "a");
+  if (fp == NULL) {
+    fprintf(stderr, "cuttTelemetryRecord, unable to open file %s\n", telemetryFile.c_str());
+    return;
+  }
+  // Write header if this is a new file
+  fseek(fp, 0, SEEK_END);
+  if (ftell(fp) == 0) fputs(telemetryHeader, fp);
+  fputs(record.c_str(), fp);
+  fclose(fp);
+}
@@ -27,56 +27,144 @@ SOFTWARE.
 #include "CudaUtils.h"
 // #include <limits>       // std::numeric_limits
 #include <algorithm>
-#ifdef CUDA_EVENT_TIMER
-#include "CudaUtils.h"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <map>
+#include <mutex>
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define CUTT_TIMER_TSC
+#elif defined(__aarch64__)
+#define CUTT_TIMER_TSC
 #endif
 
-#ifdef CUDA_EVENT_TIMER
-Timer::Timer() {
-  cudaCheck(cudaEventCreate(&tmstart));
-  cudaCheck(cudaEventCreate(&tmend));
+#ifdef CUTT_TIMER_TSC
+static inline unsigned long long readTsc() {
+#if defined(__aarch64__)
+  unsigned long long val;
+  asm volatile("mrs %0, cntvct_el0" : "=r" (val));
+  return val;
+#else
+  return __rdtsc();
+#endif
 }
-Timer::~Timer() {
-  cudaCheck(cudaEventDestroy(tmstart));
-  cudaCheck(cudaEventDestroy(tmend));
+
+//
+// Returns time stamp counter ticks per second, measured once against steady_clock
+//
+static double tscFrequency() {
+  static double freq = 0.0;
+  static std::once_flag flag;
+  std::call_once(flag, []() {
+    // Best of a few 10 ms intervals, interruptions only make an interval look longer
+    for (int i=0;i < 3;i++) {
+      std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+      unsigned long long tsc0 = readTsc();
+      std::chrono::steady_clock::time_point t1;
+      do {
+        t1 = std::chrono::steady_clock::now();
+      } while (t1 - t0 < std::chrono::milliseconds(10));
+      unsigned long long tsc1 = readTsc();
+      double sec = std::chrono::duration_cast< std::chrono::duration<double> >(t1 - t0).count();
+      freq = std::max(freq, (double)(tsc1 - tsc0)/sec);
+    }
+  });
+  return freq;
 }
 #endif
 
+Timer::Timer(TimerClock clock_in) : clock(clock_in), tscStart(0), tscEnd(0) {
+  if (clock == TimerClockCudaEvent) {
+    cudaCheck(cudaEventCreate(&tmstart));
+    cudaCheck(cudaEventCreate(&tmend));
+  }
+#ifdef CUTT_TIMER_TSC
+  // Calibrate before the first measurement
+  if (clock == TimerClockTsc) tscFrequency();
+#endif
+}
+
+Timer::~Timer() {
+  if (clock == TimerClockCudaEvent) {
+    cudaCheck(cudaEventDestroy(tmstart));
+    cudaCheck(cudaEventDestroy(tmend));
+  }
+}
+
 void Timer::start() {
-#ifdef CUDA_EVENT_TIMER
-  cudaCheck(cudaEventRecord(tmstart, 0));
-#else
-  tmstart = std::chrono::high_resolution_clock::now();
+  switch(clock) {
+    case TimerClockCudaEvent:
+    cudaCheck(cudaEventRecord(tmstart, 0));
+    break;
+#ifdef CUTT_TIMER_TSC
+    case TimerClockTsc:
+    tscStart = readTsc();
+    break;
 #endif
+    default:
+    clockStart = std::chrono::steady_clock::now();
+  }
 }
 
 void Timer::stop() {
-#ifdef CUDA_EVENT_TIMER
-  cudaCheck(cudaEventRecord(tmend, 0));
-  cudaCheck(cudaEventSynchronize(tmend));
-#else
-  cudaCheck(cudaDeviceSynchronize());
-  tmend = std::chrono::high_resolution_clock::now();
+  switch(clock) {
+    case TimerClockCudaEvent:
+    cudaCheck(cudaEventRecord(tmend, 0));
+    cudaCheck(cudaEventSynchronize(tmend));
+    break;
+#ifdef CUTT_TIMER_TSC
+    case TimerClockTsc:
+    tscEnd = readTsc();
+    break;
 #endif
+    default:
+    clockEnd = std::chrono::steady_clock::now();
+  }
 }
 
 //
 // Returns the duration of the last run in seconds
 //
 double Timer::seconds() {
-#ifdef CUDA_EVENT_TIMER
-  float ms;
-  cudaCheck(cudaEventElapsedTime(&ms, tmstart, tmend));
-  return (double)(ms/1000.0f);
-#else
-  return std::chrono::duration_cast< std::chrono::duration<double> >(tmend - tmstart).count();
+  switch(clock) {
+    case TimerClockCudaEvent:
+    {
+      float ms;
+      cudaCheck(cudaEventElapsedTime(&ms, tmstart, tmend));
+      return (double)(ms/1000.0f);
+    }
+#ifdef CUTT_TIMER_TSC
+    case TimerClockTsc:
+    return (double)(tscEnd - tscStart)/tscFrequency();
 #endif
+    default:
+    return std::chrono::duration_cast< std::chrono::duration<double> >(clockEnd - clockStart).count();
+  }
+}
+
+bool timerClockFromName(const char* name, TimerClock& clock) {
+  if (strcmp(name, "event") == 0) {
+    clock = TimerClockCudaEvent;
+  } else if (strcmp(name, "steady") == 0) {
+    clock = TimerClockSteady;
+  } else if (strcmp(name, "tsc") == 0) {
+    clock = TimerClockTsc;
+  } else {
+    return false;
+  }
+  return true;
 }
 
 //
 // Class constructor
 //
-cuttTimer::cuttTimer(int sizeofType) : sizeofType(sizeofType) {}
+cuttTimer::cuttTimer(int sizeofType, TimerClock clock) : sizeofType(sizeofType), timer(clock) {}
 
 //
 // Class destructor
@@ -119,6 +207,12 @@ void cuttTimer::stop() {
   }
   stat.maxBW = std::max(stat.maxBW, bandwidth);
   stat.BW.push_back(bandwidth);
+  Sample sample;
+  sample.dim = curDim;
+  sample.permutation = curPermutation;
+  sample.bytes = curBytes;
+  sample.seconds = seconds();
+  samples.push_back(sample);
 }
 
 //
@@ -199,6 +293,28 @@ double cuttTimer::getMedian(int rank) {
   return median;
 }
 
+//
+// Returns the value below which p percent of sorted values are
+//
+double percentileSorted(const std::vector<double>& sorted, double p) {
+  if (sorted.size() == 0) return 0.0;
+  double x = std::min(std::max(p, 0.0), 100.0)/100.0*(double)(sorted.size() - 1);
+  int i = std::min((int)x, (int)sorted.size() - 2);
+  if (i < 0) return sorted[0];
+  return sorted[i] + (x - (double)i)*(sorted[i + 1] - sorted[i]);
+}
+
+//
+// Returns the bandwidth below which p percent of the runs for rank are
+//
+double cuttTimer::getPercentile(int rank, double p) {
+  auto it = stats.find(rank);
+  if (it == stats.end()) return 0.0;
+  std::vector<double> BW = it->second.BW;
+  std::sort(BW.begin(), BW.end());
+  return percentileSorted(BW, p);
+}
+
 //
 // Returns the average bandwidth for rank
 //
@@ -244,3 +360,34 @@ double cuttTimer::getWorst(std::vector<int>& dim, std::vector<int>& permutation)
   permutation = stats.find(worstRank)->second.worstPermutation;
   return worstBW;
 }
+
+std::string intList(const int n, const int* val) {
+  std::string str;
+  for (int i=0;i < n;i++) {
+    if (i > 0) str += "x";
+    str += std::to_string(val[i]);
+  }
+  return str;
+}
+
+//
+// Appends every run to CSV file fileName as row
+// label,sizeof_type,rank,dim,permutation,rep,seconds,GBs
+// where rep counts the runs of the same tensor. Header is written if the file is new
+//
+bool cuttTimer::writeSamples(const char* fileName, const char* label) {
+  FILE* fp = fopen(fileName, "a");
+  if (fp == NULL) return false;
+  fseek(fp, 0, SEEK_END);
+  if (ftell(fp) == 0) fprintf(fp, "label,sizeof_type,rank,dim,permutation,rep,seconds,GBs\n");
+  std::map<std::string, int> numRep;
+  for (int i=0;i < samples.size();i++) {
+    const Sample& sample = samples[i];
+    std::string tensor = intList(sample.dim) + "," + intList(sample.permutation);
+    double GBs = (sample.seconds == 0.0) ? 0.0 : (double)sample.bytes/(1.0e9*sample.seconds);
+    fprintf(fp, "%s,%d,%d,%s,%d,%e,%lf\n", label, sizeofType, (int)sample.dim.size(), tensor.c_str(),
+      numRep[tensor]++, sample.seconds, GBs);
+  }
+  fclose(fp);
+  return true;
+}
@@ -0,0 +1,215 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "CudaUtils.h"
+#include "cuttTrace.h"
+#include "cutt.h"
+
+#ifdef ENABLE_TRACE
+
+struct TraceEvent {
+  const char* name;
+  // Start time and duration in nanoseconds
+  long long start;
+  long long duration;
+};
+
+//
+// Ring buffer of the spans of one thread. Buffers stay alive after their thread exits,
+// so that the trace can be written at any time
+//
+struct TraceBuffer {
+  int tid;
+  // Guards events and count. Taken only for spans recorded while tracing is on, and uncontended
+  // except while the trace is written
+  std::mutex mutex;
+  std::vector<TraceEvent> events;
+  // Number of spans recorded, the last TRACE_BUFFER_SIZE of them are kept
+  long long count;
+
+  TraceBuffer(const int tid) : tid(tid), events(TRACE_BUFFER_SIZE), count(0) {}
+};
+
+struct TraceState;
+static cuttResult traceWrite(TraceState& state, const char* fileName);
+
+struct TraceState {
+  std::mutex mutex;
+  std::vector< std::shared_ptr<TraceBuffer> > buffers;
+  std::chrono::steady_clock::time_point epoch;
+  // File written at exit, from CUTT_TRACE_FILE
+  std::string exitFile;
+
+  TraceState() : epoch(std::chrono::steady_clock::now()) {}
+  ~TraceState() {
+    if (!exitFile.empty()) traceWrite(*this, exitFile.c_str());
+  }
+};
+
+static TraceState& traceState() {
+  static TraceState state;
+  return state;
+}
+
+static std::atomic<bool> traceOn(false);
+
+// Open spans of the calling thread. Start time is -1 for spans opened while tracing was off
+static thread_local long long traceStart[TRACE_MAX_DEPTH];
+static thread_local const char* traceName[TRACE_MAX_DEPTH];
+static thread_local TraceBuffer* traceBuffer = NULL;
+
+static long long traceNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - traceState().epoch).count();
+}
+
+static TraceBuffer* traceThreadBuffer() {
+  if (traceBuffer == NULL) {
+    TraceState& state = traceState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.buffers.push_back(std::make_shared<TraceBuffer>((int)state.buffers.size()));
+    traceBuffer = state.buffers.back().get();
+  }
+  return traceBuffer;
+}
+
+// Enables tracing when CUTT_TRACE_FILE is set
+static bool traceInitFromEnv() {
+  const char* env = std::getenv("CUTT_TRACE_FILE");
+  if (env != NULL && env[0] != 0) {
+    traceState().exitFile = env;
+    traceOn = true;
+  }
+  return true;
+}
+static bool traceInit = traceInitFromEnv();
+
+#endif // ENABLE_TRACE
+
+// Number of open spans of the calling thread
+static thread_local int traceDepth = 0;
+
+int cuttTraceBegin(const char* name) {
+#ifdef ENABLE_NVTOOLS
+  gpuRangeStart(name);
+#endif
+#ifdef ENABLE_TRACE
+  if (traceDepth < TRACE_MAX_DEPTH) {
+    traceName[traceDepth] = name;
+    traceStart[traceDepth] = traceOn.load(std::memory_order_relaxed) ? traceNow() : -1;
+  }
+#endif
+  return traceDepth++;
+}
+
+void cuttTraceEnd() {
+  if (traceDepth == 0) return;
+  traceDepth--;
+#ifdef ENABLE_NVTOOLS
+  gpuRangeStop();
+#endif
+#ifdef ENABLE_TRACE
+  if (traceDepth >= TRACE_MAX_DEPTH || traceStart[traceDepth] < 0) return;
+  long long end = traceNow();
+  TraceBuffer* buffer = traceThreadBuffer();
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  TraceEvent& event = buffer->events[buffer->count % TRACE_BUFFER_SIZE];
+  event.name = traceName[traceDepth];
+  event.start = traceStart[traceDepth];
+  event.duration = end - event.start;
+  buffer->count++;
+#endif
+}
+
+void cuttTraceEndTo(const int depth) {
+  while (traceDepth > depth) cuttTraceEnd();
+}
+
+void cuttTraceEnable(bool enable) {
+#ifdef ENABLE_TRACE
+  traceOn = enable;
+#endif
+}
+
+#ifdef ENABLE_TRACE
+// Writes string s as a JSON string
+static void writeJsonString(FILE* fp, const char* s) {
+  fputc('"', fp);
+  for (;*s != 0;s++) {
+    if (*s == '"' || *s == '\\') fputc('\\', fp);
+    if ((unsigned char)*s >= 0x20) fputc(*s, fp);
+  }
+  fputc('"', fp);
+}
+
+static cuttResult traceWrite(TraceState& state, const char* fileName) {
+  if (fileName == NULL) return CUTT_INVALID_PARAMETER;
+  FILE* fp = fopen(fileName, "w");
+  if (fp == NULL) return CUTT_INVALID_PARAMETER;
+  std::lock_guard<std::mutex> lock(state.mutex);
+  fprintf(fp, "{\"traceEvents\":[\n");
+  bool first = true;
+  std::vector<TraceEvent> events;
+  for (int i=0;i < state.buffers.size();i++) {
+    TraceBuffer& buffer = *state.buffers[i];
+    fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"cutt %d\"}}",
+      first ? "" : ",\n", buffer.tid, buffer.tid);
+    first = false;
+    // Copy the spans in order, so that the owning thread is not held up by file output
+    events.clear();
+    {
+      std::lock_guard<std::mutex> bufferLock(buffer.mutex);
+      long long begin = (buffer.count > TRACE_BUFFER_SIZE) ? buffer.count - TRACE_BUFFER_SIZE : 0;
+      for (long long j=begin;j < buffer.count;j++) events.push_back(buffer.events[j % TRACE_BUFFER_SIZE]);
+    }
+    for (int j=0;j < events.size();j++) {
+      const TraceEvent& event = events[j];
+      fprintf(fp, ",\n{\"name\":");
+      writeJsonString(fp, event.name);
+      // Times are in microseconds
+      fprintf(fp, ",\"cat\":\"cutt\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%d}",
+        event.start*1.0e-3, event.duration*1.0e-3, buffer.tid);
+    }
+  }
+  fprintf(fp, "\n],\"displayTimeUnit\":\"ns\"}\n");
+  fclose(fp);
+  return CUTT_SUCCESS;
+}
+#endif
+
+cuttResult cuttTraceWrite(const char* fileName) {
+#ifdef ENABLE_TRACE
+  return traceWrite(traceState(), fileName);
+#else
+  return CUTT_INVALID_PARAMETER;
+#endif
+}
@@ -569,19 +569,46 @@ void cuttKernelSetSharedMemConfig() {
 }
 
 // Caches for PackedSplit kernels. One cache for all devices
-// NOTE: Not thread safe
 const int CACHE_SIZE = 100000;
 const int MAX_NUMWARP = (1024/32);
 const int MAX_NUMTYPE = 2;
-static int numDevices = -1;
 LRUCache<unsigned long long int, int> nabCache(CACHE_SIZE, -1);
 
+static int getNumDevices() {
+  int numDevices;
+  cudaCheck(cudaGetDeviceCount(&numDevices));
+  return numDevices;
+}
+
+//
+// Returns an estimate of the maximum number of active blocks per SM on a virtual device.
+// Limited by threads, shared memory, and registers per SM, with the register use of the kernels
+// estimated from the register storage
+//
+static int getNumActiveBlockVirtual(const int method, const int sizeofType, const LaunchConfig& lc,
+  const cudaDeviceProp& prop) {
+
+  if (method == Trivial) return 1;
+  int numthread = lc.numthread.x * lc.numthread.y * lc.numthread.z;
+  if (numthread <= 0) return 0;
+  int numActiveBlock = (prop.major >= 5) ? 32 : 16;
+  numActiveBlock = min(numActiveBlock, prop.maxThreadsPerMultiProcessor/numthread);
+  if (lc.shmemsize > 0) numActiveBlock = min(numActiveBlock, (int)(prop.sharedMemPerMultiprocessor/lc.shmemsize));
+  int regPerThread = 32;
+  if (method == Packed || method == PackedSplit) regPerThread += lc.numRegStorage*sizeofType/2;
+  regPerThread = min(255, regPerThread);
+  numActiveBlock = min(numActiveBlock, prop.regsPerMultiprocessor/(regPerThread*numthread));
+  return max(0, numActiveBlock);
+}
+
 //
 // Returns the maximum number of active blocks per SM
 //
 int getNumActiveBlock(const int method, const int sizeofType, const LaunchConfig& lc,
   const int deviceID, const cudaDeviceProp& prop) {
 
+  if (deviceID == CUTT_VIRTUAL_DEVICE) return getNumActiveBlockVirtual(method, sizeofType, lc, prop);
+
   int numActiveBlock;
   int numthread = lc.numthread.x * lc.numthread.y * lc.numthread.z;
   switch(method) {
@@ -608,10 +635,8 @@ int getNumActiveBlock(const int method, const int sizeofType, const LaunchConfig
 
     case PackedSplit:
     {
-      // Allocate cache structure if needed
-      if (numDevices == -1) {
-        cudaCheck(cudaGetDeviceCount(&numDevices));
-      }
+      // Planning threads may get here at the same time
+      static const int numDevices = getNumDevices();
       // Build unique key for cache
       int key_warp = (numthread/prop.warpSize - 1);
       if (key_warp >= MAX_NUMWARP) {
@@ -32,6 +32,8 @@ SOFTWARE.
 #include "cuttplan.h"
 #include "cuttkernel.h"
 #include "cuttGpuModel.h"
+#include "cuttArena.h"
+#include "cuttTrace.h"
 
 void printMethod(int method) {
   switch(method) {
@@ -63,6 +65,7 @@ void printMethod(int method) {
 void reduceRanks(const int rank, const int* dim, const int* permutation,
   std::vector<int>& redDim, std::vector<int>& redPermutation) {
 
+  CUTT_TRACE_SCOPE("reduceRanks");
   // Previous permutation value,
   // start with impossible value so that we always first do push_back(permutation[0])
   int prev = -2;
@@ -136,28 +139,24 @@ private:
   int* map;
 public:
   // rankInd[0 ... n - 1] = ranks that are included
+  // Storage is taken from the planning arena of the calling thread
   TensorC(const int rank, const int n, const int* rankInd, const int* dim) : rank(rank) {
     if (rank < 1 || n < 1 || n > rank) {
       printf("TensorC::TensorC, Invalid rank or n\n");
       exit(1);
     }
-    map = new int[rank];
+    map = planArena().alloc<int>(rank);
     for (int i=0;i < rank;i++) map[i] = -1;
     for (int i=0;i < n;i++) {
       map[rankInd[i]] = i;
     }
-    c = new int[n];
+    c = planArena().alloc<int>(n);
     c[0] = 1;
     for (int i=1;i < n;i++) {
       c[i] = c[i-1]*dim[rankInd[i-1]];
     }
   }
 
-  ~TensorC() {
-    delete [] c;
-    delete [] map;
-  }
-
   int get(const int i) {
     int mapi;
     if (i < 0 || i >= rank || (mapi = map[i]) == -1) {
@@ -475,29 +474,18 @@ size_t TensorSplit::shmemAlloc(int sizeofType) const {
   return vol;
 }
 
-//
-// Returns true if the plan with TensorSplit ts already exists
-//
-bool planExists(TensorSplit& ts, std::list<cuttPlan_t>& plans) {
-  for (auto it=plans.begin();it != plans.end();it++) {
-    if (it->tensorSplit == ts) return true;
-  }
-  return false;
-}
-
 bool cuttPlan_t::createTrivialPlans(const int rank, const int* dim, const int* permutation,
-  const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, std::list<cuttPlan_t>& plans) {
+  const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, PlanCandidates& plans) {
 
+  CUTT_TRACE_SCOPE("createTrivialPlans");
   if (rank == 1) {
     TensorSplit ts;
     ts.method = Trivial;
     ts.update(1, 1, rank, dim, permutation);    
     LaunchConfig lc;
     int numActiveBlock = cuttKernelLaunchConfiguration(sizeofType, ts, deviceID, prop, lc);
-    if (numActiveBlock > 0 && !planExists(ts, plans)) {
-      cuttPlan_t plan;
-      if (!plan.setup(rank, dim, permutation, sizeofType, ts, lc, numActiveBlock)) return false;
-      plans.push_back(plan);
+    if (numActiveBlock > 0) {
+      plans.add(PlanCandidate(rank, sizeofType, ts, lc, numActiveBlock));
     }
   }
 
@@ -505,18 +493,17 @@ bool cuttPlan_t::createTrivialPlans(const int rank, const int* dim, const int* p
 }
 
 bool cuttPlan_t::createTiledPlans(const int rank, const int* dim, const int* permutation,
-  const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, std::list<cuttPlan_t>& plans) {
+  const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, PlanCandidates& plans) {
 
+  CUTT_TRACE_SCOPE("createTiledPlans");
   if (permutation[0] != 0 && rank > 1) {
     TensorSplit ts;
     ts.method = Tiled;
     ts.update(1, 1, rank, dim, permutation);    
     LaunchConfig lc;
     int numActiveBlock = cuttKernelLaunchConfiguration(sizeofType, ts, deviceID, prop, lc);
-    if (numActiveBlock > 0 && !planExists(ts, plans)) {
-      cuttPlan_t plan;
-      if (!plan.setup(rank, dim, permutation, sizeofType, ts, lc, numActiveBlock)) return false;
-      plans.push_back(plan);
+    if (numActiveBlock > 0) {
+      plans.add(PlanCandidate(rank, sizeofType, ts, lc, numActiveBlock));
     }
   }
 
@@ -524,8 +511,9 @@ bool cuttPlan_t::createTiledPlans(const int rank, const int* dim, const int* per
 }
 
 bool cuttPlan_t::createTiledCopyPlans(const int rank, const int* dim, const int* permutation,
-  const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, std::list<cuttPlan_t>& plans) {
+  const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, PlanCandidates& plans) {
 
+  CUTT_TRACE_SCOPE("createTiledCopyPlans");
   // Count number of Mm and Mk which are the same
   int numMmMkSame = 0;
   while (numMmMkSame < rank && permutation[numMmMkSame] == numMmMkSame) {
@@ -542,10 +530,8 @@ bool cuttPlan_t::createTiledCopyPlans(const int rank, const int* dim, const int*
     }
     LaunchConfig lc;
     int numActiveBlock = cuttKernelLaunchConfiguration(sizeofType, ts, deviceID, prop, lc);
-    if (numActiveBlock > 0 && !planExists(ts, plans)) {
-      cuttPlan_t plan;
-      if (!plan.setup(rank, dim, permutation, sizeofType, ts, lc, numActiveBlock)) return false;
-      plans.push_back(plan);
+    if (numActiveBlock > 0) {
+      plans.add(PlanCandidate(rank, sizeofType, ts, lc, numActiveBlock));
     }
   }
 
@@ -553,8 +539,9 @@ bool cuttPlan_t::createTiledCopyPlans(const int rank, const int* dim, const int*
 }
 
 bool cuttPlan_t::createPackedPlans(const int rank, const int* dim, const int* permutation,
-  const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, std::list<cuttPlan_t>& plans) {
+  const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, PlanCandidates& plans) {
 
+  CUTT_TRACE_SCOPE("createPackedPlans");
   LaunchConfig lc;
   for (int numMm=1;numMm < rank;numMm++) {
     for (int numMk=1;numMk < rank;numMk++) {
@@ -564,11 +551,7 @@ bool cuttPlan_t::createPackedPlans(const int rank, const int* dim, const int* pe
       int numActiveBlock = cuttKernelLaunchConfiguration(sizeofType, ts, deviceID, prop, lc);
       // Does not fit on the device, break out of inner loop
       if (numActiveBlock == 0) break;
-      if (!planExists(ts, plans)) {
-        cuttPlan_t plan;
-        if (!plan.setup(rank, dim, permutation, sizeofType, ts, lc, numActiveBlock)) return false;
-        plans.push_back(plan);
-      }
+      plans.add(PlanCandidate(rank, sizeofType, ts, lc, numActiveBlock));
     }
   }
 
@@ -576,8 +559,9 @@ bool cuttPlan_t::createPackedPlans(const int rank, const int* dim, const int* pe
 }
 
 bool cuttPlan_t::createPackedSplitPlans(const int rank, const int* dim, const int* permutation,
-  const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, std::list<cuttPlan_t>& plans) {
+  const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, PlanCandidates& plans) {
 
+  CUTT_TRACE_SCOPE("createPackedSplitPlans");
   LaunchConfig lc;
   for (int numMm=1;numMm < rank;numMm++) {
     for (int numMk=1;numMk < rank;numMk++) {
@@ -656,29 +640,23 @@ bool cuttPlan_t::createPackedSplitPlans(const int rank, const int* dim, const in
         // Make sure splitDim*numSplit fits into an integer
         const unsigned long long int dim_cutoff = ((unsigned long long int)1 << 31);
         unsigned long long int dim0 = (unsigned long long int)ts.splitDim*(unsigned long long int)(ts.numSplit + 1);
-        if (!planExists(ts, plans) && dim0 < dim_cutoff) {
-          cuttPlan_t plan;
-          if (!plan.setup(rank, dim, permutation, sizeofType, ts, lc0, numActiveBlock0)) return false;
-          plans.push_back(plan);
+        if (dim0 < dim_cutoff) {
+          plans.add(PlanCandidate(rank, sizeofType, ts, lc0, numActiveBlock0));
         }
         if (bestNumSplit1 != bestNumSplit0) {
           ts.numSplit = bestNumSplit1;
           ts.update(numMm, numMk, rank, dim, permutation);
           unsigned long long int dim1 = (unsigned long long int)ts.splitDim*(unsigned long long int)(ts.numSplit + 1);
-          if (!planExists(ts, plans) && dim1 < dim_cutoff) {
-            cuttPlan_t plan;
-            if (!plan.setup(rank, dim, permutation, sizeofType, ts, lc1, numActiveBlock1)) return false;
-            plans.push_back(plan);
+          if (dim1 < dim_cutoff) {
+            plans.add(PlanCandidate(rank, sizeofType, ts, lc1, numActiveBlock1));
           }
         }
         if (bestNumSplit2 != bestNumSplit0 && bestNumSplit2 != bestNumSplit1) {
           ts.numSplit = bestNumSplit2;
           ts.update(numMm, numMk, rank, dim, permutation);
           unsigned long long int dim2 = (unsigned long long int)ts.splitDim*(unsigned long long int)(ts.numSplit + 1);
-          if (!planExists(ts, plans) && dim2 < dim_cutoff) {
-            cuttPlan_t plan;
-            if (!plan.setup(rank, dim, permutation, sizeofType, ts, lc2, numActiveBlock2)) return false;
-            plans.push_back(plan);
+          if (dim2 < dim_cutoff) {
+            plans.add(PlanCandidate(rank, sizeofType, ts, lc2, numActiveBlock2));
           }
         }
       }
@@ -693,9 +671,11 @@ bool cuttPlan_t::createPackedSplitPlans(const int rank, const int* dim, const in
 //
 bool cuttPlan_t::createPlans(const int rank, const int* dim, const int* permutation,
   const int rankRed, const int* dimRed, const int* permutationRed,
-  const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, std::list<cuttPlan_t>& plans) {
+  const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, PlanCandidates& plans) {
 
-  size_t size0 = plans.size();
+  CUTT_TRACE_SCOPE("createPlans");
+  plans.setTensor(rank, dim, permutation, rankRed, dimRed, permutationRed);
+  int size0 = plans.size();
   /* if (!createTiledCopyPlans(rank, dim, permutation, sizeofType, deviceID, prop, plans)) return false;*/
   if (!createTrivialPlans(rankRed, dimRed, permutationRed, sizeofType, deviceID, prop, plans)) return false;
   // If Trivial plan was created, that's the only one we need
@@ -710,7 +690,48 @@ bool cuttPlan_t::createPlans(const int rank, const int* dim, const int* permutat
   return true;
 }
 
-bool operator>(const cuttPlan_t& lhs, const cuttPlan_t& rhs) {
+//
+// Create plans for new dimensions, reusing the rank reduction of structure
+//
+bool cuttPlan_t::updatePlans(const PlanStructure& structure, const int* dim,
+  const size_t sizeofType, const int deviceID, const cudaDeviceProp& prop, PlanCandidates& plans) {
+
+  const int rank = structure.permutation.size();
+  const int* permutation = structure.permutation.data();
+  std::vector<int> redDim;
+  structure.reduceDims(dim, redDim);
+  const int rankRed = redDim.size();
+  const int* permutationRed = structure.redPermutation.data();
+
+  PlanCandidates all;
+  if (!createPlans(rank, dim, permutation, rankRed, redDim.data(), permutationRed,
+    sizeofType, deviceID, prop, all)) return false;
+
+  // Splits must be the same as in structure, otherwise every candidate is needed
+  std::vector<bool> found(structure.splits.size(), false);
+  int numFound = 0;
+  bool same = true;
+  for (int i=0;i < all.size() && same;i++) {
+    int j = structure.findSplit(all[i]);
+    same = (j != -1);
+    if (same && !found[j]) {
+      found[j] = true;
+      numFound++;
+    }
+  }
+  if (!same || numFound != structure.splits.size()) {
+    plans = std::move(all);
+    return false;
+  }
+
+  plans.setTensor(rank, dim, permutation, rankRed, redDim.data(), permutationRed);
+  for (int i=0;i < all.size();i++) {
+    if (structure.splits[structure.findSplit(all[i])].competitive) plans.add(all[i]);
+  }
+  return true;
+}
+
+bool operator>(const PlanCandidate& lhs, const PlanCandidate& rhs) {
 
   const TensorSplit& lts = lhs.tensorSplit;
   const TensorSplit& rts = rhs.tensorSplit;
@@ -759,36 +780,48 @@ bool operator>(const cuttPlan_t& lhs, const cuttPlan_t& rhs) {
   // }
 }
 
-bool operator<(const cuttPlan_t& lhs, const cuttPlan_t& rhs) {
+bool operator<(const PlanCandidate& lhs, const PlanCandidate& rhs) {
   return !(lhs > rhs);
 }
 
 //
 // Returns best plan according to heuristic criteria
-// Returns plans.end() on invalid input or when nothing can be chosen
+// Returns -1 on invalid input or when nothing can be chosen
 //
-std::list<cuttPlan_t>::iterator choosePlanHeuristic(std::list<cuttPlan_t>& plans) {
+int choosePlanHeuristic(const PlanCandidates& plans) {
 
   // Choose the "largest" plan
-  auto bestIt = plans.end();
-  for (auto it=plans.begin();it != plans.end();it++) {
-    if (bestIt == plans.end() || *bestIt < *it) {
-      bestIt = it;
+  int best = -1;
+  for (int i=0;i < plans.size();i++) {
+    if (best == -1 || plans[best] < plans[i]) {
+      best = i;
     }
   }
 
-  return bestIt;
+  return best;
 }
 
-void printMatlab(cudaDeviceProp& prop, std::list<cuttPlan_t>& plans, std::vector<double>& times) {
+int choosePlanHeuristic(const PlanCandidates& plans, const int* idx, const int n) {
+
+  int best = -1;
+  for (int i=0;i < n;i++) {
+    if (best == -1 || plans[best] < plans[idx[i]]) {
+      best = idx[i];
+    }
+  }
+
+  return best;
+}
+
+void printMatlab(cudaDeviceProp& prop, const PlanCandidates& plans, std::vector<double>& times) {
   static int count = 0;
   count++;
   int i = 0;
   // Conversion factor from wallclok time to total number of cycles = (GPU clock in Hz) x #SM
   double freq_SM = (double)(prop.clockRate*1000)*(double)prop.multiProcessorCount;
   for (auto it=plans.begin();it != plans.end();it++,i++) {
-    TensorSplit& ts = it->tensorSplit;
-    LaunchConfig& lc = it->launchConfig;
+    const TensorSplit& ts = it->tensorSplit;
+    const LaunchConfig& lc = it->launchConfig;
     if (ts.method == Packed || ts.method == PackedSplit ||
       ts.method == Tiled || ts.method == TiledCopy)
     {
@@ -802,6 +835,199 @@ void printMatlab(cudaDeviceProp& prop, std::list<cuttPlan_t>& plans, std::vector
   }
 }
 
+//
+// Hash of the TensorSplit fields that operator==(TensorSplit, TensorSplit) compares
+//
+static size_t hashTensorSplit(const TensorSplit& ts) {
+  int val[5] = {ts.method, 0, 0, 0, 0};
+  if (ts.method == Tiled) {
+    val[1] = ts.volMm;
+    val[2] = ts.volMk;
+    val[3] = ts.volMbar;
+  } else if (ts.method == TiledCopy) {
+    val[1] = ts.volMm;
+    val[2] = ts.volMkBar;
+    val[3] = ts.volMbar;
+  } else if (ts.method == Packed || ts.method == PackedSplit) {
+    val[1] = ts.volMmkInCont;
+    val[2] = ts.volMmkOutCont;
+    val[3] = ts.volMmk;
+    val[4] = ts.volMbar;
+  }
+  // FNV-1a
+  size_t h = (size_t)14695981039346656037ULL;
+  for (int i=0;i < 5;i++) {
+    h ^= (size_t)(unsigned int)val[i];
+    h *= (size_t)1099511628211ULL;
+  }
+  return h;
+}
+
+void PlanCandidates::setTensor(const int rank, const int* dim_in, const int* permutation_in,
+  const int redRank, const int* redDim_in, const int* redPermutation_in) {
+  dim.assign(dim_in, dim_in + rank);
+  permutation.assign(permutation_in, permutation_in + rank);
+  redDim.assign(redDim_in, redDim_in + redRank);
+  redPermutation.assign(redPermutation_in, redPermutation_in + redRank);
+  candidates.clear();
+  index.clear();
+}
+
+bool PlanCandidates::add(const PlanCandidate& cand) {
+  size_t h = hashTensorSplit(cand.tensorSplit);
+  auto range = index.equal_range(h);
+  for (auto it=range.first;it != range.second;it++) {
+    if (candidates[it->second].tensorSplit == cand.tensorSplit) return false;
+  }
+  index.insert( {h, (int)candidates.size()} );
+  candidates.push_back(cand);
+  return true;
+}
+
+bool PlanCandidates::setup(const int i, cuttPlan_t& plan) const {
+  const PlanCandidate& cand = candidates[i];
+  // Reduced tensor has the same rank only if nothing was reduced
+  bool isRed = (cand.rank != (int)dim.size());
+  if (isRed && cand.rank != (int)redDim.size()) return false;
+  const int* d = isRed ? redDim.data() : dim.data();
+  const int* p = isRed ? redPermutation.data() : permutation.data();
+  if (!plan.setup(cand.rank, d, p, cand.sizeofType, cand.tensorSplit, cand.launchConfig, cand.numActiveBlock)) return false;
+  plan.tensorDim = dim;
+  static_cast<PlanCounters&>(*plan.analysis) = cand;
+  return true;
+}
+
+bool PlanCandidates::countCycles(const int i, cuttPlan_t& plan, cudaDeviceProp& prop, const int numPosMbarSample) {
+  if (!setup(i, plan)) return false;
+  if (!plan.countCycles(prop, numPosMbarSample)) return false;
+  static_cast<PlanCounters&>(candidates[i]) = *plan.analysis;
+  return true;
+}
+
+bool PlanCandidates::countCycles(cudaDeviceProp& prop, const int numPosMbarSample) {
+  cuttPlan_t plan;
+  for (int i=0;i < size();i++) {
+    if (!countCycles(i, plan, prop, numPosMbarSample)) return false;
+  }
+  return true;
+}
+
+PlanStructure::PlanStructure(const PlanCandidates& plans) :
+  permutation(plans.permutation), redPermutation(plans.redPermutation) {
+
+  setRedRankOf();
+  if (permutation.size() > PLAN_STRUCTURE_MAX_RANK) return;
+
+  double minCycles = 0.0;
+  for (int i=0;i < plans.size();i++) {
+    if (i == 0 || plans[i].cycles < minCycles) minCycles = plans[i].cycles;
+  }
+
+  for (int i=0;i < plans.size();i++) {
+    const PlanCandidate& cand = plans[i];
+    bool competitive = (minCycles <= 0.0 || cand.cycles <= PLAN_STRUCTURE_CYCLES_RATIO*minCycles);
+    int j = findSplit(cand);
+    if (j == -1) {
+      splits.push_back(getSplit(cand));
+      splits.back().competitive = competitive;
+    } else {
+      splits[j].competitive = splits[j].competitive || competitive;
+    }
+  }
+}
+
+void PlanStructure::setRedRankOf() {
+  const int rank = permutation.size();
+  // Rank i is merged with rank i-1 if it follows rank i-1 in the permuted order
+  std::vector<int> pos(rank);
+  for (int i=0;i < rank;i++) pos[permutation[i]] = i;
+  redRankOf.resize(rank);
+  for (int i=0;i < rank;i++) {
+    redRankOf[i] = (i == 0) ? 0 : redRankOf[i-1] + (pos[i] != pos[i-1] + 1);
+  }
+}
+
+std::shared_ptr<PlanStructure> PlanStructure::inverse() const {
+  std::shared_ptr<PlanStructure> inv(new PlanStructure());
+  // Ranks that are consecutive in the permutation are consecutive in its inverse,
+  // so the reduced tensor of the inverse is the inverse of the reduced tensor
+  inv->permutation.resize(permutation.size());
+  for (int i=0;i < permutation.size();i++) inv->permutation[permutation[i]] = i;
+  inv->redPermutation.resize(redPermutation.size());
+  for (int i=0;i < redPermutation.size();i++) inv->redPermutation[redPermutation[i]] = i;
+  inv->setRedRankOf();
+  // Rank i of the input is rank inv->permutation[i] of the output, which is the input of the inverse.
+  // Mmk stays the same set of ranks, the ranks in Mm and Mk trade places
+  for (int j=0;j < splits.size();j++) {
+    Split split = splits[j];
+    const std::vector<int>& p = split.isRed ? inv->redPermutation : inv->permutation;
+    split.mmk = 0;
+    if (split.method == TiledCopy) {
+      // Always the leading rank and the next rank of the output
+      split.mmk = 1ULL | ((p.size() > 1) ? (1ULL << p[1]) : 0ULL);
+    } else {
+      for (int i=0;i < p.size();i++) {
+        if (splits[j].mmk & (1ULL << i)) split.mmk |= (1ULL << p[i]);
+      }
+    }
+    inv->splits.push_back(split);
+  }
+  return inv;
+}
+
+void PlanStructure::reduceDims(const int* dim, std::vector<int>& redDim) const {
+  redDim.assign(redPermutation.size(), 1);
+  for (int i=0;i < redRankOf.size();i++) {
+    redDim[redRankOf[i]] *= dim[i];
+  }
+}
+
+PlanStructure::Split PlanStructure::getSplit(const PlanCandidate& cand) const {
+  Split split;
+  split.method = cand.tensorSplit.method;
+  split.isRed = (cand.rank != (int)permutation.size());
+  const int* p = split.isRed ? redPermutation.data() : permutation.data();
+  // First sizeMm ranks are in Mm, first sizeMk ranks in permuted order are in Mk
+  split.mmk = 0;
+  for (int i=0;i < cand.tensorSplit.sizeMm;i++) split.mmk |= (1ULL << i);
+  for (int i=0;i < cand.tensorSplit.sizeMk;i++) split.mmk |= (1ULL << p[i]);
+  split.competitive = false;
+  return split;
+}
+
+int PlanStructure::findSplit(const PlanCandidate& cand) const {
+  if (permutation.size() > PLAN_STRUCTURE_MAX_RANK) return -1;
+  Split split = getSplit(cand);
+  for (int j=0;j < splits.size();j++) {
+    if (splits[j].method == split.method && splits[j].isRed == split.isRed && splits[j].mmk == split.mmk) return j;
+  }
+  return -1;
+}
+
+size_t PlanStructure::memoryUsage() const {
+  return sizeof(PlanStructure) + (permutation.capacity() + redRankOf.capacity() +
+    redPermutation.capacity())*sizeof(int) + splits.capacity()*sizeof(Split);
+}
+
+void PlanCandidates::priorityOrder(std::vector<int>& order) const {
+  // Rank of each method in the order
+  int priority[NumTransposeMethods];
+  for (int i=0;i < NumTransposeMethods;i++) priority[i] = NumTransposeMethods;
+  priority[Trivial] = 0;
+  priority[Tiled] = 1;
+  priority[TiledCopy] = 2;
+  priority[Packed] = 3;
+  priority[PackedSplit] = 4;
+  order.resize(candidates.size());
+  for (int i=0;i < order.size();i++) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](const int a, const int b) {
+    const TensorSplit& ta = candidates[a].tensorSplit;
+    const TensorSplit& tb = candidates[b].tensorSplit;
+    if (ta.method != tb.method) return (priority[ta.method] < priority[tb.method]);
+    return (ta.method == PackedSplit && ta.numSplit < tb.numSplit);
+  });
+}
+
 void LaunchConfig::print() {
   printf("numthread %d %d %d numblock %d %d %d shmemsize %d numRegStorage %d\n",
     numthread.x, numthread.y, numthread.z,
@@ -818,7 +1044,11 @@ void cuttPlan_t::print() {
   printf("\n");
   tensorSplit.print();
   launchConfig.print();
-  printf("numActiveBlock %d cycles %e\n", numActiveBlock, cycles);
+  printf("numActiveBlock %d\n", numActiveBlock);
+  if (analysis != NULL) {
+    printf("cycles %e numPosMbar %d tranMean %e tranVar %e\n", analysis->cycles,
+      analysis->numPosMbar, analysis->tranMean, analysis->tranVar);
+  }
 }
 
 
@@ -838,8 +1068,21 @@ bool cuttPlan_t::setup(const int rank_in, const int* dim, const int* permutation
   launchConfig = launchConfig_in;
   if (numActiveBlock == 0) return false;
 
-  std::vector<bool> isMm(rank, false);
-  std::vector<bool> isMk(rank, false);
+  // Plan object may be reused for several candidates, keep capacity of the host buffers
+  if (analysis == NULL) analysis.reset(new PlanAnalysis());
+  PlanAnalysis& an = *analysis;
+  an.hostMbar.clear();
+  an.hostMmk.clear();
+  an.hostMsh.clear();
+
+  // Temporaries live in the planning arena
+  PlanArenaScope arenaScope;
+  PlanArena& arena = planArena();
+
+  bool* isMm = arena.alloc<bool>(rank);
+  bool* isMk = arena.alloc<bool>(rank);
+  std::fill(isMm, isMm + rank, false);
+  std::fill(isMk, isMk + rank, false);
   for (int i=0;i < tensorSplit.sizeMm;i++) {
     isMm[i] = true;
   }
@@ -851,12 +1094,11 @@ bool cuttPlan_t::setup(const int rank_in, const int* dim, const int* permutation
   // numActiveBlock = cuttKernelLaunchConfiguration(sizeofType, tensorSplit, prop, launchConfig);
 
   // Build cI
-  int* I = new int[rank];
+  int* I = arena.alloc<int>(rank);
   for (int i=0;i < rank;i++) {
     I[i] = i;
   }
   TensorC cI(rank, rank, I, dim);
-  delete [] I;
 
   // Build cO
   TensorC cO(rank, rank, permutation, dim);
@@ -875,7 +1117,7 @@ bool cuttPlan_t::setup(const int rank_in, const int* dim, const int* permutation
   }
 
   // Build MmI
-  std::vector<int> MmI(tensorSplit.sizeMm);
+  int* MmI = arena.alloc<int>(tensorSplit.sizeMm);
   {
     int iMm = 0;
     int iMk = 0;
@@ -888,7 +1130,7 @@ bool cuttPlan_t::setup(const int rank_in, const int* dim, const int* permutation
 
   if (tensorSplit.sizeMbar > 0) {
     // Build MbarI = {s_1, ...., s_h}, indices in input order
-    int* MbarI = new int[tensorSplit.sizeMbar];
+    int* MbarI = arena.alloc<int>(tensorSplit.sizeMbar);
     int j = 0;
     for (int i=0;i < rank;i++) {
       if (!(isMm[i] || isMk[i])) {
@@ -899,7 +1141,7 @@ bool cuttPlan_t::setup(const int rank_in, const int* dim, const int* permutation
     TensorC cMbarI(rank, tensorSplit.sizeMbar, MbarI, dim);
 
     // Build MbarO = {s_l1, ...., s_lh}, indices in output (permuted) order
-    int* MbarO = new int[tensorSplit.sizeMbar];
+    int* MbarO = arena.alloc<int>(tensorSplit.sizeMbar);
     j = 0;
     for (int i=0;i < rank;i++) {
       int pi = permutation[i];
@@ -909,42 +1151,41 @@ bool cuttPlan_t::setup(const int rank_in, const int* dim, const int* permutation
       }
     }
 
-    hostMbar.resize(tensorSplit.sizeMbar);
+    an.hostMbar.resize(tensorSplit.sizeMbar);
     for (int i=0;i < tensorSplit.sizeMbar;i++) {
       int si = MbarI[i];
-      hostMbar[i].c_in  = cMbarI.get(si);
-      hostMbar[i].d_in  = dim[si];
-      hostMbar[i].ct_in = cI.get(si);
+      an.hostMbar[i].c_in  = cMbarI.get(si);
+      an.hostMbar[i].d_in  = dim[si];
+      an.hostMbar[i].ct_in = cI.get(si);
       int sli = MbarO[i];
-      hostMbar[i].c_out  = cMbarI.get(sli);
-      hostMbar[i].d_out  = dim[sli];
-      hostMbar[i].ct_out = cO.get(sli);
+      an.hostMbar[i].c_out  = cMbarI.get(sli);
+      an.hostMbar[i].d_out  = dim[sli];
+      an.hostMbar[i].ct_out = cO.get(sli);
     }
-
-    delete [] MbarI;
-    delete [] MbarO;
   }
 
-  gld_req = 1;
-  gst_req = 1;
-  gld_tran = 1;
-  gst_tran = 1;
-  cl_full_l2 = 0;
-  cl_part_l2 = 0;
-  cl_full_l1 = 0;
-  cl_part_l1 = 0;
-  sld_tran = 1;
-  sst_tran = 1;
-  sld_req = 1;
-  sst_req = 1;
-  num_iter = 0;
-  mlp = 0.0f;
-  cycles = 0.0;
+  an.gld_req = 1;
+  an.gst_req = 1;
+  an.gld_tran = 1;
+  an.gst_tran = 1;
+  an.cl_full_l2 = 0;
+  an.cl_part_l2 = 0;
+  an.cl_full_l1 = 0;
+  an.cl_part_l1 = 0;
+  an.sld_tran = 1;
+  an.sst_tran = 1;
+  an.sld_req = 1;
+  an.sst_req = 1;
+  an.num_iter = 0;
+  an.mlp = 0.0f;
+  an.cycles = 0.0;
 
   if (tensorSplit.method == PackedSplit) {
     if (tensorSplit.splitRank < 0) return false;
-    std::vector<int> dimSplit(dim, dim + rank);
-    std::vector<int> dimSplitPlusOne(dim, dim + rank);
+    int* dimSplit = arena.alloc<int>(rank);
+    int* dimSplitPlusOne = arena.alloc<int>(rank);
+    std::copy(dim, dim + rank, dimSplit);
+    std::copy(dim, dim + rank, dimSplitPlusOne);
     cuDimMm = 1;
     cuDimMk = 1;
     dimSplit[tensorSplit.splitRank]        = tensorSplit.splitDim/tensorSplit.numSplit;
@@ -952,7 +1193,7 @@ bool cuttPlan_t::setup(const int rank_in, const int* dim, const int* permutation
     cuDimMm = cI.get(tensorSplit.splitRank);
     cuDimMk = cO.get(tensorSplit.splitRank);
     // Build MmkI = {q_1, ..., q_a}
-    std::vector<int> MmkI(tensorSplit.sizeMmk);
+    int* MmkI = arena.alloc<int>(tensorSplit.sizeMmk);
     int j = 0;
     for (int i=0;i < rank;i++) {
       if (isMm[i] || isMk[i]) {
@@ -960,10 +1201,10 @@ bool cuttPlan_t::setup(const int rank_in, const int* dim, const int* permutation
         j++;
       }
     }
-    TensorC cMmkISplit(rank, tensorSplit.sizeMmk, MmkI.data(), dimSplit.data());
-    TensorC cMmkISplitPlusOne(rank, tensorSplit.sizeMmk, MmkI.data(), dimSplitPlusOne.data());
+    TensorC cMmkISplit(rank, tensorSplit.sizeMmk, MmkI, dimSplit);
+    TensorC cMmkISplitPlusOne(rank, tensorSplit.sizeMmk, MmkI, dimSplitPlusOne);
     // Build MmkO = {q_t1, ..., q_ta}
-    std::vector<int> MmkO(tensorSplit.sizeMmk);
+    int* MmkO = arena.alloc<int>(tensorSplit.sizeMmk);
     j = 0;
     for (int i=0;i < rank;i++) {
       int pi = permutation[i];
@@ -972,45 +1213,45 @@ bool cuttPlan_t::setup(const int rank_in, const int* dim, const int* permutation
         j++;
       }
     }
-    TensorC cMmkOSplit(rank, tensorSplit.sizeMmk, MmkO.data(), dimSplit.data());
-    TensorC cMmkOSplitPlusOne(rank, tensorSplit.sizeMmk, MmkO.data(), dimSplitPlusOne.data());
+    TensorC cMmkOSplit(rank, tensorSplit.sizeMmk, MmkO, dimSplit);
+    TensorC cMmkOSplitPlusOne(rank, tensorSplit.sizeMmk, MmkO, dimSplitPlusOne);
 
-    hostMmk.resize(tensorSplit.sizeMmk*2);
+    an.hostMmk.resize(tensorSplit.sizeMmk*2);
     for (int i=0;i < tensorSplit.sizeMmk;i++) {
       // Minor reading position
       int qi = MmkI[i];
-      hostMmk[i].c_in                        = cMmkISplit.get(qi);
-      hostMmk[i].d_in                        = dimSplit[qi];
-      hostMmk[i].ct_in                       = cI.get(qi);
-      hostMmk[i + tensorSplit.sizeMmk].c_in  = cMmkISplitPlusOne.get(qi);
-      hostMmk[i + tensorSplit.sizeMmk].d_in  = dimSplitPlusOne[qi];
-      hostMmk[i + tensorSplit.sizeMmk].ct_in = cI.get(qi);
+      an.hostMmk[i].c_in                        = cMmkISplit.get(qi);
+      an.hostMmk[i].d_in                        = dimSplit[qi];
+      an.hostMmk[i].ct_in                       = cI.get(qi);
+      an.hostMmk[i + tensorSplit.sizeMmk].c_in  = cMmkISplitPlusOne.get(qi);
+      an.hostMmk[i + tensorSplit.sizeMmk].d_in  = dimSplitPlusOne[qi];
+      an.hostMmk[i + tensorSplit.sizeMmk].ct_in = cI.get(qi);
       // Minor writing position
       int qti = MmkO[i];
-      hostMmk[i].c_out                        = cMmkOSplit.get(qti);
-      hostMmk[i].d_out                        = dimSplit[qti];
-      hostMmk[i].ct_out                       = cO.get(qti);
-      hostMmk[i + tensorSplit.sizeMmk].c_out  = cMmkOSplitPlusOne.get(qti);
-      hostMmk[i + tensorSplit.sizeMmk].d_out  = dimSplitPlusOne[qti];
-      hostMmk[i + tensorSplit.sizeMmk].ct_out = cO.get(qti);
+      an.hostMmk[i].c_out                        = cMmkOSplit.get(qti);
+      an.hostMmk[i].d_out                        = dimSplit[qti];
+      an.hostMmk[i].ct_out                       = cO.get(qti);
+      an.hostMmk[i + tensorSplit.sizeMmk].c_out  = cMmkOSplitPlusOne.get(qti);
+      an.hostMmk[i + tensorSplit.sizeMmk].d_out  = dimSplitPlusOne[qti];
+      an.hostMmk[i + tensorSplit.sizeMmk].ct_out = cO.get(qti);
     }
 
-    hostMsh.resize(tensorSplit.sizeMmk*2);
+    an.hostMsh.resize(tensorSplit.sizeMmk*2);
     for (int i=0;i < tensorSplit.sizeMmk;i++) {
       // Shared memory reading position
       int qti = MmkO[i];
-      hostMsh[i].c                        = cMmkOSplit.get(qti);
-      hostMsh[i].d                        = dimSplit[qti];
-      hostMsh[i].ct                       = cMmkISplit.get(qti);
-      hostMsh[i + tensorSplit.sizeMmk].c  = cMmkOSplitPlusOne.get(qti);
-      hostMsh[i + tensorSplit.sizeMmk].d  = dimSplitPlusOne[qti];
-      hostMsh[i + tensorSplit.sizeMmk].ct = cMmkISplitPlusOne.get(qti);
+      an.hostMsh[i].c                        = cMmkOSplit.get(qti);
+      an.hostMsh[i].d                        = dimSplit[qti];
+      an.hostMsh[i].ct                       = cMmkISplit.get(qti);
+      an.hostMsh[i + tensorSplit.sizeMmk].c  = cMmkOSplitPlusOne.get(qti);
+      an.hostMsh[i + tensorSplit.sizeMmk].d  = dimSplitPlusOne[qti];
+      an.hostMsh[i + tensorSplit.sizeMmk].ct = cMmkISplitPlusOne.get(qti);
     }
   }
 
   if (tensorSplit.method == Packed) {
     // Build MmkI = {q_1, ..., q_a}
-    std::vector<int> MmkI(tensorSplit.sizeMmk);
+    int* MmkI = arena.alloc<int>(tensorSplit.sizeMmk);
     int j = 0;
     for (int i=0;i < rank;i++) {
       if (isMm[i] || isMk[i]) {
@@ -1018,9 +1259,9 @@ bool cuttPlan_t::setup(const int rank_in, const int* dim, const int* permutation
         j++;
       }
     }
-    TensorC cMmkI(rank, tensorSplit.sizeMmk, MmkI.data(), dim);
+    TensorC cMmkI(rank, tensorSplit.sizeMmk, MmkI, dim);
     // Build MmkO = {q_t1, ..., q_ta}
-    std::vector<int> MmkO(tensorSplit.sizeMmk);
+    int* MmkO = arena.alloc<int>(tensorSplit.sizeMmk);
     j = 0;
     for (int i=0;i < rank;i++) {
       int pi = permutation[i];
@@ -1029,29 +1270,29 @@ bool cuttPlan_t::setup(const int rank_in, const int* dim, const int* permutation
         j++;
       }
     }
-    TensorC cMmkO(rank, tensorSplit.sizeMmk, MmkO.data(), dim);
+    TensorC cMmkO(rank, tensorSplit.sizeMmk, MmkO, dim);
 
-    hostMmk.resize(tensorSplit.sizeMmk);
+    an.hostMmk.resize(tensorSplit.sizeMmk);
     for (int i=0;i < tensorSplit.sizeMmk;i++) {
       // Minor reading position
       int qi = MmkI[i];
-      hostMmk[i].c_in  = cMmkI.get(qi);
-      hostMmk[i].d_in  = dim[qi];
-      hostMmk[i].ct_in = cI.get(qi);
+      an.hostMmk[i].c_in  = cMmkI.get(qi);
+      an.hostMmk[i].d_in  = dim[qi];
+      an.hostMmk[i].ct_in = cI.get(qi);
       // Minor writing position
       int qti = MmkO[i];
-      hostMmk[i].c_out  = cMmkO.get(qti);
-      hostMmk[i].d_out  = dim[qti];
-      hostMmk[i].ct_out = cO.get(qti);
+      an.hostMmk[i].c_out  = cMmkO.get(qti);
+      an.hostMmk[i].d_out  = dim[qti];
+      an.hostMmk[i].ct_out = cO.get(qti);
     }
 
-    hostMsh.resize(tensorSplit.sizeMmk);
+    an.hostMsh.resize(tensorSplit.sizeMmk);
     for (int i=0;i < tensorSplit.sizeMmk;i++) {
       // Shared memory reading position
       int qti = MmkO[i];
-      hostMsh[i].c  = cMmkO.get(qti);
-      hostMsh[i].d  = dim[qti];
-      hostMsh[i].ct = cMmkI.get(qti);
+      an.hostMsh[i].c  = cMmkO.get(qti);
+      an.hostMsh[i].d  = dim[qti];
+      an.hostMsh[i].ct = cMmkI.get(qti);
     }
   }
 
@@ -1065,51 +1306,85 @@ bool cuttPlan_t::setup(const int rank_in, const int* dim, const int* permutation
 //
 bool cuttPlan_t::countCycles(cudaDeviceProp& prop, const int numPosMbarSample) {
 
+  CUTT_TRACE_SCOPE("countCycles");
+  if (analysis == NULL) return false;
+  PlanAnalysis& an = *analysis;
+
   // Number of elements that are loaded per memory transaction:
   // 128 bytes per transaction
   const int accWidth = 128/sizeofType;
   // L2 cache line width is 32 bytes
   const int cacheWidth = 32/sizeofType;
 
+  // Mmk position tables shared with the other candidates (Packed and PackedSplit)
+  PosTableCache& posCache = posTableCache();
+  posCache.trim(POS_TABLE_CACHE_MAX_BYTES);
+
+  // Mbar positions for which transactions are counted (Packed and PackedSplit)
+  MbarSampler sampler(tensorSplit.volMbar*((tensorSplit.method == PackedSplit) ? tensorSplit.numSplit : 1),
+    numPosMbarSample);
+
   if (tensorSplit.method == Tiled) {
     // Global memory
-#ifdef ENABLE_NVTOOLS
-    gpuRangeStart("countTiledGlTransactions");
-#endif
-    countTiledGlTransactions(false, numPosMbarSample, tensorSplit.volMm, tensorSplit.volMk, tensorSplit.volMbar,
-      cuDimMk, cuDimMm, accWidth, cacheWidth, hostMbar, tensorSplit.sizeMbar,
-      num_iter, mlp, gld_tran, gst_tran, gld_req, gst_req, cl_full_l2, cl_part_l2);
-#ifdef ENABLE_NVTOOLS
-    gpuRangeStop();
+    CUTT_TRACE_BEGIN("countTiledGlTransactions");
+    countTiledGlTransactions(false, tensorSplit.volMm, tensorSplit.volMk, tensorSplit.volMbar,
+      cuDimMk, cuDimMm, accWidth, cacheWidth, an.hostMbar, tensorSplit.sizeMbar,
+      an.num_iter, an.mlp, an.gld_tran, an.gst_tran, an.gld_req, an.gst_req, an.cl_full_l2, an.cl_part_l2);
+#ifdef COUNTCYCLE_CHECK
+    {
+      int gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref, cl_full_l2_ref, cl_part_l2_ref;
+      countTiledGlTransactionsRef(false, tensorSplit.volMm, tensorSplit.volMk, tensorSplit.volMbar,
+        cuDimMk, cuDimMm, accWidth, cacheWidth, an.hostMbar, tensorSplit.sizeMbar,
+        gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref, cl_full_l2_ref, cl_part_l2_ref);
+      if (an.gld_tran != gld_tran_ref || an.gst_tran != gst_tran_ref || an.gld_req != gld_req_ref ||
+        an.gst_req != gst_req_ref || an.cl_full_l2 != cl_full_l2_ref || an.cl_part_l2 != cl_part_l2_ref) {
+        printf("countTiledGlTransactions fails\n");
+        printf("    %d %d %d %d %d %d\n", an.gld_tran, an.gst_tran, an.gld_req, an.gst_req, an.cl_full_l2, an.cl_part_l2);
+        printf("ref %d %d %d %d %d %d\n", gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref,
+          cl_full_l2_ref, cl_part_l2_ref);
+        return false;
+      }
+    }
 #endif
+    CUTT_TRACE_END();
     // Shared memory
-    sld_tran = 1;
-    sst_tran = 1;
-    sld_req = 1;
-    sst_req = 1;
+    an.sld_tran = 1;
+    an.sst_tran = 1;
+    an.sld_req = 1;
+    an.sst_req = 1;
   } else if (tensorSplit.method == TiledCopy) {
     // Global memory
-#ifdef ENABLE_NVTOOLS
-    gpuRangeStart("countTiledGlTransactions (copy)");
-#endif
-    countTiledGlTransactions(true, numPosMbarSample, tensorSplit.volMm, tensorSplit.volMkBar, tensorSplit.volMbar,
-      cuDimMk, cuDimMm, accWidth, cacheWidth, hostMbar, tensorSplit.sizeMbar,
-      num_iter, mlp, gld_tran, gst_tran, gld_req, gst_req, cl_full_l2, cl_part_l2);
-#ifdef ENABLE_NVTOOLS
-    gpuRangeStop();
+    CUTT_TRACE_BEGIN("countTiledGlTransactions (copy)");
+    countTiledGlTransactions(true, tensorSplit.volMm, tensorSplit.volMkBar, tensorSplit.volMbar,
+      cuDimMk, cuDimMm, accWidth, cacheWidth, an.hostMbar, tensorSplit.sizeMbar,
+      an.num_iter, an.mlp, an.gld_tran, an.gst_tran, an.gld_req, an.gst_req, an.cl_full_l2, an.cl_part_l2);
+#ifdef COUNTCYCLE_CHECK
+    {
+      int gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref, cl_full_l2_ref, cl_part_l2_ref;
+      countTiledGlTransactionsRef(true, tensorSplit.volMm, tensorSplit.volMkBar, tensorSplit.volMbar,
+        cuDimMk, cuDimMm, accWidth, cacheWidth, an.hostMbar, tensorSplit.sizeMbar,
+        gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref, cl_full_l2_ref, cl_part_l2_ref);
+      if (an.gld_tran != gld_tran_ref || an.gst_tran != gst_tran_ref || an.gld_req != gld_req_ref ||
+        an.gst_req != gst_req_ref || an.cl_full_l2 != cl_full_l2_ref || an.cl_part_l2 != cl_part_l2_ref) {
+        printf("countTiledGlTransactions (copy) fails\n");
+        printf("    %d %d %d %d %d %d\n", an.gld_tran, an.gst_tran, an.gld_req, an.gst_req, an.cl_full_l2, an.cl_part_l2);
+        printf("ref %d %d %d %d %d %d\n", gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref,
+          cl_full_l2_ref, cl_part_l2_ref);
+        return false;
+      }
+    }
 #endif
+    CUTT_TRACE_END();
     // Shared memory
-    sld_tran = 1;
-    sst_tran = 1;
-    sld_req = 1;
-    sst_req = 1;
+    an.sld_tran = 1;
+    an.sst_tran = 1;
+    an.sld_req = 1;
+    an.sst_req = 1;
   } else if (tensorSplit.method == PackedSplit) {
     if (tensorSplit.splitRank < 0) return false;
-#ifdef ENABLE_NVTOOLS
-    gpuRangeStart("PackedSplit: init");
-#endif
-    num_iter = tensorSplit.volMbar*tensorSplit.numSplit;
-    mlp = (float)launchConfig.numRegStorage;
+    CUTT_TRACE_BEGIN("PackedSplit: init");
+    an.num_iter = tensorSplit.volMbar*tensorSplit.numSplit;
+    an.mlp = (float)launchConfig.numRegStorage;
     int dimSplit = tensorSplit.splitDim/tensorSplit.numSplit;
     // Number of splits that are "round up" i.e. "PlusOne"
     int num1 = tensorSplit.splitDim % tensorSplit.numSplit;
@@ -1117,252 +1392,161 @@ bool cuttPlan_t::countCycles(cudaDeviceProp& prop, const int numPosMbarSample) {
     // Number of splits that are "round down"
     int num0 = tensorSplit.numSplit - num1;
     int volMmk0 = dimSplit*tensorSplit.volMmkUnsplit;
-    mlp = (float)(volMmk0*num0 + volMmk1*num1) / (float)(launchConfig.numthread.x*(num0 + num1));
+    an.mlp = (float)(volMmk0*num0 + volMmk1*num1) / (float)(launchConfig.numthread.x*(num0 + num1));
     // Global memory
-    gld_tran = 0;
-    gst_tran = 0;
-    gld_req = 0;
-    gst_req = 0;
-    cl_full_l2 = 0;
-    cl_part_l2 = 0;
-    cl_full_l1 = 0;
-    cl_part_l1 = 0;
-    // Random number generator
-    std::default_random_engine generator;
-    std::uniform_int_distribution<int> distribution(0, tensorSplit.volMbar*tensorSplit.numSplit - 1);
+    an.gld_tran = 0;
+    an.gst_tran = 0;
+    an.gld_req = 0;
+    an.gst_req = 0;
+    an.cl_full_l2 = 0;
+    an.cl_part_l2 = 0;
+    an.cl_full_l1 = 0;
+    an.cl_part_l1 = 0;
     // Pre-compute posMmkIn and posMmkOut
-    std::vector<int> posMmkIn0(volMmk0);
-    std::vector<int> posMmkOut0(volMmk0);
-#ifdef ENABLE_NVTOOLS
-    gpuRangeStart("computePos");
-#endif
-    computePos0(volMmk0, hostMmk.data(), tensorSplit.sizeMmk, posMmkIn0.data(), posMmkOut0.data());
-    // computePos(0, volMmk0 - 1, hostMmkFast.data(), tensorSplit.sizeMmk, posMmkIn0.data(), posMmkOut0.data());
+    const int* posMmkIn0;
+    const int* posMmkOut0;
+    CUTT_TRACE_BEGIN("computePos");
+    posCache.get(volMmk0, an.hostMmk.data(), tensorSplit.sizeMmk, posMmkIn0, posMmkOut0);
+    // computePos(0, volMmk0 - 1, hostMmkFast.data(), tensorSplit.sizeMmk, posMmkIn0, posMmkOut0);
 #ifdef COUNTCYCLE_CHECK
     std::vector<int> posMmkIn0Ref(volMmk0);
     std::vector<int> posMmkOut0Ref(volMmk0);
-    computePosRef(0, volMmk0 - 1, hostMmk.begin(), hostMmk.begin() + tensorSplit.sizeMmk,
+    computePosRef(0, volMmk0 - 1, an.hostMmk.begin(), an.hostMmk.begin() + tensorSplit.sizeMmk,
       posMmkIn0Ref, posMmkOut0Ref);
     for (int i=0;i < volMmk0;i++) {
       if (posMmkIn0[i] != posMmkIn0Ref[i] || posMmkOut0[i] != posMmkOut0Ref[i]) {
         printf("%d %d | %d %d | i %d volMmk0 %d sizeMmk %d\n", posMmkIn0[i], posMmkIn0Ref[i], posMmkOut0[i], posMmkOut0Ref[i],
           i, volMmk0, tensorSplit.sizeMmk);
         for (int j=0;j < tensorSplit.sizeMmk;j++) {
-          printf("%d %d %d %d %d %d\n", hostMmk[j].c_in, hostMmk[j].d_in, hostMmk[j].ct_in,
-            hostMmk[j].c_out, hostMmk[j].d_out, hostMmk[j].ct_out);
+          printf("%d %d %d %d %d %d\n", an.hostMmk[j].c_in, an.hostMmk[j].d_in, an.hostMmk[j].ct_in,
+            an.hostMmk[j].c_out, an.hostMmk[j].d_out, an.hostMmk[j].ct_out);
         }
         return false;
       }
     }
 #endif
-#ifdef ENABLE_NVTOOLS
-    gpuRangeStop();
-#endif
-    std::vector<int> posMmkIn1(volMmk1);
-    std::vector<int> posMmkOut1(volMmk1);
+    CUTT_TRACE_END();
+    const int* posMmkIn1 = NULL;
+    const int* posMmkOut1 = NULL;
     if (num1 > 0) {
-#ifdef ENABLE_NVTOOLS
-      gpuRangeStart("computePos");
-#endif
-      computePos0(volMmk1, hostMmk.data() + tensorSplit.sizeMmk, tensorSplit.sizeMmk, posMmkIn1.data(), posMmkOut1.data());
+      CUTT_TRACE_BEGIN("computePos");
+      posCache.get(volMmk1, an.hostMmk.data() + tensorSplit.sizeMmk, tensorSplit.sizeMmk, posMmkIn1, posMmkOut1);
       // computePos(0, volMmk1 - 1, hostMmkFast.data() + tensorSplit.sizeMmk, tensorSplit.sizeMmk,
-      //   posMmkIn1.data(), posMmkOut1.data());
+      //   posMmkIn1, posMmkOut1);
 #ifdef COUNTCYCLE_CHECK
       std::vector<int> posMmkIn1Ref(volMmk1);
       std::vector<int> posMmkOut1Ref(volMmk1);
-      computePosRef(0, volMmk1 - 1, hostMmk.begin() + tensorSplit.sizeMmk, hostMmk.begin() + tensorSplit.sizeMmk*2,
+      computePosRef(0, volMmk1 - 1, an.hostMmk.begin() + tensorSplit.sizeMmk, an.hostMmk.begin() + tensorSplit.sizeMmk*2,
         posMmkIn1Ref, posMmkOut1Ref);
       for (int i=0;i < volMmk1;i++) {
         if (posMmkIn1[i] != posMmkIn1Ref[i] || posMmkOut1[i] != posMmkOut1Ref[i]) {
           printf("%d %d | %d %d | i %d volMmk1 %d sizeMmk %d\n", posMmkIn1[i], posMmkIn1Ref[i], posMmkOut1[i], posMmkOut1Ref[i],
             i, volMmk1, tensorSplit.sizeMmk);
           for (int j=0;j < tensorSplit.sizeMmk;j++) {
-            printf("%d %d %d %d %d %d\n", hostMmk[j].c_in, hostMmk[j].d_in, hostMmk[j].ct_in,
-              hostMmk[j].c_out, hostMmk[j].d_out, hostMmk[j].ct_out);
+            printf("%d %d %d %d %d %d\n", an.hostMmk[j].c_in, an.hostMmk[j].d_in, an.hostMmk[j].ct_in,
+              an.hostMmk[j].c_out, an.hostMmk[j].d_out, an.hostMmk[j].ct_out);
           }
           return false;
         }
       }
 #endif
-#ifdef ENABLE_NVTOOLS
-      gpuRangeStop();
-#endif
+      CUTT_TRACE_END();
     }
 
-    int num_ipos = (numPosMbarSample == 0) ? tensorSplit.volMbar*tensorSplit.numSplit : numPosMbarSample;
-
-#ifdef ENABLE_NVTOOLS
-    gpuRangeStop();
-    gpuRangeStart("PackedSplit: loop");
-#endif
-
-    std::vector<int> posTmp(num_ipos);
-    int numRoundUp = 0;
-    for (int ipos=0;ipos < num_ipos;ipos++) {
-      posTmp[ipos] = (numPosMbarSample == 0) ? ipos : distribution(generator);
-      int isplit = posTmp[ipos] % tensorSplit.numSplit;
-      if (isplit < num1) numRoundUp++;
-    }
-    std::vector<int> pos(num_ipos);
-    int indRoundUp = 0;
-    int indRoundDown = numRoundUp;
-    for (int ipos=0;ipos < num_ipos;ipos++) {
-      int isplit = posTmp[ipos] % tensorSplit.numSplit;
-      if (isplit < num1) {
-        pos[indRoundUp++] = posTmp[ipos];
-      } else {
-        pos[indRoundDown++] = posTmp[ipos];        
+    CUTT_TRACE_END();
+    CUTT_TRACE_BEGIN("PackedSplit: loop");
+
+    int posSample[CPU_VECTOR_LEN_MAX];
+    int numSample;
+    while ((numSample = sampler.next(posSample)) > 0) {
+      // Sort positions into round up and round down splits
+      int posRound[2][CPU_VECTOR_LEN_MAX];
+      int numRound[2] = {0, 0};
+      for (int i=0;i < numSample;i++) {
+        int isplit = posSample[i] % tensorSplit.numSplit;
+        int iround = (isplit < num1) ? 1 : 0;
+        posRound[iround][numRound[iround]++] = posSample[i];
       }
-    }
-    if (indRoundUp != numRoundUp || indRoundDown != num_ipos) {
-      printf("cuttPlan_t::countCycles, fatal implemention bug\n");
-      return false;
-    }
-    // Round up is in pos[0 ... numRoundUp - 1]
-    // Round down is in pos[numRoundUp ... num_ipos - 1]
 
-    // Round up splits
-    for (int ipos=0;ipos < numRoundUp;ipos += INT_VECTOR_LEN) {
-      int numPos = std::min(numRoundUp - ipos, INT_VECTOR_LEN);
-      int posMbarIn[INT_VECTOR_LEN];
-      int posMbarOut[INT_VECTOR_LEN];
-      for (int i=0;i < numPos;i++) {
-        int posMbar = pos[ipos + i] / tensorSplit.numSplit;
-        int isplit  = pos[ipos + i] % tensorSplit.numSplit;
-        int p0 = isplit*tensorSplit.splitDim/tensorSplit.numSplit;
-        computePos(posMbar, posMbar, hostMbar.data(), tensorSplit.sizeMbar, &posMbarIn[i], &posMbarOut[i]);
-        posMbarIn[i] += p0*cuDimMm;
-        posMbarOut[i] += p0*cuDimMk;
-      }
-      for (int i=numPos;i < INT_VECTOR_LEN;i++) {
-        posMbarIn[i]  = posMbarIn[numPos - 1];
-        posMbarOut[i] = posMbarOut[numPos - 1];
-      }
+      for (int iround=0;iround < 2;iround++) {
+        int numPos = numRound[iround];
+        if (numPos == 0) continue;
+        int volMmk = (iround == 1) ? volMmk1 : volMmk0;
+        const int* posMmkIn  = (iround == 1) ? posMmkIn1 : posMmkIn0;
+        const int* posMmkOut = (iround == 1) ? posMmkOut1 : posMmkOut0;
+
+        int posMbarIn[CPU_VECTOR_LEN_MAX];
+        int posMbarOut[CPU_VECTOR_LEN_MAX];
+        for (int i=0;i < numPos;i++) {
+          int posMbar = posRound[iround][i] / tensorSplit.numSplit;
+          int isplit  = posRound[iround][i] % tensorSplit.numSplit;
+          int p0 = isplit*tensorSplit.splitDim/tensorSplit.numSplit;
+          computePos(posMbar, posMbar, an.hostMbar.data(), tensorSplit.sizeMbar, &posMbarIn[i], &posMbarOut[i]);
+          posMbarIn[i] += p0*cuDimMm;
+          posMbarOut[i] += p0*cuDimMk;
+        }
 
-      int gld_tran_tmp = 0;
-      int gst_tran_tmp = 0;
-      int gld_req_tmp = 0;
-      int gst_req_tmp = 0;
-      int cl_full_l2_tmp = 0;
-      int cl_part_l2_tmp = 0;
-      countPackedGlTransactions0(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
-        numPos, posMbarIn, posMbarOut, volMmk1, posMmkIn1.data(), posMmkOut1.data(),
-        gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp,
-        cl_full_l2_tmp, cl_part_l2_tmp, cl_full_l1, cl_part_l1);
-      gld_tran += gld_tran_tmp;
-      gst_tran += gst_tran_tmp;
-      gld_req += gld_req_tmp;
-      gst_req += gst_req_tmp;
-      cl_full_l2 += cl_full_l2_tmp;
-      cl_part_l2 += cl_part_l2_tmp;
+        int gld_tran_tmp = 0;
+        int gst_tran_tmp = 0;
+        int gld_req_tmp = 0;
+        int gst_req_tmp = 0;
+        int cl_full_l2_tmp = 0;
+        int cl_part_l2_tmp = 0;
+        int tranPos[CPU_VECTOR_LEN_MAX];
+        countPackedGlTransactions0(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
+          numPos, posMbarIn, posMbarOut, volMmk, posMmkIn, posMmkOut,
+          gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp,
+          cl_full_l2_tmp, cl_part_l2_tmp, an.cl_full_l1, an.cl_part_l1, tranPos);
+        an.gld_tran += gld_tran_tmp;
+        an.gst_tran += gst_tran_tmp;
+        an.gld_req += gld_req_tmp;
+        an.gst_req += gst_req_tmp;
+        an.cl_full_l2 += cl_full_l2_tmp;
+        an.cl_part_l2 += cl_part_l2_tmp;
+        for (int i=0;i < numPos;i++) sampler.add(tranPos[i]);
 
 #ifdef COUNTCYCLE_CHECK
-      int gld_tran_ref = 0;
-      int gst_tran_ref = 0;
-      int gld_req_ref = 0;
-      int gst_req_ref = 0;
-      int cl_full_l2_ref = 0;
-      int cl_part_l2_ref = 0;
-      for (int i=0;i < numPos;i++) {
-        countPackedGlTransactions(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
-          posMbarIn[i], posMbarOut[i], volMmk1, posMmkIn1, posMmkOut1,
-          gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref,
-          cl_full_l2_ref, cl_part_l2_ref, cl_full_l1, cl_part_l1);
-      }
-      if (gld_tran_tmp != gld_tran_ref || gst_tran_tmp != gst_tran_ref ||
-        gld_req_tmp != gld_req_ref || gst_req_tmp != gst_req_ref) {
-        printf("PackedSplit:countPackedGlTransactions0 ERROR\n");
-        printf("tmp %d %d %d %d\n", gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp);
-        printf("ref %d %d %d %d\n", gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref);
-        return false;
-      }
-      if (cl_full_l2_tmp != cl_full_l2_ref || cl_part_l2_tmp != cl_part_l2_ref) {
-        printf("PackedSplit:countPackedGlTransactions0 ERROR\n");
-        printf("tmp %d %d\n", cl_full_l2_tmp, cl_part_l2_tmp);
-        printf("ref %d %d\n",  cl_full_l2_ref, cl_part_l2_ref);
-        return false;
-      }
+        int gld_tran_ref = 0;
+        int gst_tran_ref = 0;
+        int gld_req_ref = 0;
+        int gst_req_ref = 0;
+        int cl_full_l2_ref = 0;
+        int cl_part_l2_ref = 0;
+        for (int i=0;i < numPos;i++) {
+          countPackedGlTransactions(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
+            posMbarIn[i], posMbarOut[i], volMmk, posMmkIn, posMmkOut,
+            gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref,
+            cl_full_l2_ref, cl_part_l2_ref, an.cl_full_l1, an.cl_part_l1);
+        }
+        if (gld_tran_tmp != gld_tran_ref || gst_tran_tmp != gst_tran_ref ||
+          gld_req_tmp != gld_req_ref || gst_req_tmp != gst_req_ref) {
+          printf("PackedSplit:countPackedGlTransactions0 ERROR\n");
+          printf("tmp %d %d %d %d\n", gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp);
+          printf("ref %d %d %d %d\n", gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref);
+          return false;
+        }
+        if (cl_full_l2_tmp != cl_full_l2_ref || cl_part_l2_tmp != cl_part_l2_ref) {
+          printf("PackedSplit:countPackedGlTransactions0 ERROR\n");
+          printf("tmp %d %d\n", cl_full_l2_tmp, cl_part_l2_tmp);
+          printf("ref %d %d\n",  cl_full_l2_ref, cl_part_l2_ref);
+          return false;
+        }
 #endif
-    }
-
-    // Round down splits
-    for (int ipos=numRoundUp;ipos < num_ipos;ipos += INT_VECTOR_LEN) {
-      int numPos = std::min(num_ipos - ipos, INT_VECTOR_LEN);
-      int posMbarIn[INT_VECTOR_LEN];
-      int posMbarOut[INT_VECTOR_LEN];
-      for (int i=0;i < numPos;i++) {
-        int posMbar = pos[ipos + i] / tensorSplit.numSplit;
-        int isplit  = pos[ipos + i] % tensorSplit.numSplit;
-        int p0 = isplit*tensorSplit.splitDim/tensorSplit.numSplit;
-        computePos(posMbar, posMbar, hostMbar.data(), tensorSplit.sizeMbar, &posMbarIn[i], &posMbarOut[i]);
-        posMbarIn[i] += p0*cuDimMm;
-        posMbarOut[i] += p0*cuDimMk;
-      }
-      for (int i=numPos;i < INT_VECTOR_LEN;i++) {
-        posMbarIn[i]  = posMbarIn[numPos - 1];
-        posMbarOut[i] = posMbarOut[numPos - 1];
-      }
-
-      int gld_tran_tmp = 0;
-      int gst_tran_tmp = 0;
-      int gld_req_tmp = 0;
-      int gst_req_tmp = 0;
-      int cl_full_l2_tmp = 0;
-      int cl_part_l2_tmp = 0;
-      countPackedGlTransactions0(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
-        numPos, posMbarIn, posMbarOut, volMmk0, posMmkIn0.data(), posMmkOut0.data(),
-        gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp,
-        cl_full_l2_tmp, cl_part_l2_tmp, cl_full_l1, cl_part_l1);
-      gld_tran += gld_tran_tmp;
-      gst_tran += gst_tran_tmp;
-      gld_req += gld_req_tmp;
-      gst_req += gst_req_tmp;
-      cl_full_l2 += cl_full_l2_tmp;
-      cl_part_l2 += cl_part_l2_tmp;
-
-#ifdef COUNTCYCLE_CHECK
-      int gld_tran_ref = 0;
-      int gst_tran_ref = 0;
-      int gld_req_ref = 0;
-      int gst_req_ref = 0;
-      int cl_full_l2_ref = 0;
-      int cl_part_l2_ref = 0;
-      for (int i=0;i < numPos;i++) {
-        countPackedGlTransactions(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
-          posMbarIn[i], posMbarOut[i], volMmk0, posMmkIn0, posMmkOut0,
-          gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref,
-          cl_full_l2_ref, cl_part_l2_ref, cl_full_l1, cl_part_l1);
-      }
-      if (gld_tran_tmp != gld_tran_ref || gst_tran_tmp != gst_tran_ref ||
-        gld_req_tmp != gld_req_ref || gst_req_tmp != gst_req_ref) {
-        printf("PackedSplit:countPackedGlTransactions0 ERROR\n");
-        printf("tmp %d %d %d %d\n", gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp);
-        printf("ref %d %d %d %d\n", gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref);
-        return false;
-      }
-      if (cl_full_l2_tmp != cl_full_l2_ref || cl_part_l2_tmp != cl_part_l2_ref) {
-        printf("PackedSplit:countPackedGlTransactions0 ERROR\n");
-        printf("tmp %d %d\n", cl_full_l2_tmp, cl_part_l2_tmp);
-        printf("ref %d %d\n",  cl_full_l2_ref, cl_part_l2_ref);
-        return false;
       }
-#endif
     }
 
-#ifdef ENABLE_NVTOOLS
-    gpuRangeStop();
-    gpuRangeStart("PackedSplit: shared");
-#endif
+    CUTT_TRACE_END();
+    CUTT_TRACE_BEGIN("PackedSplit: shared");
 
     // Shared memory
-    sld_tran = 0;
-    sst_tran = 0;
-    sld_req = 0;
-    sst_req = 0;
+    an.sld_tran = 0;
+    an.sst_tran = 0;
+    an.sld_req = 0;
+    an.sst_req = 0;
     // Round down splits
     countPackedShTransactions0(prop.warpSize, prop.warpSize, launchConfig.numthread.x, 
-      volMmk0, hostMsh.data(), tensorSplit.sizeMmk,
-      sld_tran, sst_tran, sld_req, sst_req);
+      volMmk0, an.hostMsh.data(), tensorSplit.sizeMmk,
+      an.sld_tran, an.sst_tran, an.sld_req, an.sst_req);
 #ifdef COUNTCYCLE_CHECK
     {
       int sld_tran_ref = 0;
@@ -1370,21 +1554,21 @@ bool cuttPlan_t::countCycles(cudaDeviceProp& prop, const int numPosMbarSample) {
       int sld_req_ref = 0;
       int sst_req_ref = 0;
       countPackedShTransactionsRef(prop.warpSize, prop.warpSize, launchConfig.numthread.x, 
-        volMmk0, hostMsh.data(), tensorSplit.sizeMmk,
+        volMmk0, an.hostMsh.data(), tensorSplit.sizeMmk,
         sld_tran_ref, sst_tran_ref, sld_req_ref, sst_req_ref);
-      if (sld_tran != sld_tran_ref || sst_tran != sst_tran_ref ||
-        sld_req != sld_req_ref || sst_req != sst_req_ref) {
+      if (an.sld_tran != sld_tran_ref || an.sst_tran != sst_tran_ref ||
+        an.sld_req != sld_req_ref || an.sst_req != sst_req_ref) {
         printf("PackedSplit:countPackedShTransactions0 fails\n");
-        printf("    %d %d %d %d\n", sld_tran, sst_tran, sld_req, sst_req);
+        printf("    %d %d %d %d\n", an.sld_tran, an.sst_tran, an.sld_req, an.sst_req);
         printf("ref %d %d %d %d\n", sld_tran_ref, sst_tran_ref, sld_req_ref, sst_req_ref);
         return false;
       }
     }
 #endif
-    sld_tran *= num0;
-    sst_tran *= num0;
-    sld_req *= num0;
-    sst_req *= num0;
+    an.sld_tran *= num0;
+    an.sst_tran *= num0;
+    an.sld_req *= num0;
+    an.sst_req *= num0;
 
     // Round up splits
     if (num1 > 0) {
@@ -1393,7 +1577,7 @@ bool cuttPlan_t::countCycles(cudaDeviceProp& prop, const int numPosMbarSample) {
       int sld_req_tmp = 0;
       int sst_req_tmp = 0;
       countPackedShTransactions0(prop.warpSize, prop.warpSize, launchConfig.numthread.x, 
-        volMmk1, hostMsh.data() + tensorSplit.sizeMmk, tensorSplit.sizeMmk,
+        volMmk1, an.hostMsh.data() + tensorSplit.sizeMmk, tensorSplit.sizeMmk,
         sld_tran_tmp, sst_tran_tmp, sld_req_tmp, sst_req_tmp);
 #ifdef COUNTCYCLE_CHECK
       {
@@ -1402,57 +1586,48 @@ bool cuttPlan_t::countCycles(cudaDeviceProp& prop, const int numPosMbarSample) {
         int sld_req_ref = 0;
         int sst_req_ref = 0;
         countPackedShTransactionsRef(prop.warpSize, prop.warpSize, launchConfig.numthread.x, 
-          volMmk1, hostMsh.data() + tensorSplit.sizeMmk, tensorSplit.sizeMmk,
+          volMmk1, an.hostMsh.data() + tensorSplit.sizeMmk, tensorSplit.sizeMmk,
           sld_tran_ref, sst_tran_ref, sld_req_ref, sst_req_ref);
         if (sld_tran_tmp != sld_tran_ref || sst_tran_tmp != sst_tran_ref ||
           sld_req_tmp != sld_req_ref || sst_req_tmp != sst_req_ref) {
           printf("PackedSplit:countPackedShTransactions0 fails\n");
-          printf("    %d %d %d %d\n", sld_tran, sst_tran, sld_req, sst_req);
+          printf("    %d %d %d %d\n", an.sld_tran, an.sst_tran, an.sld_req, an.sst_req);
           printf("ref %d %d %d %d\n", sld_tran_ref, sst_tran_ref, sld_req_ref, sst_req_ref);
           return false;
         }
       }
 #endif
-      sld_tran += sld_tran_tmp*num1;
-      sst_tran += sst_tran_tmp*num1;
-      sld_req += sld_req_tmp*num1;
-      sst_req += sst_req_tmp*num1;
+      an.sld_tran += sld_tran_tmp*num1;
+      an.sst_tran += sst_tran_tmp*num1;
+      an.sld_req += sld_req_tmp*num1;
+      an.sst_req += sst_req_tmp*num1;
     }
-#ifdef ENABLE_NVTOOLS
-    gpuRangeStop();
-#endif
+    CUTT_TRACE_END();
 
   } else if (tensorSplit.method == Packed) {
-#ifdef ENABLE_NVTOOLS
-    gpuRangeStart("Packed: init");
-#endif
-    num_iter = tensorSplit.volMbar;
-    // mlp = (float)launchConfig.numRegStorage;
-    mlp = (float)(tensorSplit.volMmk) / (float)(launchConfig.numthread.x);
+    CUTT_TRACE_BEGIN("Packed: init");
+    an.num_iter = tensorSplit.volMbar;
+    // an.mlp = (float)launchConfig.numRegStorage;
+    an.mlp = (float)(tensorSplit.volMmk) / (float)(launchConfig.numthread.x);
     // Global memory
-    gld_tran = 0;
-    gst_tran = 0;
-    gld_req = 0;
-    gst_req = 0;
-    cl_full_l2 = 0;
-    cl_part_l2 = 0;
-    cl_full_l1 = 0;
-    cl_part_l1 = 0;
-    // Random number generator
-    std::default_random_engine generator;
-    std::uniform_int_distribution<int> distribution(0, tensorSplit.volMbar - 1);
+    an.gld_tran = 0;
+    an.gst_tran = 0;
+    an.gld_req = 0;
+    an.gst_req = 0;
+    an.cl_full_l2 = 0;
+    an.cl_part_l2 = 0;
+    an.cl_full_l1 = 0;
+    an.cl_part_l1 = 0;
     // Pre-compute posMmkIn and posMmkOut
-    std::vector<int> posMmkIn(tensorSplit.volMmk);
-    std::vector<int> posMmkOut(tensorSplit.volMmk);
-
-    computePos0(tensorSplit.volMmk, hostMmk.data(), tensorSplit.sizeMmk,
-      posMmkIn.data(), posMmkOut.data());
+    const int* posMmkIn;
+    const int* posMmkOut;
+    posCache.get(tensorSplit.volMmk, an.hostMmk.data(), tensorSplit.sizeMmk, posMmkIn, posMmkOut);
     // computePos(0, tensorSplit.volMmk - 1, hostMmkFast.data(), tensorSplit.sizeMmk,
-    //   posMmkIn.data(), posMmkOut.data());
+    //   posMmkIn, posMmkOut);
 #ifdef COUNTCYCLE_CHECK
     std::vector<int> posMmkInRef(tensorSplit.volMmk);
     std::vector<int> posMmkOutRef(tensorSplit.volMmk);
-    computePosRef(0, tensorSplit.volMmk - 1, hostMmk.begin(), hostMmk.begin() + tensorSplit.sizeMmk,
+    computePosRef(0, tensorSplit.volMmk - 1, an.hostMmk.begin(), an.hostMmk.begin() + tensorSplit.sizeMmk,
       posMmkInRef, posMmkOutRef);
     for (int i=0;i < tensorSplit.volMmk;i++) {
       if (posMmkIn[i] != posMmkInRef[i] || posMmkOut[i] != posMmkOutRef[i]) {
@@ -1463,40 +1638,24 @@ bool cuttPlan_t::countCycles(cudaDeviceProp& prop, const int numPosMbarSample) {
     }
 #endif
 
-    int num_ipos = (numPosMbarSample == 0) ? tensorSplit.volMbar : numPosMbarSample;
-
-#ifdef ENABLE_NVTOOLS
-    gpuRangeStop();
-    gpuRangeStart("Packed: loop");
-#endif
+    CUTT_TRACE_END();
+    CUTT_TRACE_BEGIN("Packed: loop");
 
-    for (int iposMbar=0;iposMbar < num_ipos;iposMbar+=INT_VECTOR_LEN) {
-      // int posMbar = (numPosMbarSample == 0) ? iposMbar : distribution(generator);
-      int numPos = std::min(num_ipos - iposMbar, INT_VECTOR_LEN);
-      int posMbar[INT_VECTOR_LEN];
+    int posMbar[CPU_VECTOR_LEN_MAX];
+    int numPos;
+    while ((numPos = sampler.next(posMbar)) > 0) {
+      int posMbarIn[CPU_VECTOR_LEN_MAX];
+      int posMbarOut[CPU_VECTOR_LEN_MAX];
+      CUTT_TRACE_BEGIN("computePos");
       for (int i=0;i < numPos;i++) {
-        posMbar[i] = (numPosMbarSample == 0) ? (iposMbar + i) : distribution(generator);
+        computePos(posMbar[i], posMbar[i], an.hostMbar.data(), tensorSplit.sizeMbar, &posMbarIn[i], &posMbarOut[i]);
       }
-      for (int i=numPos;i < INT_VECTOR_LEN;i++) {
-        posMbar[i] = posMbar[numPos - 1];
-      }
-
-      int posMbarIn[INT_VECTOR_LEN];
-      int posMbarOut[INT_VECTOR_LEN];
-#ifdef ENABLE_NVTOOLS
-      gpuRangeStart("computePos");
-#endif
-      for (int i=0;i < INT_VECTOR_LEN;i++) {
-        computePos(posMbar[i], posMbar[i], hostMbar.data(), tensorSplit.sizeMbar, &posMbarIn[i], &posMbarOut[i]);
-      }
-      // computePosRef(posMbar, posMbar, hostMbar.begin(), hostMbar.begin() + tensorSplit.sizeMbar, posMbarInV, posMbarOutV);
+      // computePosRef(posMbar, posMbar, an.hostMbar.begin(), an.hostMbar.begin() + tensorSplit.sizeMbar, posMbarInV, posMbarOutV);
       // int posMbarIn = posMbarInV[0];
       // int posMbarOut = posMbarOutV[0];
 
-#ifdef ENABLE_NVTOOLS
-      gpuRangeStop();
-      gpuRangeStart("countPackedGlTransactions");
-#endif
+      CUTT_TRACE_END();
+      CUTT_TRACE_BEGIN("countPackedGlTransactions");
 
       int gld_tran_tmp = 0;
       int gst_tran_tmp = 0;
@@ -1504,16 +1663,18 @@ bool cuttPlan_t::countCycles(cudaDeviceProp& prop, const int numPosMbarSample) {
       int gst_req_tmp = 0;
       int cl_full_l2_tmp = 0;
       int cl_part_l2_tmp = 0;
+      int tranPos[CPU_VECTOR_LEN_MAX];
       countPackedGlTransactions0(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
-        numPos, posMbarIn, posMbarOut, tensorSplit.volMmk, posMmkIn.data(), posMmkOut.data(),
+        numPos, posMbarIn, posMbarOut, tensorSplit.volMmk, posMmkIn, posMmkOut,
         gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp,
-        cl_full_l2_tmp, cl_part_l2_tmp, cl_full_l1, cl_part_l1);
-      gld_tran += gld_tran_tmp;
-      gst_tran += gst_tran_tmp;
-      gld_req += gld_req_tmp;
-      gst_req += gst_req_tmp;
-      cl_full_l2 += cl_full_l2_tmp;
-      cl_part_l2 += cl_part_l2_tmp;
+        cl_full_l2_tmp, cl_part_l2_tmp, an.cl_full_l1, an.cl_part_l1, tranPos);
+      an.gld_tran += gld_tran_tmp;
+      an.gst_tran += gst_tran_tmp;
+      an.gld_req += gld_req_tmp;
+      an.gst_req += gst_req_tmp;
+      an.cl_full_l2 += cl_full_l2_tmp;
+      an.cl_part_l2 += cl_part_l2_tmp;
+      for (int i=0;i < numPos;i++) sampler.add(tranPos[i]);
 
 #ifdef COUNTCYCLE_CHECK
       int gld_tran_ref = 0;
@@ -1526,7 +1687,7 @@ bool cuttPlan_t::countCycles(cudaDeviceProp& prop, const int numPosMbarSample) {
         countPackedGlTransactions(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
           posMbarIn[i], posMbarOut[i], tensorSplit.volMmk, posMmkIn, posMmkOut,
           gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref,
-          cl_full_l2_ref, cl_part_l2_ref, cl_full_l1, cl_part_l1);
+          cl_full_l2_ref, cl_part_l2_ref, an.cl_full_l1, an.cl_part_l1);
       }
       if (gld_tran_tmp != gld_tran_ref || gst_tran_tmp != gst_tran_ref ||
         gld_req_tmp != gld_req_ref || gst_req_tmp != gst_req_ref) {
@@ -1543,81 +1704,86 @@ bool cuttPlan_t::countCycles(cudaDeviceProp& prop, const int numPosMbarSample) {
       }
 #endif
 
-#ifdef ENABLE_NVTOOLS
-      gpuRangeStop();
-#endif
+      CUTT_TRACE_END();
     }
 
-#ifdef ENABLE_NVTOOLS
-    gpuRangeStop();
-    gpuRangeStart("Packed: shared");
-#endif
+    CUTT_TRACE_END();
+    CUTT_TRACE_BEGIN("Packed: shared");
 
     // Shared memory
-    sld_tran = 0;
-    sst_tran = 0;
-    sld_req = 0;
-    sst_req = 0;
+    an.sld_tran = 0;
+    an.sst_tran = 0;
+    an.sld_req = 0;
+    an.sst_req = 0;
     countPackedShTransactions0(prop.warpSize, prop.warpSize, launchConfig.numthread.x, 
-      tensorSplit.volMmk, hostMsh.data(), tensorSplit.sizeMmk,
-      sld_tran, sst_tran, sld_req, sst_req);
+      tensorSplit.volMmk, an.hostMsh.data(), tensorSplit.sizeMmk,
+      an.sld_tran, an.sst_tran, an.sld_req, an.sst_req);
 #ifdef COUNTCYCLE_CHECK
     int sld_tran_ref = 0;
     int sst_tran_ref = 0;
     int sld_req_ref = 0;
     int sst_req_ref = 0;
     countPackedShTransactionsRef(prop.warpSize, prop.warpSize, launchConfig.numthread.x, 
-      tensorSplit.volMmk, hostMsh.data(), tensorSplit.sizeMmk,
+      tensorSplit.volMmk, an.hostMsh.data(), tensorSplit.sizeMmk,
       sld_tran_ref, sst_tran_ref, sld_req_ref, sst_req_ref);
-    if (sld_tran != sld_tran_ref || sst_tran != sst_tran_ref ||
-      sld_req != sld_req_ref || sst_req != sst_req_ref) {
+    if (an.sld_tran != sld_tran_ref || an.sst_tran != sst_tran_ref ||
+      an.sld_req != sld_req_ref || an.sst_req != sst_req_ref) {
       printf("countPackedShTransactions0 fails\n");
-      printf("    %d %d %d %d\n", sld_tran, sst_tran, sld_req, sst_req);
+      printf("    %d %d %d %d\n", an.sld_tran, an.sst_tran, an.sld_req, an.sst_req);
       printf("ref %d %d %d %d\n", sld_tran_ref, sst_tran_ref, sld_req_ref, sst_req_ref);
       return false;
     }
 #endif
     // countPackedShTransactions(prop.warpSize, prop.warpSize, launchConfig.numthread.x, 
-    //   tensorSplit.volMmk, hostMsh.data(), tensorSplit.sizeMmk,
-    //   sld_tran, sst_tran, sld_req, sst_req);
-#ifdef ENABLE_NVTOOLS
-    gpuRangeStop();
-#endif
+    //   tensorSplit.volMmk, an.hostMsh.data(), tensorSplit.sizeMmk,
+    //   an.sld_tran, an.sst_tran, an.sld_req, an.sst_req);
+    CUTT_TRACE_END();
   } else if (tensorSplit.method == Trivial) {
     size_t vol = tensorSplit.volMmk*tensorSplit.volMbar;
     // Global memory
-    gld_req = (vol - 1)/prop.warpSize + 1;
-    gst_req = gld_req;
-    gld_tran = (vol - 1)/accWidth + 1;
-    gst_tran = gld_tran;
-    cl_full_l2 = vol/cacheWidth;
-    cl_part_l2 = ((vol % cacheWidth) > 0);
+    an.gld_req = (vol - 1)/prop.warpSize + 1;
+    an.gst_req = an.gld_req;
+    an.gld_tran = (vol - 1)/accWidth + 1;
+    an.gst_tran = an.gld_tran;
+    an.cl_full_l2 = vol/cacheWidth;
+    an.cl_part_l2 = ((vol % cacheWidth) > 0);
     // Shared memory
-    sld_tran = 0;
-    sst_tran = 0;
-    sld_req = 0;
-    sst_req = 0;
+    an.sld_tran = 0;
+    an.sst_tran = 0;
+    an.sld_req = 0;
+    an.sst_req = 0;
     // Cycles
-    cycles = 0.0;
+    an.cycles = 0.0;
     return true;
   } else {
     return false;
   }
 
 
+  if (tensorSplit.method == Tiled || tensorSplit.method == TiledCopy) {
+    // Tiled transactions are counted exactly for all Mbar positions
+    an.numPosMbar = tensorSplit.volMbar;
+    an.tranMean = (double)(an.gld_tran + an.gst_tran + an.cl_part_l2)/(double)tensorSplit.volMbar;
+    an.tranVar = 0.0;
+  } else {
+    an.numPosMbar = sampler.count();
+    an.tranMean = sampler.getMean();
+    an.tranVar = sampler.getVariance();
+  }
+
   int numthread = launchConfig.numthread.x*launchConfig.numthread.y*launchConfig.numthread.z;
   // double cl_val = (double)cl_part/(double)std::max(1, cl_full + cl_part);
 
   if (tensorSplit.method == Packed || tensorSplit.method == PackedSplit) {
-    cycles = cyclesPacked(tensorSplit.method == PackedSplit, sizeofType, prop, numthread,
+    an.cycles = cyclesPacked(tensorSplit.method == PackedSplit, sizeofType, prop, numthread,
       numActiveBlock, launchConfig.numRegStorage, 
-      gld_req, gst_req, gld_tran, gst_tran, sld_req, sst_req, sld_tran, sst_tran,
-      num_iter, cl_full_l2, cl_part_l2);
+      an.gld_req, an.gst_req, an.gld_tran, an.gst_tran, an.sld_req, an.sst_req, an.sld_tran, an.sst_tran,
+      an.num_iter, an.cl_full_l2, an.cl_part_l2);
   } else if (tensorSplit.method == Tiled || tensorSplit.method == TiledCopy) {
-    cycles = cyclesTiled(tensorSplit.method == TiledCopy, sizeofType, prop, numthread,
-      numActiveBlock, mlp, gld_req, gst_req, gld_tran, gst_tran,
-      sld_req, sst_req, sld_tran, sst_tran,
-      num_iter, cl_full_l2, cl_part_l2);
+    an.cycles = cyclesTiled(tensorSplit.method == TiledCopy, sizeofType, prop, numthread,
+      numActiveBlock, an.mlp, an.gld_req, an.gst_req, an.gld_tran, an.gst_tran,
+      an.sld_req, an.sst_req, an.sld_tran, an.sst_tran,
+      an.num_iter, an.cl_full_l2, an.cl_part_l2);
   }
 
   return true;
@@ -1628,10 +1794,15 @@ bool cuttPlan_t::countCycles(cudaDeviceProp& prop, const int numPosMbarSample) {
 //
 void cuttPlan_t::activate() {
 
+  CUTT_TRACE_SCOPE("activate");
+  // Once the analysis record is dropped the plan is already active, see dropAnalysis()
+  if (analysis == NULL) return;
+  PlanAnalysis& an = *analysis;
+
   if (tensorSplit.sizeMbar > 0) {
     if (Mbar == NULL) {
       allocate_device<TensorConvInOut>(&Mbar, tensorSplit.sizeMbar);
-      copy_HtoD<TensorConvInOut>(hostMbar.data(), Mbar, tensorSplit.sizeMbar, stream);
+      copy_HtoD<TensorConvInOut>(an.hostMbar.data(), Mbar, tensorSplit.sizeMbar, stream);
     }
   }
 
@@ -1639,11 +1810,11 @@ void cuttPlan_t::activate() {
     int MmkSize = (tensorSplit.method == Packed) ? tensorSplit.sizeMmk : tensorSplit.sizeMmk*2;
     if (Mmk == NULL) {
       allocate_device<TensorConvInOut>(&Mmk, MmkSize);
-      copy_HtoD<TensorConvInOut>(hostMmk.data(), Mmk, MmkSize, stream);
+      copy_HtoD<TensorConvInOut>(an.hostMmk.data(), Mmk, MmkSize, stream);
     }
     if (Msh == NULL) {
       allocate_device<TensorConv>(&Msh, MmkSize);
-      copy_HtoD<TensorConv>(hostMsh.data(), Msh, MmkSize, stream);
+      copy_HtoD<TensorConv>(an.hostMsh.data(), Msh, MmkSize, stream);
     }
   }
 
@@ -1656,8 +1827,19 @@ void cuttPlan_t::nullDevicePointers() {
   Mbar = NULL;
   Mmk = NULL;
   Msh = NULL;
-  Mk = NULL;
-  Mm = NULL;
+}
+
+PlanCounters::PlanCounters() {
+  num_iter = 0;
+  mlp = 0.0f;
+  gld_req = gst_req = gld_tran = gst_tran = 0;
+  cl_full_l2 = cl_part_l2 = 0;
+  cl_full_l1 = cl_part_l1 = 0;
+  sld_req = sst_req = sld_tran = sst_tran = 0;
+  cycles = 0.0;
+  numPosMbar = 0;
+  tranMean = 0.0;
+  tranVar = 0.0;
 }
 
 cuttPlan_t::cuttPlan_t() {
@@ -1667,13 +1849,88 @@ cuttPlan_t::cuttPlan_t() {
   nullDevicePointers();
 }
 
+cuttPlan_t::cuttPlan_t(const int deviceID_in) {
+  deviceID = deviceID_in;
+  stream = 0;
+  numActiveBlock = 0;
+  nullDevicePointers();
+}
+
+cuttPlan_t::cuttPlan_t(cuttPlan_t&& other) {
+  moveFrom(other);
+}
+
+cuttPlan_t& cuttPlan_t::operator=(cuttPlan_t&& other) {
+  if (this != &other) {
+    deallocate();
+    moveFrom(other);
+  }
+  return *this;
+}
+
 cuttPlan_t::~cuttPlan_t() {
-  // Deallocate device buffers
+  deallocate();
+}
+
+//
+// Deallocate device buffers
+//
+void cuttPlan_t::deallocate() {
   if (Mbar != NULL) deallocate_device<TensorConvInOut>(&Mbar);
   if (Mmk != NULL) deallocate_device<TensorConvInOut>(&Mmk);
   if (Msh != NULL) deallocate_device<TensorConv>(&Msh);
-  if (Mk != NULL) deallocate_device<TensorConv>(&Mk);
-  if (Mm != NULL) deallocate_device<TensorConv>(&Mm);
+  nullDevicePointers();
+}
+
+//
+// Takes over contents of other, including device buffers
+//
+void cuttPlan_t::moveFrom(cuttPlan_t& other) {
+  deviceID = other.deviceID;
+  stream = other.stream;
+  launchConfig = other.launchConfig;
+  rank = other.rank;
+  sizeofType = other.sizeofType;
+  tensorDim = std::move(other.tensorDim);
+  tensorSplit = other.tensorSplit;
+  numActiveBlock = other.numActiveBlock;
+  cuDimMk = other.cuDimMk;
+  cuDimMm = other.cuDimMm;
+  tiledVol = other.tiledVol;
+  Mbar = other.Mbar;
+  Mmk = other.Mmk;
+  Msh = other.Msh;
+  analysis = std::move(other.analysis);
+  structure = std::move(other.structure);
+  stats = std::move(other.stats);
+  other.nullDevicePointers();
+}
+
+void cuttPlan_t::dropAnalysis() {
+  activate();
+  analysis.reset();
+}
+
+size_t cuttPlan_t::hostMemoryUsage(const bool withStructure) const {
+  size_t bytes = sizeof(cuttPlan_t) + tensorDim.capacity()*sizeof(int);
+  if (analysis != NULL) bytes += analysis->memoryUsage();
+  if (withStructure && structure != NULL) bytes += structure->memoryUsage();
+  if (stats != NULL) bytes += sizeof(PlanStats);
+  return bytes;
+}
+
+size_t cuttPlan_t::deviceMemoryUsage() const {
+  size_t bytes = 0;
+  if (Mbar != NULL) bytes += tensorSplit.sizeMbar*sizeof(TensorConvInOut);
+  int MmkSize = (tensorSplit.method == PackedSplit) ? tensorSplit.sizeMmk*2 : tensorSplit.sizeMmk;
+  if (Mmk != NULL) bytes += MmkSize*sizeof(TensorConvInOut);
+  if (Msh != NULL) bytes += MmkSize*sizeof(TensorConv);
+  return bytes;
+}
+
+size_t PlanAnalysis::memoryUsage() const {
+  return sizeof(PlanAnalysis) + hostMbar.capacity()*sizeof(TensorConvInOut) +
+    hostMmk.capacity()*sizeof(TensorConvInOut) + hostMsh.capacity()*sizeof(TensorConv);
 }
 
 void cuttPlan_t::setStream(cudaStream_t stream_in) {
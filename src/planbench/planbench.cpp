@@ -0,0 +1,386 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+//
+// Micro-benchmark of the planner. Times the planning phases of cuttPlan (reduceRanks,
+// createPlans, countCycles, choosePlanHeuristic) and counts their heap allocations over a corpus
+// of tensors: ranks 2-8, uniform and skewed dimensions, element sizes 4 and 8.
+// By default plans are made for a virtual device, so no GPU is needed
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <random>
+#include "CudaUtils.h"
+#include "cuttplan.h"
+#include "cuttkernel.h"    // CUTT_VIRTUAL_DEVICE
+#include "cuttArena.h"
+#include "cuttGpuModel.h"  // posTableCache
+#include "cuttTimer.h"
+
+//
+// Heap allocations, counted by replacing the global operator new
+//
+static std::atomic<long long> numAlloc(0);
+static std::atomic<long long> numAllocBytes(0);
+
+static void* allocate(size_t size) {
+  numAlloc.fetch_add(1, std::memory_order_relaxed);
+  numAllocBytes.fetch_add(size, std::memory_order_relaxed);
+  void* p = malloc(size > 0 ? size : 1);
+  if (p == NULL) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new(size_t size) {return allocate(size);}
+void* operator new[](size_t size) {return allocate(size);}
+void operator delete(void* p) noexcept {free(p);}
+void operator delete[](void* p) noexcept {free(p);}
+void operator delete(void* p, size_t) noexcept {free(p);}
+void operator delete[](void* p, size_t) noexcept {free(p);}
+
+//
+// Virtual device descriptions
+//
+struct VirtualDevice {
+  const char* name;
+  int major, minor;
+  int multiProcessorCount;
+  int clockRate;        // kHz
+  int memoryClockRate;  // kHz
+  int memoryBusWidth;   // bits
+  int l2CacheSize;
+  int maxThreadsPerMultiProcessor;
+  int regsPerMultiprocessor;
+  size_t sharedMemPerBlock;
+  size_t sharedMemPerMultiprocessor;
+};
+
+static const VirtualDevice virtualDevices[] = {
+  {"K20X", 3, 5, 14, 732000, 2600000, 384, 1572864, 2048, 65536, 49152, 49152},
+  {"P100", 6, 0, 56, 1480000, 715000, 4096, 4194304, 2048, 65536, 49152, 65536},
+  {"V100", 7, 0, 80, 1530000, 877000, 4096, 6291456, 2048, 65536, 49152, 98304},
+  {"A100", 8, 0, 108, 1410000, 1215000, 5120, 41943040, 2048, 65536, 49152, 167936},
+};
+static const int numVirtualDevice = sizeof(virtualDevices)/sizeof(VirtualDevice);
+
+static bool getVirtualDeviceProp(const char* name, cudaDeviceProp& prop) {
+  for (int i=0;i < numVirtualDevice;i++) {
+    const VirtualDevice& dev = virtualDevices[i];
+    if (strcmp(name, dev.name) != 0) continue;
+    memset(&prop, 0, sizeof(prop));
+    strncpy(prop.name, dev.name, sizeof(prop.name) - 1);
+    prop.major = dev.major;
+    prop.minor = dev.minor;
+    prop.warpSize = 32;
+    prop.multiProcessorCount = dev.multiProcessorCount;
+    prop.clockRate = dev.clockRate;
+    prop.memoryClockRate = dev.memoryClockRate;
+    prop.memoryBusWidth = dev.memoryBusWidth;
+    prop.ECCEnabled = 0;
+    prop.l2CacheSize = dev.l2CacheSize;
+    prop.maxThreadsPerBlock = 1024;
+    prop.maxThreadsPerMultiProcessor = dev.maxThreadsPerMultiProcessor;
+    prop.regsPerBlock = 65536;
+    prop.regsPerMultiprocessor = dev.regsPerMultiprocessor;
+    prop.sharedMemPerBlock = dev.sharedMemPerBlock;
+    prop.sharedMemPerMultiprocessor = dev.sharedMemPerMultiprocessor;
+    prop.maxGridSize[0] = 2147483647;
+    prop.maxGridSize[1] = 65535;
+    prop.maxGridSize[2] = 65535;
+    return true;
+  }
+  return false;
+}
+
+// Planning phases
+enum {PhaseReduceRanks, PhaseCreatePlans, PhaseCountCycles, PhaseChoose, NumPhase};
+static const char* phaseName[NumPhase] = {"reduceRanks", "createPlans", "countCycles", "choosePlanHeuristic"};
+
+// Tensor of the corpus
+struct Shape {
+  int sizeofType;
+  bool skewed;
+  std::vector<int> dim;
+  std::vector<int> permutation;
+};
+
+// Results of one phase for a group of plans
+struct PhaseStat {
+  std::vector<double> seconds;
+  long long numAlloc;
+  long long numAllocBytes;
+  PhaseStat() : numAlloc(0), numAllocBytes(0) {}
+};
+
+//
+// Returns dimensions of rank with volume close to vol. Uniform dimensions are all about the same,
+// skewed ones have one large dimension and the rest between 2 and 8
+//
+static std::vector<int> makeDim(std::mt19937& gen, const int rank, const double vol, const bool skewed) {
+  std::vector<int> dim(rank);
+  double volLeft = vol;
+  if (skewed) {
+    std::uniform_int_distribution<int> small(2, 8);
+    std::uniform_int_distribution<int> pick(0, rank - 1);
+    int large = pick(gen);
+    for (int r=0;r < rank;r++) {
+      if (r == large) continue;
+      dim[r] = small(gen);
+      volLeft /= (double)dim[r];
+    }
+    dim[large] = std::max(2, (int)volLeft);
+  } else {
+    std::uniform_real_distribution<double> jitter(0.8, 1.25);
+    for (int r=0;r < rank;r++) {
+      double d = pow(volLeft, 1.0/(double)(rank - r));
+      if (r < rank - 1) d *= jitter(gen);
+      dim[r] = std::max(2, (int)round(d));
+      volLeft /= (double)dim[r];
+    }
+  }
+  return dim;
+}
+
+//
+// Returns random permutation of rank that is not the identity
+//
+static std::vector<int> makePermutation(std::mt19937& gen, const int rank) {
+  std::vector<int> permutation(rank);
+  for (int r=0;r < rank;r++) permutation[r] = r;
+  bool trivial = true;
+  while (trivial) {
+    std::shuffle(permutation.begin(), permutation.end(), gen);
+    for (int r=0;r < rank;r++) trivial = trivial && (permutation[r] == r);
+  }
+  return permutation;
+}
+
+static void printPhaseStat(const char* name, PhaseStat& stat, const int numPlan) {
+  std::sort(stat.seconds.begin(), stat.seconds.end());
+  printf("%-20s %10.1lf %10.1lf %10.1lf %10.1lf %12.1lf\n", name,
+    percentileSorted(stat.seconds, 50.0)*1.0e6, percentileSorted(stat.seconds, 90.0)*1.0e6,
+    percentileSorted(stat.seconds, 99.0)*1.0e6, (double)stat.numAlloc/(double)numPlan,
+    (double)stat.numAllocBytes/(double)numPlan);
+}
+
+int main(int argc, char *argv[]) {
+
+  const char* deviceName = "V100";
+  int gpuid = -1;
+  int numShape = 8;
+  int numRep = 5;
+  double vol = 16.0*1024.0*1024.0;
+  unsigned seed = 1;
+  TimerClock clock = TimerClockSteady;
+  const char* outputFile = NULL;
+  bool arg_ok = true;
+  for (int i=1;i < argc;i++) {
+    if (strcmp(argv[i], "-virtual") == 0 && i + 1 < argc) {
+      deviceName = argv[++i];
+    } else if (strcmp(argv[i], "-device") == 0 && i + 1 < argc) {
+      gpuid = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-shapes") == 0 && i + 1 < argc) {
+      numShape = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-reps") == 0 && i + 1 < argc) {
+      numRep = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-vol") == 0 && i + 1 < argc) {
+      vol = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+      seed = (unsigned)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-clock") == 0 && i + 1 < argc) {
+      arg_ok = timerClockFromName(argv[++i], clock) && clock != TimerClockCudaEvent;
+      if (!arg_ok) break;
+    } else if (strcmp(argv[i], "-output") == 0 && i + 1 < argc) {
+      outputFile = argv[++i];
+    } else {
+      arg_ok = false;
+      break;
+    }
+  }
+
+  cudaDeviceProp prop;
+  int deviceID = CUTT_VIRTUAL_DEVICE;
+  if (arg_ok && gpuid < 0 && !getVirtualDeviceProp(deviceName, prop)) arg_ok = false;
+
+  if (!arg_ok || numShape < 1 || numRep < 1 || vol < 4.0) {
+    printf("cutt_plan_bench [options]\n");
+    printf("Options:\n");
+    printf("-virtual name   : plan for virtual device");
+    for (int i=0;i < numVirtualDevice;i++) printf(" %s", virtualDevices[i].name);
+    printf(" (default is V100)\n");
+    printf("-device gpuid   : plan for GPU with ID gpuid instead of a virtual device\n");
+    printf("-shapes [int]   : tensors per rank, dimension kind, and element size (default is 8)\n");
+    printf("-reps [int]     : times every tensor is planned (default is 5)\n");
+    printf("-vol [float]    : number of elements in the tensors (default is 16M)\n");
+    printf("-seed [int]     : seed of the tensor corpus (default is 1)\n");
+    printf("-clock name     : steady or tsc (default is steady)\n");
+    printf("-output file    : append planning time of every run to CSV file, input of cutt_compare\n");
+    return 1;
+  }
+
+  if (gpuid >= 0) {
+    cudaCheck(cudaSetDevice(gpuid));
+    cudaCheck(cudaGetDeviceProperties(&prop, gpuid));
+    deviceID = gpuid;
+  }
+
+  // Corpus
+  std::mt19937 gen(seed);
+  std::vector<Shape> shapes;
+  for (int rank=2;rank <= 8;rank++) {
+    for (int skewed=0;skewed <= 1;skewed++) {
+      for (int sizeofType=4;sizeofType <= 8;sizeofType+=4) {
+        for (int i=0;i < numShape;i++) {
+          Shape shape;
+          shape.sizeofType = sizeofType;
+          shape.skewed = skewed;
+          shape.dim = makeDim(gen, rank, vol, skewed);
+          shape.permutation = makePermutation(gen, rank);
+          shapes.push_back(shape);
+        }
+      }
+    }
+  }
+
+  printf("device %s%s, %d tensors, %d runs each\n", prop.name, (gpuid < 0) ? " (virtual)" : "",
+    (int)shapes.size(), numRep);
+
+  FILE* fp = NULL;
+  if (outputFile != NULL) {
+    fp = fopen(outputFile, "a");
+    if (fp == NULL) {
+      printf("unable to open %s\n", outputFile);
+      return 1;
+    }
+    fseek(fp, 0, SEEK_END);
+    if (ftell(fp) == 0) fprintf(fp, "label,sizeof_type,rank,dim,permutation,rep,seconds,GBs\n");
+  }
+
+  // Statistics by phase, and by rank for the whole planning
+  PhaseStat phaseStat[NumPhase];
+  PhaseStat rankStat[9];
+  PhaseStat totalStat;
+  std::vector<int> numPlanRank(9, 0);
+  long long numCandidate = 0;
+  size_t arenaHighWater = 0;
+  Timer timer(clock);
+  for (int i=0;i < (int)shapes.size();i++) {
+    const Shape& shape = shapes[i];
+    const int rank = shape.dim.size();
+    for (int rep=0;rep < numRep;rep++) {
+      // Same state as at the start of cuttPlan()
+      planArena().reset();
+      posTableCache().clear();
+
+      double sec[NumPhase];
+      long long alloc[NumPhase];
+      long long allocBytes[NumPhase];
+      std::vector<int> redDim;
+      std::vector<int> redPermutation;
+      PlanCandidates plans;
+      int bestPlan = -1;
+      for (int phase=0;phase < NumPhase;phase++) {
+        long long alloc0 = numAlloc.load();
+        long long allocBytes0 = numAllocBytes.load();
+        bool ok = true;
+        timer.start();
+        switch(phase) {
+          case PhaseReduceRanks:
+          reduceRanks(rank, shape.dim.data(), shape.permutation.data(), redDim, redPermutation);
+          break;
+          case PhaseCreatePlans:
+          ok = cuttPlan_t::createPlans(rank, shape.dim.data(), shape.permutation.data(),
+            redDim.size(), redDim.data(), redPermutation.data(), shape.sizeofType, deviceID, prop, plans);
+          break;
+          case PhaseCountCycles:
+          {
+            // Scratch plan for deviceID, which need not be a real device
+            cuttPlan_t scratch(deviceID);
+            for (int i=0;i < plans.size() && ok;i++) ok = plans.countCycles(i, scratch, prop, 10);
+          }
+          break;
+          case PhaseChoose:
+          bestPlan = choosePlanHeuristic(plans);
+          ok = (bestPlan != -1);
+          break;
+        }
+        timer.stop();
+        if (!ok) {
+          printf("planning failed in %s\n", phaseName[phase]);
+          return 1;
+        }
+        sec[phase] = timer.seconds();
+        alloc[phase] = numAlloc.load() - alloc0;
+        allocBytes[phase] = numAllocBytes.load() - allocBytes0;
+      }
+
+      double totSec = 0.0;
+      long long totAlloc = 0;
+      long long totAllocBytes = 0;
+      for (int phase=0;phase < NumPhase;phase++) {
+        phaseStat[phase].seconds.push_back(sec[phase]);
+        phaseStat[phase].numAlloc += alloc[phase];
+        phaseStat[phase].numAllocBytes += allocBytes[phase];
+        totSec += sec[phase];
+        totAlloc += alloc[phase];
+        totAllocBytes += allocBytes[phase];
+      }
+      totalStat.seconds.push_back(totSec);
+      totalStat.numAlloc += totAlloc;
+      totalStat.numAllocBytes += totAllocBytes;
+      rankStat[rank].seconds.push_back(totSec);
+      rankStat[rank].numAlloc += totAlloc;
+      rankStat[rank].numAllocBytes += totAllocBytes;
+      numPlanRank[rank]++;
+      numCandidate += plans.size();
+      arenaHighWater = std::max(arenaHighWater, planArena().getHighWater());
+
+      if (fp != NULL) {
+        fprintf(fp, "plan,%d,%d,%s,%s,%d,%e,0\n", shape.sizeofType, rank, intList(shape.dim).c_str(),
+          intList(shape.permutation).c_str(), rep, totSec);
+      }
+    }
+  }
+  if (fp != NULL) fclose(fp);
+
+  int numPlan = shapes.size()*numRep;
+  printf("%-20s %10s %10s %10s %10s %12s\n", "phase", "p50 us", "p90 us", "p99 us", "allocs", "alloc bytes");
+  for (int phase=0;phase < NumPhase;phase++) printPhaseStat(phaseName[phase], phaseStat[phase], numPlan);
+  printPhaseStat("total", totalStat, numPlan);
+  printf("\n%-20s %10s %10s %10s %10s %12s\n", "rank", "p50 us", "p90 us", "p99 us", "allocs", "alloc bytes");
+  for (int rank=2;rank <= 8;rank++) {
+    printPhaseStat(std::to_string(rank).c_str(), rankStat[rank], numPlanRank[rank]);
+  }
+  printf("\n%1.1lf candidates per plan, arena high water %zu bytes\n", (double)numCandidate/(double)numPlan,
+    arenaHighWater);
+
+  return 0;
+}
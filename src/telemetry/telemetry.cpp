@@ -0,0 +1,212 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+//
+// Summarizes the misprediction telemetry log written by cuttPlanMeasure()
+// when CUTT_TELEMETRY_FILE is set
+//
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+// One plan measurement event = all candidates measured in a single cuttPlanMeasure() call
+struct Event {
+  int rank;
+  std::string heurMethod;
+  std::string bestMethod;
+  double heurTime;
+  double bestTime;
+  bool hasHeur;
+  bool hasBest;
+  Event() : rank(0), heurTime(0.0), bestTime(0.0), hasHeur(false), hasBest(false) {}
+};
+
+// Regret statistics for a group of events
+struct Regret {
+  int numEvent;
+  int numMiss;
+  double sumRegret;
+  double maxRegret;
+  double heurTime;
+  double bestTime;
+  Regret() : numEvent(0), numMiss(0), sumRegret(0.0), maxRegret(0.0), heurTime(0.0), bestTime(0.0) {}
+  void add(const Event& ev) {
+    double regret = ev.heurTime/ev.bestTime - 1.0;
+    numEvent++;
+    if (regret > 0.0) numMiss++;
+    sumRegret += regret;
+    maxRegret = std::max(maxRegret, regret);
+    heurTime += ev.heurTime;
+    bestTime += ev.bestTime;
+  }
+  void print(const char* name) const {
+    printf("%-16s %8d %8d %7.1lf%% %11.1lf%% %10.1lf%% %10.1lf%%\n", name, numEvent, numMiss,
+      100.0*(double)numMiss/(double)std::max(1, numEvent),
+      100.0*sumRegret/(double)std::max(1, numEvent), 100.0*maxRegret,
+      (bestTime > 0.0) ? 100.0*(heurTime/bestTime - 1.0) : 0.0);
+  }
+};
+
+static void split(const std::string& line, std::vector<std::string>& fields) {
+  fields.clear();
+  std::stringstream ss(line);
+  std::string field;
+  while (std::getline(ss, field, ',')) fields.push_back(field);
+}
+
+//
+// Reads telemetry log file into events. Returns false on error
+//
+bool readLog(const char* filename, std::map<std::string, Event>& events) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    fprintf(stderr, "Unable to open file %s\n", filename);
+    return false;
+  }
+  std::map<std::string, int> col;
+  std::vector<std::string> fields;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty()) continue;
+    split(line, fields);
+    if (fields[0] == "event") {
+      // Header, columns are looked up by name
+      col.clear();
+      for (int i=0;i < (int)fields.size();i++) col[fields[i]] = i;
+      const char* required[] = {"rank", "method", "heuristic", "best", "time"};
+      for (int i=0;i < 5;i++) {
+        if (col.count(required[i]) == 0) {
+          fprintf(stderr, "File %s is missing column %s\n", filename, required[i]);
+          return false;
+        }
+      }
+      continue;
+    }
+    if (col.empty()) {
+      fprintf(stderr, "File %s has no header\n", filename);
+      return false;
+    }
+    if (fields.size() < col.size()) {
+      fprintf(stderr, "File %s has truncated line, skipping it\n", filename);
+      continue;
+    }
+    Event& ev = events[fields[0]];
+    ev.rank = atoi(fields[col["rank"]].c_str());
+    double time = atof(fields[col["time"]].c_str());
+    const std::string& method = fields[col["method"]];
+    if (atoi(fields[col["heuristic"]].c_str())) {
+      ev.hasHeur = true;
+      ev.heurMethod = method;
+      ev.heurTime = time;
+    }
+    if (atoi(fields[col["best"]].c_str())) {
+      ev.hasBest = true;
+      ev.bestMethod = method;
+      ev.bestTime = time;
+    }
+  }
+  return true;
+}
+
+void printHeader(const char* name) {
+  printf("%-16s %8s %8s %8s %12s %11s %11s\n", name, "events", "mispred", "rate", "mean regret", "max regret",
+    "tot regret");
+}
+
+int main(int argc, char *argv[]) {
+
+  std::vector<const char*> filenames;
+  bool arg_ok = true;
+  for (int i=1;i < argc;i++) {
+    if (argv[i][0] == '-') {
+      arg_ok = false;
+      break;
+    }
+    filenames.push_back(argv[i]);
+  }
+
+  if (!arg_ok || filenames.size() == 0) {
+    printf("cutt_telemetry file [file ...]\n");
+    printf("Summarizes the telemetry log(s) written by cuttPlanMeasure when CUTT_TELEMETRY_FILE is set.\n");
+    printf("Regret = (time of heuristic choice)/(time of measured best) - 1\n");
+    return 1;
+  }
+
+  std::map<std::string, Event> events;
+  for (int i=0;i < (int)filenames.size();i++) {
+    if (!readLog(filenames[i], events)) return 1;
+  }
+
+  Regret total;
+  std::map<std::string, Regret> byMethod;
+  std::map<int, Regret> byRank;
+  std::map<std::string, std::map<std::string, int> > confusion;
+  std::vector<std::string> methods;
+  int numSkip = 0;
+  for (auto it=events.begin();it != events.end();it++) {
+    const Event& ev = it->second;
+    if (!ev.hasHeur || !ev.hasBest || ev.bestTime <= 0.0) {
+      numSkip++;
+      continue;
+    }
+    total.add(ev);
+    byMethod[ev.heurMethod].add(ev);
+    byRank[ev.rank].add(ev);
+    confusion[ev.heurMethod][ev.bestMethod]++;
+    if (std::find(methods.begin(), methods.end(), ev.heurMethod) == methods.end()) methods.push_back(ev.heurMethod);
+    if (std::find(methods.begin(), methods.end(), ev.bestMethod) == methods.end()) methods.push_back(ev.bestMethod);
+  }
+  std::sort(methods.begin(), methods.end());
+
+  if (numSkip > 0) printf("Skipped %d incomplete events\n", numSkip);
+  printHeader("");
+  total.print("total");
+
+  printf("\nRegret by heuristic method\n");
+  printHeader("method");
+  for (auto it=byMethod.begin();it != byMethod.end();it++) it->second.print(it->first.c_str());
+
+  printf("\nRegret by rank\n");
+  printHeader("rank");
+  for (auto it=byRank.begin();it != byRank.end();it++) {
+    it->second.print(std::to_string(it->first).c_str());
+  }
+
+  printf("\nHeuristic method (rows) vs. measured best method (columns)\n");
+  printf("%-16s", "");
+  for (int j=0;j < (int)methods.size();j++) printf(" %11s", methods[j].c_str());
+  printf("\n");
+  for (int i=0;i < (int)methods.size();i++) {
+    printf("%-16s", methods[i].c_str());
+    for (int j=0;j < (int)methods.size();j++) printf(" %11d", confusion[methods[i]][methods[j]]);
+    printf("\n");
+  }
+
+  return 0;
+}
@@ -23,6 +23,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 *******************************************************************************/
 #include <vector>
+#include <memory>
 #include <algorithm>
 #include <ctime>           // std::time
 #include <cstring>         // strcmp
@@ -33,6 +34,8 @@ SOFTWARE.
 #include "TensorTester.h"
 #include "cuttTimer.h"
 #include "cuttGpuModel.h"  // testCounters
+#include "cuttCpuModel.h"  // cuttHostPlan_t, secondsHostPlan
+#include "cuttNuma.h"      // hostNumaNodes
 
 //
 // Error checking wrapper for cutt
@@ -58,6 +61,18 @@ bool test2();
 bool test3();
 bool test4();
 bool test5();
+bool test6();
+bool test7();
+bool test8();
+bool test9();
+bool test10();
+bool test11();
+bool test12();
+bool test13();
+bool test14();
+bool test15();
+bool test16();
+bool test17();
 template <typename T> bool test_tensor(std::vector<int>& dim, std::vector<int>& permutation);
 void printVec(std::vector<int>& vec);
 
@@ -106,6 +121,18 @@ int main(int argc, char *argv[]) {
   if(passed){passed = test3(); if(!passed) printf("Test 3 failed\n");}
   //if(passed){passed = test4(); if(!passed) printf("Test 4 failed\n");}
   if(passed){passed = test5(); if(!passed) printf("Test 5 failed\n");}
+  if(passed){passed = test6(); if(!passed) printf("Test 6 failed\n");}
+  if(passed){passed = test7(); if(!passed) printf("Test 7 failed\n");}
+  if(passed){passed = test8(); if(!passed) printf("Test 8 failed\n");}
+  if(passed){passed = test9(); if(!passed) printf("Test 9 failed\n");}
+  if(passed){passed = test10(); if(!passed) printf("Test 10 failed\n");}
+  if(passed){passed = test11(); if(!passed) printf("Test 11 failed\n");}
+  if(passed){passed = test12(); if(!passed) printf("Test 12 failed\n");}
+  if(passed){passed = test13(); if(!passed) printf("Test 13 failed\n");}
+  if(passed){passed = test14(); if(!passed) printf("Test 14 failed\n");}
+  if(passed){passed = test15(); if(!passed) printf("Test 15 failed\n");}
+  if(passed){passed = test16(); if(!passed) printf("Test 16 failed\n");}
+  if(passed){passed = test17(); if(!passed) printf("Test 17 failed\n");}
 
   if(passed){
     std::vector<int> worstDim;
@@ -428,6 +455,560 @@ bool test5() {
   return true;
 }
 
+//
+// Test 6: Planning many problems at once, including duplicates
+//
+bool test6() {
+
+  const int rank = 4;
+  std::vector<int> dim = {24, 32, 16, 36};
+  std::vector<int> permutation = {0, 1, 2, 3};
+
+  // All permutations, each twice
+  std::vector< std::vector<int> > permutations;
+  do {
+    permutations.push_back(permutation);
+    permutations.push_back(permutation);
+  } while (std::next_permutation(permutation.begin(), permutation.end()));
+
+  int count = permutations.size();
+  std::vector<int> ranks(count, rank);
+  std::vector<const int*> dims(count, dim.data());
+  std::vector<const int*> perms(count);
+  std::vector<size_t> sizeofTypes(count);
+  for (int i=0;i < count;i++) {
+    perms[i] = permutations[i].data();
+    sizeofTypes[i] = (i % 4 < 2) ? sizeof(long long int) : sizeof(int);
+  }
+
+  std::vector<cuttHandle> plans(count);
+  cuttCheck(cuttPlanMany(count, plans.data(), ranks.data(), dims.data(), perms.data(), sizeofTypes.data(), 0));
+
+  bool run_ok = true;
+  for (int i=0;i < count && run_ok;i++) {
+    cuttCheck(cuttExecute(plans[i], dataIn, dataOut));
+    cudaCheck(cudaDeviceSynchronize());
+    if (sizeofTypes[i] == sizeof(int)) {
+      run_ok = tester->checkTranspose<int>(rank, dim.data(), permutations[i].data(), (int *)dataOut);
+    } else {
+      run_ok = tester->checkTranspose<long long int>(rank, dim.data(), permutations[i].data(), (long long int *)dataOut);
+    }
+  }
+
+  for (int i=0;i < count;i++) {
+    cuttCheck(cuttDestroy(plans[i]));
+  }
+
+  return run_ok;
+}
+
+//
+// Plan updated for new dimensions with cuttPlanUpdateDims()
+//
+bool test7() {
+
+  const int rank = 4;
+  std::vector<int> permutation = {2, 0, 1, 3};
+  std::vector< std::vector<int> > dims = {
+    {24, 32, 16, 36}, {24, 33, 16, 36}, {24, 48, 20, 36}, {1000, 2, 1000, 6}, {24, 32, 16, 36}};
+
+  cuttHandle plan;
+  cuttCheck(cuttPlan(&plan, rank, dims[0].data(), permutation.data(), sizeof(long long int), 0));
+
+  bool run_ok = true;
+  for (int i=0;i < dims.size() && run_ok;i++) {
+    if (i > 0) cuttCheck(cuttPlanUpdateDims(plan, dims[i].data()));
+    cuttCheck(cuttExecute(plan, dataIn, dataOut));
+    cudaCheck(cudaDeviceSynchronize());
+    run_ok = tester->checkTranspose<long long int>(rank, dims[i].data(), permutation.data(), (long long int *)dataOut);
+  }
+
+  // Invalid dimensions must leave the plan unchanged
+  if (run_ok) {
+    std::vector<int> dimBad = {24, 1, 16, 36};
+    if (cuttPlanUpdateDims(plan, dimBad.data()) != CUTT_INVALID_PARAMETER) {
+      printf("test7 cuttPlanUpdateDims accepted invalid dimensions\n");
+      run_ok = false;
+    } else {
+      cuttCheck(cuttExecute(plan, dataIn, dataOut));
+      cudaCheck(cudaDeviceSynchronize());
+      run_ok = tester->checkTranspose<long long int>(rank, dims.back().data(), permutation.data(), (long long int *)dataOut);
+    }
+  }
+
+  cuttCheck(cuttDestroy(plan));
+
+  return run_ok;
+}
+
+//
+// Inverse plans created with cuttPlanInverse()
+//
+bool test8() {
+
+  const int rank = 5;
+  std::vector<int> dim = {12, 7, 30, 5, 18};
+  std::vector< std::vector<int> > permutations = {
+    {4, 3, 2, 1, 0}, {2, 3, 0, 1, 4}, {0, 3, 1, 4, 2}, {1, 0, 2, 3, 4}};
+
+  bool run_ok = true;
+  for (int i=0;i < permutations.size() && run_ok;i++) {
+    std::vector<int>& permutation = permutations[i];
+    cuttHandle plan, invPlan;
+    cuttCheck(cuttPlan(&plan, rank, dim.data(), permutation.data(), sizeof(int), 0));
+    cuttCheck(cuttPlanInverse(plan, &invPlan));
+
+    // Inverse plan transposes the permuted dimensions with the inverse permutation
+    std::vector<int> invDim(rank);
+    std::vector<int> invPermutation(rank);
+    for (int j=0;j < rank;j++) {
+      invDim[j] = dim[permutation[j]];
+      invPermutation[permutation[j]] = j;
+    }
+    cuttCheck(cuttExecute(invPlan, dataIn, dataOut));
+    cudaCheck(cudaDeviceSynchronize());
+    run_ok = tester->checkTranspose<int>(rank, invDim.data(), invPermutation.data(), (int *)dataOut);
+
+    cuttCheck(cuttDestroy(invPlan));
+    cuttCheck(cuttDestroy(plan));
+  }
+
+  return run_ok;
+}
+
+//
+// Plans created with cuttPlanWithBudget()
+//
+bool test9() {
+
+  const int rank = 4;
+  std::vector<int> dim = {40, 24, 35, 16};
+  std::vector<int> permutation = {3, 1, 0, 2};
+
+  // No time at all and plenty of time
+  const double maxSeconds[2] = {0.0, 1.0e6};
+  bool run_ok = true;
+  for (int i=0;i < 2 && run_ok;i++) {
+    cuttHandle plan;
+    bool complete;
+    cuttCheck(cuttPlanWithBudget(&plan, rank, dim.data(), permutation.data(), sizeof(long long int), 0,
+      maxSeconds[i], &complete));
+    if (i == 1 && !complete) {
+      printf("test9 cuttPlanWithBudget did not complete\n");
+      run_ok = false;
+    }
+    if (run_ok) {
+      cuttCheck(cuttExecute(plan, dataIn, dataOut));
+      cudaCheck(cudaDeviceSynchronize());
+      run_ok = tester->checkTranspose<long long int>(rank, dim.data(), permutation.data(), (long long int *)dataOut);
+    }
+    cuttCheck(cuttDestroy(plan));
+  }
+
+  return run_ok;
+}
+
+//
+// Execution statistics from cuttGetStats() and cuttGetStatsTotal()
+//
+bool test10() {
+
+  const int rank = 3;
+  std::vector<int> dim = {61, 43, 57};
+  std::vector<int> permutation = {2, 0, 1};
+  const int vol = dim[0]*dim[1]*dim[2];
+  const int numExecute = 5;
+
+  size_t numPlan;
+  cuttStats total0;
+  cuttCheck(cuttGetStatsTotal(&numPlan, &total0));
+
+  cuttStatsEnable(true);
+  cuttHandle plan;
+  cuttCheck(cuttPlan(&plan, rank, dim.data(), permutation.data(), sizeof(long long int), 0));
+  for (int i=0;i < numExecute;i++) {
+    cuttCheck(cuttExecute(plan, dataIn, dataOut));
+  }
+  cudaCheck(cudaDeviceSynchronize());
+  cuttStatsEnable(false);
+
+  bool run_ok = tester->checkTranspose<long long int>(rank, dim.data(), permutation.data(), (long long int *)dataOut);
+
+  cuttStats stats;
+  cuttCheck(cuttGetStats(plan, &stats));
+  if (stats.numExecute != numExecute || stats.numTimed != numExecute ||
+    stats.numBytes != 2ULL*numExecute*vol*sizeof(long long int) || stats.seconds <= 0.0) {
+    printf("test10 cuttGetStats: numExecute %llu numTimed %llu numBytes %llu seconds %e\n",
+      stats.numExecute, stats.numTimed, stats.numBytes, stats.seconds);
+    run_ok = false;
+  }
+  cuttCheck(cuttDestroy(plan));
+
+  // Statistics of the destroyed plan remain in the total
+  cuttStats total;
+  cuttCheck(cuttGetStatsTotal(&numPlan, &total));
+  if (total.numExecute != total0.numExecute + numExecute) {
+    printf("test10 cuttGetStatsTotal: numExecute %llu expected %llu\n",
+      total.numExecute, total0.numExecute + numExecute);
+    run_ok = false;
+  }
+
+  return run_ok;
+}
+
+//
+// Host verification with TensorTester::checkTransposeHost()
+//
+bool test11() {
+
+  const int rank = 4;
+  std::vector<int> dim = {37, 29, 53, 31};
+  std::vector<int> permutation = {3, 1, 0, 2};
+  const int vol = dim[0]*dim[1]*dim[2]*dim[3];
+
+  cuttHandle plan;
+  cuttCheck(cuttPlan(&plan, rank, dim.data(), permutation.data(), sizeof(long long int), 0));
+  cuttCheck(cuttExecute(plan, dataIn, dataOut));
+  cuttCheck(cuttDestroy(plan));
+  cudaCheck(cudaDeviceSynchronize());
+
+  std::vector<long long int> hostOut(vol);
+  copy_DtoH_sync<long long int>((long long int *)dataOut, hostOut.data(), vol);
+
+  bool run_ok = TensorTester::checkTransposeHost<long long int>(rank, dim.data(), permutation.data(), hostOut.data());
+
+  // Corrupt the output. Only the first maxError mismatches are reported, in order
+  const int maxError = 3;
+  int badPos[4] = {vol - 1, vol/2, 1234, 5};
+  for (int i=0;i < 4;i++) hostOut[badPos[i]] = -1;
+  std::vector<TensorErrorHost_t> errors;
+  if (TensorTester::checkTransposeHost<long long int>(rank, dim.data(), permutation.data(), hostOut.data(),
+    &errors, maxError) || (int)errors.size() != maxError ||
+    errors[0].pos != 5 || errors[1].pos != 1234 || errors[2].pos != (size_t)(vol/2)) {
+    printf("test11 checkTransposeHost did not report the first %d mismatches\n", maxError);
+    run_ok = false;
+  }
+
+  // Without recorded mismatches the check must still fail
+  if (TensorTester::checkTransposeHost<long long int>(rank, dim.data(), permutation.data(), hostOut.data(),
+    &errors, 0) || errors.size() != 0) {
+    printf("test11 checkTransposeHost with maxError = 0 passed corrupt data\n");
+    run_ok = false;
+  }
+
+  return run_ok;
+}
+
+//
+// Host transposes with cuttPlanHost(): all permutations up to rank 5, and scaling
+//
+bool test12() {
+
+  std::vector<int> dimAll = {29, 17, 11, 5, 3};
+  std::vector<long long int> hostIn(29*17*11*5*3);
+  std::vector<long long int> hostOut(hostIn.size());
+  TensorTester::setTensorCheckPatternHost((unsigned int *)hostIn.data(), hostIn.size()*2);
+
+  for (int rank=2;rank <= 5;rank++) {
+    std::vector<int> dim(dimAll.begin(), dimAll.begin() + rank);
+    std::vector<int> permutation(rank);
+    for (int r=0;r < rank;r++) permutation[r] = r;
+    do {
+      for (int numThread=1;numThread <= 3;numThread += 2) {
+        cuttHandle plan;
+        cuttCheck(cuttPlanHost(&plan, rank, dim.data(), permutation.data(), sizeof(int), numThread));
+        cuttCheck(cuttExecute(plan, hostIn.data(), hostOut.data()));
+        cuttCheck(cuttDestroy(plan));
+        if (!TensorTester::checkTransposeHost<int>(rank, dim.data(), permutation.data(), (int *)hostOut.data())) return false;
+        cuttCheck(cuttPlanHost(&plan, rank, dim.data(), permutation.data(), sizeof(long long int), numThread));
+        cuttCheck(cuttExecute(plan, hostIn.data(), hostOut.data()));
+        cuttCheck(cuttDestroy(plan));
+        if (!TensorTester::checkTransposeHost<long long int>(rank, dim.data(), permutation.data(), hostOut.data())) return false;
+      }
+    } while (std::next_permutation(permutation.begin(), permutation.end()));
+  }
+
+  // out = alpha*in + beta*out
+  std::vector<int> dim = {61, 43, 57};
+  std::vector<int> permutation = {1, 2, 0};
+  const int vol = dim[0]*dim[1]*dim[2];
+  std::vector<double> in(vol);
+  std::vector<double> out(vol, 1.0);
+  for (int i=0;i < vol;i++) in[i] = i;
+  double alpha = 2.0;
+  double beta = 3.0;
+  cuttHandle plan;
+  cuttCheck(cuttPlanHost(&plan, 3, dim.data(), permutation.data(), sizeof(double), 0));
+  cuttCheck(cuttExecute(plan, in.data(), out.data(), &alpha, &beta));
+  cuttCheck(cuttDestroy(plan));
+  for (int i0=0;i0 < dim[0];i0++) {
+    for (int i1=0;i1 < dim[1];i1++) {
+      for (int i2=0;i2 < dim[2];i2++) {
+        double ref = alpha*in[i0 + dim[0]*(i1 + dim[1]*i2)] + beta;
+        if (out[i1 + dim[1]*(i2 + dim[2]*i0)] != ref) {
+          printf("test12 alpha/beta mismatch at %d %d %d\n", i0, i1, i2);
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+//
+// Every host loop nest the cost model chooses from, and the model estimates
+//
+bool test13() {
+
+  std::vector< std::vector<int> > dims = {{37, 29, 53}, {5, 300, 7, 3}, {2, 3, 2, 5, 2, 3}};
+  std::vector< std::vector<int> > permutations = {{1, 2, 0}, {3, 0, 1, 2}, {5, 1, 4, 0, 3, 2}};
+  std::vector<int> leafs = {1, 3, 4, 8, 32};
+
+  std::vector<long long int> hostIn(37*29*53);
+  std::vector<long long int> hostOut(hostIn.size());
+  TensorTester::setTensorCheckPatternHost((unsigned int *)hostIn.data(), hostIn.size()*2);
+
+  for (int i=0;i < (int)dims.size();i++) {
+    int rank = dims[i].size();
+    cuttHostPlan_t plan;
+    if (!plan.setup(rank, dims[i].data(), permutations[i].data(), sizeof(long long int), 3)) return false;
+    if (!(plan.modelSeconds > 0.0) || std::isinf(plan.modelSeconds)) {
+      printf("test13 model estimate %e\n", plan.modelSeconds);
+      return false;
+    }
+    for (int method=HostRecursive;method <= HostBlocked;method++) {
+      for (int leafMm : leafs) {
+        for (int leafMk : leafs) {
+          if (!plan.setLoopNest(method, leafMm, leafMk)) return false;
+          if (!(secondsHostPlan(plan, hostModelProp()) > 0.0)) return false;
+          plan.execute(hostIn.data(), hostOut.data());
+          if (!TensorTester::checkTransposeHost<long long int>(rank, dims[i].data(), permutations[i].data(),
+            hostOut.data())) {
+            plan.print();
+            return false;
+          }
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+//
+// Host loop orders of Mbar, and cuttPlanHostMeasure()
+//
+bool test14() {
+
+  std::vector< std::vector<int> > dims = {{3, 4, 5, 6, 7}, {2, 3, 2, 5, 2, 3, 2}};
+  std::vector< std::vector<int> > permutations = {{4, 2, 0, 3, 1}, {6, 1, 4, 0, 3, 5, 2}};
+
+  std::vector<long long int> hostIn(3*4*5*6*7);
+  std::vector<long long int> hostOut(hostIn.size());
+  TensorTester::setTensorCheckPatternHost((unsigned int *)hostIn.data(), hostIn.size()*2);
+
+  for (int i=0;i < (int)dims.size();i++) {
+    int rank = dims[i].size();
+    cuttHostPlan_t plan;
+    if (!plan.setup(rank, dims[i].data(), permutations[i].data(), sizeof(long long int), 2)) return false;
+    if (plan.candidates.size() == 0 || (int)plan.candidates.size() > HOST_MEASURE_NEST ||
+      plan.nest.order.size() != plan.mbar.size()) {
+      printf("test14 %d candidates, loop order of %d\n", (int)plan.candidates.size(), (int)plan.nest.order.size());
+      return false;
+    }
+    HostLoopNest nest = plan.candidates[0];
+    std::sort(nest.order.begin(), nest.order.end());
+    do {
+      if (!plan.setLoopNest(nest)) return false;
+      plan.execute(hostIn.data(), hostOut.data());
+      if (!TensorTester::checkTransposeHost<long long int>(rank, dims[i].data(), permutations[i].data(),
+        hostOut.data())) {
+        plan.print();
+        return false;
+      }
+    } while (std::next_permutation(nest.order.begin(), nest.order.end()));
+    // Loop order must be a permutation of Mbar
+    nest.order[0] = 0;
+    if (plan.setLoopNest(nest)) return false;
+
+    cuttHandle handle;
+    if (cuttPlanHostMeasure(&handle, rank, dims[i].data(), permutations[i].data(), sizeof(long long int), 2,
+      hostIn.data(), hostIn.data()) != CUTT_INVALID_PARAMETER) return false;
+    cuttCheck(cuttPlanHostMeasure(&handle, rank, dims[i].data(), permutations[i].data(), sizeof(long long int), 2,
+      hostIn.data(), hostOut.data()));
+    std::fill(hostOut.begin(), hostOut.end(), -1);
+    cuttCheck(cuttExecute(handle, hostIn.data(), hostOut.data()));
+    cuttCheck(cuttDestroy(handle));
+    if (!TensorTester::checkTransposeHost<long long int>(rank, dims[i].data(), permutations[i].data(),
+      hostOut.data())) return false;
+  }
+
+  return true;
+}
+
+//
+// Host plans with NUMA placements, on all nodes of the host and on the first one
+//
+bool test15() {
+
+  std::vector<int> dim = {31, 6, 17, 5, 9};
+  std::vector<int> permutation = {3, 1, 4, 0, 2};
+  const int rank = dim.size();
+  std::vector<int> hostIn(31*6*17*5*9);
+  TensorTester::setTensorCheckPatternHost((unsigned int *)hostIn.data(), hostIn.size());
+
+  cuttHostOptions options;
+  options.numThread = 3;
+  options.nodeMask = 0;
+  options.placement = CUTT_HOST_PLACEMENT_NODE_MASK;
+  cuttHandle plan;
+  if (cuttPlanHostWithOptions(&plan, rank, dim.data(), permutation.data(), sizeof(int), &options) !=
+    CUTT_INVALID_PARAMETER) return false;
+  options.nodeMask = 1ULL << hostNumaNodes()[0].id;
+
+  for (int placement=CUTT_HOST_PLACEMENT_NONE;placement <= CUTT_HOST_PLACEMENT_NODE_MASK;placement++) {
+    options.placement = (cuttHostPlacement)placement;
+    cuttCheck(cuttPlanHostWithOptions(&plan, rank, dim.data(), permutation.data(), sizeof(int), &options));
+    // Freshly allocated output
+    std::unique_ptr<int[]> hostOut(new int[hostIn.size()]);
+    cuttCheck(cuttHostTouch(plan, hostOut.get()));
+    for (int i=0;i < (int)hostIn.size();i++) {
+      if (hostOut[i] != 0) {
+        printf("test15 cuttHostTouch did not zero element %d\n", i);
+        return false;
+      }
+    }
+    cuttCheck(cuttExecute(plan, hostIn.data(), hostOut.get()));
+    cuttCheck(cuttDestroy(plan));
+    if (!TensorTester::checkTransposeHost<int>(rank, dim.data(), permutation.data(), hostOut.get())) return false;
+  }
+
+  return true;
+}
+
+//
+// Plan memory with cuttPlanMemory(), trimmed plans with cuttPlanTrim()
+//
+bool test16() {
+
+  std::vector<int> dim = {24, 32, 16, 36, 43, 9};
+  std::vector<int> permutation = {5, 1, 4, 2, 3, 0};
+  const int rank = dim.size();
+  int vol = 1;
+  for (int r=0;r < rank;r++) vol *= dim[r];
+
+  cuttHandle plans[2];
+  size_t hostBytes[2], deviceBytes[2];
+  for (int i=0;i < 2;i++) {
+    cuttCheck(cuttPlan(&plans[i], rank, dim.data(), permutation.data(), sizeof(long long int), 0));
+    cuttCheck(cuttPlanMemory(plans[i], &hostBytes[i], &deviceBytes[i]));
+  }
+
+  // Trimmed plan must use less host memory, the same device memory, and still execute
+  size_t hostBytesTrim, deviceBytesTrim;
+  cuttCheck(cuttPlanTrim(plans[1]));
+  cuttCheck(cuttPlanMemory(plans[1], &hostBytesTrim, &deviceBytesTrim));
+  bool run_ok = true;
+  if (hostBytesTrim >= hostBytes[1] || deviceBytesTrim != deviceBytes[1]) {
+    printf("test16 cuttPlanTrim FAIL: host %zu -> %zu device %zu -> %zu\n",
+      hostBytes[1], hostBytesTrim, deviceBytes[1], deviceBytesTrim);
+    run_ok = false;
+  }
+
+  // Total over all plans includes both plans
+  size_t numPlan, hostBytesTotal, deviceBytesTotal;
+  cuttCheck(cuttPlanMemoryTotal(&numPlan, &hostBytesTotal, &deviceBytesTotal));
+  if (numPlan < 2 || hostBytesTotal < hostBytes[0] + hostBytesTrim || deviceBytesTotal < deviceBytes[0] + deviceBytesTrim) {
+    printf("test16 cuttPlanMemoryTotal FAIL: %zu plans host %zu device %zu\n", numPlan, hostBytesTotal,
+      deviceBytesTotal);
+    run_ok = false;
+  }
+
+  for (int i=0;i < 2 && run_ok;i++) {
+    set_device_array<long long int>((long long int *)dataOut, -1, vol);
+    cuttCheck(cuttExecute(plans[i], dataIn, dataOut));
+    cudaCheck(cudaDeviceSynchronize());
+    run_ok = tester->checkTranspose<long long int>(rank, dim.data(), permutation.data(), (long long int *)dataOut);
+  }
+
+  for (int i=0;i < 2;i++) {
+    cuttCheck(cuttDestroy(plans[i]));
+  }
+
+  return run_ok;
+}
+
+//
+// Host plans in plan memory, trimming and execution statistics
+//
+bool test17() {
+
+  std::vector<int> dim = {23, 8, 41, 6};
+  std::vector<int> permutation = {2, 3, 0, 1};
+  const int rank = dim.size();
+  const int vol = dim[0]*dim[1]*dim[2]*dim[3];
+  const int numExecute = 3;
+  std::vector<int> hostIn(vol);
+  std::vector<int> hostOut(vol);
+  TensorTester::setTensorCheckPatternHost((unsigned int *)hostIn.data(), vol);
+
+  size_t numPlan0, hostBytesTotal0, deviceBytesTotal0;
+  cuttCheck(cuttPlanMemoryTotal(&numPlan0, &hostBytesTotal0, &deviceBytesTotal0));
+  cuttStats total0;
+  cuttCheck(cuttGetStatsTotal(&numPlan0, &total0));
+
+  cuttHandle plan;
+  cuttCheck(cuttPlanHostMeasure(&plan, rank, dim.data(), permutation.data(), sizeof(int), 2,
+    hostIn.data(), hostOut.data()));
+  bool run_ok = true;
+
+  // Memory of the plan is in the total, and trimming does not increase it
+  size_t hostBytes, deviceBytes, hostBytesTrim, deviceBytesTrim;
+  size_t numPlan, hostBytesTotal, deviceBytesTotal;
+  cuttCheck(cuttPlanMemory(plan, &hostBytes, &deviceBytes));
+  cuttCheck(cuttPlanMemoryTotal(&numPlan, &hostBytesTotal, &deviceBytesTotal));
+  if (numPlan != numPlan0 + 1 || hostBytesTotal != hostBytesTotal0 + hostBytes || deviceBytes != 0) {
+    printf("test17 cuttPlanMemoryTotal FAIL: %zu plans host %zu, expected %zu plans host %zu\n",
+      numPlan, hostBytesTotal, numPlan0 + 1, hostBytesTotal0 + hostBytes);
+    run_ok = false;
+  }
+  cuttCheck(cuttPlanTrim(plan));
+  cuttCheck(cuttPlanMemory(plan, &hostBytesTrim, &deviceBytesTrim));
+  if (hostBytesTrim > hostBytes || deviceBytesTrim != 0) {
+    printf("test17 cuttPlanTrim FAIL: host %zu -> %zu\n", hostBytes, hostBytesTrim);
+    run_ok = false;
+  }
+
+  cuttStatsEnable(true);
+  for (int i=0;i < numExecute && run_ok;i++) {
+    std::fill(hostOut.begin(), hostOut.end(), -1);
+    cuttCheck(cuttExecute(plan, hostIn.data(), hostOut.data()));
+    run_ok = TensorTester::checkTransposeHost<int>(rank, dim.data(), permutation.data(), hostOut.data());
+  }
+  cuttStatsEnable(false);
+
+  cuttStats stats;
+  cuttCheck(cuttGetStats(plan, &stats));
+  if (run_ok && (stats.numExecute != numExecute || stats.numTimed != numExecute ||
+    stats.numBytes != 2ULL*numExecute*vol*sizeof(int))) {
+    printf("test17 cuttGetStats: numExecute %llu numTimed %llu numBytes %llu seconds %e\n",
+      stats.numExecute, stats.numTimed, stats.numBytes, stats.seconds);
+    run_ok = false;
+  }
+  cuttCheck(cuttDestroy(plan));
+
+  // Statistics of the destroyed plan remain in the total
+  cuttStats total;
+  cuttCheck(cuttGetStatsTotal(&numPlan, &total));
+  if (run_ok && total.numExecute != total0.numExecute + numExecute) {
+    printf("test17 cuttGetStatsTotal: numExecute %llu expected %llu\n",
+      total.numExecute, total0.numExecute + numExecute);
+    run_ok = false;
+  }
+
+  return run_ok;
+}
 
 template <typename T>
 bool test_tensor(std::vector<int>& dim, std::vector<int>& permutation) {